@@ -0,0 +1,303 @@
+#include "ASGraph.h"
+#include "parse_caida.h"
+#include "InputLoader.h"
+#include "Prefix.h"
+#include "Propagation.h"
+#include "RibWriter.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Per-phase benchmark of the simulator pipeline.
+// Usage: benchmark --relationships <file> --announcements <file> --rov-asns <file>
+//                  [--label name] [--threads N] [--engine node|prefix] [--repeat N]
+//                  [--output results.json] [--baseline baseline.json] [--threshold percent]
+// Exits with 2 if any phase is slower than the baseline by more than the threshold.
+
+// ---------------------------------------------------------
+// Allocation counting: every operator new in the process goes through here
+// ---------------------------------------------------------
+static std::atomic<uint64_t> g_allocations{0};
+static std::atomic<uint64_t> g_allocated_bytes{0};
+
+// GCC flags free() of memory from a replaced operator new as mismatched, but
+// this operator new is malloc underneath
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    std::string name;
+    double seconds = 0.0;
+    uint64_t items = 0;
+    std::string unit;
+    bool has_allocations = false;   // Phases timed inside run_propagation have no own counters
+    uint64_t allocations = 0;
+    uint64_t allocated_bytes = 0;
+    long peak_rss_kb = 0;
+};
+
+long peak_rss_kb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;  // Kilobytes on Linux
+}
+
+// Times fn() once; fn returns the number of items it processed
+template <typename Fn>
+Result measure(const std::string& name, const std::string& unit, Fn&& fn) {
+    Result r;
+    r.name = name;
+    r.unit = unit;
+    r.has_allocations = true;
+    const uint64_t allocs = g_allocations.load();
+    const uint64_t bytes = g_allocated_bytes.load();
+    const Clock::time_point start = Clock::now();
+    r.items = fn();
+    r.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    r.allocations = g_allocations.load() - allocs;
+    r.allocated_bytes = g_allocated_bytes.load() - bytes;
+    r.peak_rss_kb = peak_rss_kb();
+    return r;
+}
+
+// Minimal reader for the simulator's anns.csv and ROV files
+uint64_t load_inputs(const std::string& ann_file, const std::string& rov_file, size_t num_threads,
+                     ASGraph& graph, PropagationEngine& engine, PrefixTable& prefixes) {
+    size_t seeded = 0;
+    load_rov_asns(rov_file, graph, num_threads);
+    load_announcements(ann_file, graph, engine, prefixes, num_threads, seeded);
+    return seeded;
+}
+
+// Reads name -> seconds from a results file written by write_json
+bool read_baseline(const std::string& path, std::unordered_map<std::string, double>& seconds) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        std::cerr << "Error: Could not open baseline file: " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t name_at = line.find("\"name\": \"");
+        size_t seconds_at = line.find("\"seconds\": ");
+        if (name_at == std::string::npos || seconds_at == std::string::npos) continue;
+        name_at += 9;
+        std::string name = line.substr(name_at, line.find('"', name_at) - name_at);
+        seconds[name] = std::strtod(line.c_str() + seconds_at + 11, nullptr);
+    }
+    return true;
+}
+
+// One result object per line, so results can be diffed and read back line by line
+bool write_json(const std::string& path, const std::string& label, size_t threads,
+                const std::string& engine, size_t repeat, const std::vector<Result>& results) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open " << path << " for writing." << std::endl;
+        return false;
+    }
+    out << "{\n  \"label\": \"" << label << "\",\n  \"threads\": " << threads
+        << ",\n  \"engine\": \"" << engine << "\",\n  \"repeat\": " << repeat << ",\n  \"results\": [\n";
+    char buffer[512];
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        const double rate = r.seconds > 0 ? r.items / r.seconds : 0.0;
+        std::snprintf(buffer, sizeof(buffer),
+                      "    {\"name\": \"%s\", \"seconds\": %.6f, \"items\": %llu, \"unit\": \"%s\", \"per_second\": %.1f",
+                      r.name.c_str(), r.seconds, static_cast<unsigned long long>(r.items), r.unit.c_str(), rate);
+        out << buffer;
+        if (r.has_allocations) {
+            out << ", \"allocations\": " << r.allocations << ", \"allocated_bytes\": " << r.allocated_bytes;
+        }
+        out << ", \"peak_rss_kb\": " << r.peak_rss_kb << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return static_cast<bool>(out.flush());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string rel_file, ann_file, rov_file;
+    std::string label = "benchmark", output_file, baseline_file;
+    std::string rib_file = "benchmark_ribs.csv";
+    size_t num_threads = 1, repeat = 3;
+    double threshold = 10.0;
+    EngineMode mode = EngineMode::NODE_MAJOR;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string value = (i + 1 < argc) ? argv[i + 1] : "";
+        if (value.empty()) {
+            std::cerr << "Error: " << arg << " requires a value.\n";
+            return 1;
+        }
+        ++i;
+        if (arg == "--relationships") rel_file = value;
+        else if (arg == "--announcements") ann_file = value;
+        else if (arg == "--rov-asns") rov_file = value;
+        else if (arg == "--label") label = value;
+        else if (arg == "--output") output_file = value;
+        else if (arg == "--baseline") baseline_file = value;
+        else if (arg == "--rib-output") rib_file = value;
+        else if (arg == "--threads") num_threads = std::max(1L, std::strtol(value.c_str(), nullptr, 10));
+        else if (arg == "--repeat") repeat = std::max(1L, std::strtol(value.c_str(), nullptr, 10));
+        else if (arg == "--threshold") threshold = std::strtod(value.c_str(), nullptr);
+        else if (arg == "--engine" && (value == "node" || value == "prefix")) {
+            mode = value == "prefix" ? EngineMode::PREFIX_MAJOR : EngineMode::NODE_MAJOR;
+        } else {
+            std::cerr << "Error: unknown argument " << arg << " " << value << "\n";
+            return 1;
+        }
+    }
+    if (rel_file.empty() || ann_file.empty() || rov_file.empty()) {
+        std::cerr << "Usage: " << argv[0] << " --relationships <file> --announcements <file> --rov-asns <file>"
+                  << " [--label name] [--threads N] [--engine node|prefix] [--repeat N]"
+                  << " [--output results.json] [--baseline baseline.json] [--threshold percent]\n";
+        return 1;
+    }
+    if (output_file.empty()) output_file = label + ".json";
+
+    std::vector<Result> results;
+    ASGraph graph;
+
+    // Graph construction and validation run once; they change the graph
+    bool parsed = false;
+    Result parse = measure("parse_caida", "edges", [&]() { parsed = parse_caida(rel_file, graph); return uint64_t(0); });
+    if (!parsed) return 1;
+    results.push_back(measure("freeze", "edges", [&]() {
+        graph.freeze();
+        return static_cast<uint64_t>(graph.getNumProviderEdges() + graph.getNumPeerEdges());
+    }));
+    parse.items = results.back().items;
+    results.insert(results.begin(), parse);
+
+    bool cyclic = false;
+    results.push_back(measure("detectProviderCycles", "nodes", [&]() {
+        cyclic = graph.detectProviderCycles();
+        return static_cast<uint64_t>(graph.getNumNodes());
+    }));
+    if (cyclic) {
+        std::cerr << "Error: provider cycle in " << rel_file << "\n";
+        return 1;
+    }
+    results.push_back(measure("getRankedASes", "nodes", [&]() {
+        graph.getRankedASes();
+        return static_cast<uint64_t>(graph.getNumNodes());
+    }));
+
+    PropagationEngine engine(graph);
+    engine.set_verbose(false);
+    PrefixTable prefixes;
+    uint64_t announcements = 0;
+    results.push_back(measure("load_announcements", "announcements", [&]() {
+        announcements = load_inputs(ann_file, rov_file, num_threads, graph, engine, prefixes);
+        return announcements;
+    }));
+
+    // Propagation and output are repeated on the reset engine; the fastest run is kept
+    Result best_run, best_write;
+    PhaseTimes best_phases;
+    for (size_t run = 0; run < repeat; ++run) {
+        if (run > 0) engine.reset();
+        Result r = measure("propagation", "announcements", [&]() {
+            engine.run_propagation(num_threads, mode);
+            return announcements;
+        });
+        if (run == 0 || r.seconds < best_run.seconds) {
+            best_run = r;
+            best_phases = engine.last_phase_times();
+        }
+
+        Result w = measure("write_ribs_csv", "rows", [&]() {
+            uint64_t rows = 0;
+            write_ribs_csv(engine, prefixes, rib_file, num_threads, OutputCompression::NONE, &rows);
+            return rows;
+        });
+        if (run == 0 || w.seconds < best_write.seconds) best_write = w;
+    }
+    std::remove(rib_file.c_str());
+
+    if (mode == EngineMode::NODE_MAJOR) {
+        const std::pair<const char*, double> phases[] = {
+            {"propagate_up", best_phases.up},
+            {"propagate_across", best_phases.across},
+            {"propagate_down", best_phases.down},
+        };
+        for (const auto& [name, seconds] : phases) {
+            Result r;
+            r.name = name;
+            r.seconds = seconds;
+            r.items = announcements;
+            r.unit = "announcements";
+            r.peak_rss_kb = best_run.peak_rss_kb;
+            results.push_back(r);
+        }
+    }
+    results.push_back(best_run);
+    results.push_back(best_write);
+
+    const std::string engine_name = mode == EngineMode::PREFIX_MAJOR ? "prefix" : "node";
+    if (!write_json(output_file, label, num_threads, engine_name, repeat, results)) {
+        return 1;
+    }
+
+    std::unordered_map<std::string, double> baseline;
+    if (!baseline_file.empty() && !read_baseline(baseline_file, baseline)) {
+        return 1;
+    }
+
+    // Phases under a millisecond are too noisy to gate on
+    constexpr double NOISE_FLOOR_SECONDS = 0.001;
+    int regressions = 0;
+    std::printf("\n%-22s %12s %16s %14s %12s %10s\n", "phase", "seconds", "per_second", "allocations", "peak_rss_kb", "vs_base");
+    for (const Result& r : results) {
+        char alloc[32] = "-";
+        if (r.has_allocations) std::snprintf(alloc, sizeof(alloc), "%llu", static_cast<unsigned long long>(r.allocations));
+        char change[32] = "";
+        auto it = baseline.find(r.name);
+        if (it != baseline.end() && it->second > 0) {
+            const double percent = (r.seconds - it->second) / it->second * 100.0;
+            const bool regressed = percent > threshold && r.seconds - it->second > NOISE_FLOOR_SECONDS;
+            std::snprintf(change, sizeof(change), "%+.1f%%%s", percent, regressed ? " !" : "");
+            regressions += regressed;
+        }
+        std::printf("%-22s %12.6f %16.1f %14s %12ld %10s\n", r.name.c_str(), r.seconds,
+                    r.seconds > 0 ? r.items / r.seconds : 0.0, alloc, r.peak_rss_kb, change);
+    }
+    std::printf("\nResults written to %s\n", output_file.c_str());
+
+    if (regressions > 0) {
+        std::printf("REGRESSION: %d phase(s) slower than %s by more than %.1f%%\n", regressions, baseline_file.c_str(), threshold);
+        return 2;
+    }
+    return 0;
+}
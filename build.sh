@@ -1,2 +1,2 @@
 #!/bin/bash
-c++ src/*.cpp -Iinclude -o program.out -std=c++17 -lcurl
+c++ src/*.cpp -Iinclude -o program.out -std=c++17 -pthread -lbz2 -lz -lcurl
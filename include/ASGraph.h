@@ -1,54 +1,171 @@
-#pragma once
-#include <vector>
-#include <unordered_map>
-#include <memory>
-#include <iostream>
-#include <cstdint>
-#include "Policy.h"
-
-// Represents a single Autonomous System (Node)
-struct ASNode {
-    uint32_t asn; //
-
-    // Relationships
-    // Using raw pointers for edges to avoid circular dependency overhead
-    // The Graph class owns the memory via shared_ptr.
-    std::vector<ASNode*> providers; 
-    std::vector<ASNode*> customers;
-    std::vector<ASNode*> peers;
-
-    // Each AS has a BGP policy to manage announcements
-    std::shared_ptr<Policy> policy;
-
-    int propagation_rank;
-
-    ASNode(uint32_t id) : asn(id), policy(std::make_shared<BGP>()), propagation_rank(-1) {}
-};
-
-class ASGraph {
-private:
-    // Main storage: Map ASN -> Shared Pointer to Node
-    std::unordered_map<uint32_t, std::shared_ptr<ASNode>> nodes;
-
-    // Helper for cycle detection
-    bool hasProviderCycleDFS(ASNode* node, std::unordered_map<uint32_t, bool>& visited, std::unordered_map<uint32_t, bool>& recursionStack);
-
-public:
-    // Get or create a node
-    ASNode* getOrCreateNode(uint32_t asn);
-
-    // Add a relationship line from CAIDA
-    void addRelationship(uint32_t as1, uint32_t as2, int relationship);
-
-    // Check for provider cycles
-    bool detectProviderCycles();
-    
-    // Flatten the graph into ranks for propagation
-    std::vector<std::vector<ASNode*>> getRankedASes();
-
-    // Get total node count (for verification)
-    size_t getNumNodes() const { return nodes.size(); }
-
-    // Get a const reference to the nodes map for iteration
-    const std::unordered_map<uint32_t, std::shared_ptr<ASNode>>& getNodes() const { return nodes; }
-};
\ No newline at end of file
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+#include <cstdint>
+#include <utility>
+#include <string>
+#include <memory>
+#include "Policy.h"
+#include "MemoryAccounting.h"
+#include "FlatArray.h"
+
+class MappedFile;
+
+struct CaidaMetadata;
+
+// Represents a single Autonomous System (Node)
+struct ASNode {
+    uint32_t asn; //
+
+    // Dense index of this node inside the graph (0..N-1).
+    // All adjacency is stored in the graph's CSR arrays in terms of these indices.
+    uint32_t index;
+
+    // Policies are bitsets on the graph (ASGraph::getPolicies); RIB state is held by the PropagationEngine
+    int32_t propagation_rank;
+
+    ASNode(uint32_t id, uint32_t idx) : asn(id), index(idx), propagation_rank(-1) {}
+};
+
+// Graph snapshots store nodes as these exact 12-byte records
+static_assert(sizeof(ASNode) == 12, "ASNode layout is part of the graph snapshot format");
+
+// A contiguous run of neighbor indices inside a CSR array
+struct NeighborRange {
+    const uint32_t* first;
+    const uint32_t* last;
+
+    const uint32_t* begin() const { return first; }
+    const uint32_t* end() const { return last; }
+    size_t size() const { return static_cast<size_t>(last - first); }
+    bool empty() const { return first == last; }
+};
+
+// Compressed sparse row adjacency for one relationship type.
+// The neighbors of node i are targets[offsets[i] .. offsets[i + 1]).
+struct CSRAdjacency {
+    FlatArray<uint32_t> offsets;
+    FlatArray<uint32_t> targets;
+
+    NeighborRange neighbors(uint32_t i) const {
+        return {targets.data() + offsets[i], targets.data() + offsets[i + 1]};
+    }
+    size_t numEdges() const { return targets.size(); }
+};
+
+class ASGraph {
+private:
+    // Main storage: nodes in dense index order.
+    // Adding a node may move the others, so callers keep indices, not pointers.
+    FlatArray<ASNode> nodes;
+
+    // ASN -> dense index: sorted ASNs and the index of each, searched by
+    // binary search. Nodes created since the last freeze() wait in a hash map
+    // until freeze() sorts them in, so hashing only happens while the graph
+    // is being built.
+    FlatArray<uint32_t> sorted_asns;
+    FlatArray<uint32_t> sorted_indices;
+    std::unordered_map<uint32_t, uint32_t> unsorted_asns;
+
+    // Which policy each node runs, as bitsets over dense indices
+    PolicyAssignment policies;
+
+    // Edges collected by addRelationship(), consumed by freeze()
+    // Provider edges are stored as (customer, provider), peer edges in both directions.
+    std::vector<std::pair<uint32_t, uint32_t>> pending_provider_edges;
+    std::vector<std::pair<uint32_t, uint32_t>> pending_peer_edges;
+
+    // Frozen adjacency, one CSR array per relationship type
+    CSRAdjacency provider_adj;
+    CSRAdjacency customer_adj;
+    CSRAdjacency peer_adj;
+    bool frozen = false;
+
+    // Results that stay valid until the topology changes
+    bool acyclic = false;      // detectProviderCycles() found no cycle
+    bool ranks_valid = false;  // every node's propagation_rank is current
+
+    // Mapped snapshot that the arrays above view after load_graph_snapshot()
+    std::shared_ptr<MappedFile> snapshot;
+
+    // Drop cached results after a topology change
+    void invalidate() { frozen = false; acyclic = false; ranks_valid = false; }
+
+    // Dense index of an ASN, or NO_INDEX
+    uint32_t lookupIndex(uint32_t asn) const;
+
+    // Rebuild the sorted ASN arrays from every node and empty unsorted_asns
+    void indexAsns();
+
+    // Rank every node (Kahn's algorithm over dense indices). Returns false if a
+    // provider cycle left some nodes unranked; `ranked` marks the ones reached.
+    bool assignRanks(std::vector<char>* ranked = nullptr);
+
+    // Snapshot I/O (GraphSnapshot.h) writes the arrays out and adopts them on load
+    friend bool save_graph_snapshot(ASGraph& graph, const std::string& path, const CaidaMetadata* metadata);
+    friend bool load_graph_snapshot(const std::string& path, ASGraph& graph, CaidaMetadata* metadata);
+
+public:
+    // Get or create a node. The pointer is valid until the next node is added.
+    ASNode* getOrCreateNode(uint32_t asn);
+
+    static constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+    // Look up a node without creating it; nullptr if the ASN is not in the graph
+    const ASNode* findNode(uint32_t asn) const;
+
+    // Policy of a node by dense index (BGP unless set otherwise)
+    PolicyKind getPolicy(uint32_t index) const { return policies.kind(index); }
+    void setPolicy(uint32_t index, PolicyKind kind) { policies.assign(index, kind); }
+
+    // Every node's policy as membership bitsets
+    const PolicyAssignment& getPolicies() const { return policies; }
+    PolicyAssignment& getPolicies() { return policies; }
+
+    // Add a relationship line from CAIDA
+    void addRelationship(uint32_t as1, uint32_t as2, int relationship);
+
+    // Pre-size the pending edge lists for about `count` more relationships
+    void reserveEdges(size_t count);
+
+    // Build the CSR adjacency from all relationships added so far, and sort
+    // any new ASNs into the ASN index.
+    // Duplicate edges are removed here. Cheap no-op if nothing changed since the last call.
+    void freeze();
+    bool isFrozen() const { return frozen; }
+
+    // Neighbor lists by dense index (valid after freeze())
+    NeighborRange providers(uint32_t index) const { return provider_adj.neighbors(index); }
+    NeighborRange customers(uint32_t index) const { return customer_adj.neighbors(index); }
+    NeighborRange peers(uint32_t index) const { return peer_adj.neighbors(index); }
+
+    // Access a node by dense index
+    ASNode& node(uint32_t index) { return nodes[index]; }
+    const ASNode& node(uint32_t index) const { return nodes[index]; }
+
+    // Check for provider cycles, printing every cycle found. Shares one pass with
+    // ranking and is answered from cache if the graph was already validated.
+    bool detectProviderCycles();
+
+    // Every provider cycle as a strongly connected component (sorted ASNs); empty if acyclic
+    std::vector<std::vector<uint32_t>> findProviderCycles();
+
+    // Flatten the graph into ranks (lists of dense indices) for propagation.
+    // Ranks are recomputed only if the topology changed since the last call.
+    std::vector<std::vector<uint32_t>> getRankedASes();
+
+    // Get total node count (for verification)
+    size_t getNumNodes() const { return nodes.size(); }
+
+    // Number of unique provider->customer and peer (undirected) edges after freeze()
+    size_t getNumProviderEdges() const { return provider_adj.numEdges(); }
+    size_t getNumPeerEdges() const { return peer_adj.numEdges() / 2; }
+
+    // Get the nodes in dense index order for iteration
+    const FlatArray<ASNode>& getNodes() const { return nodes; }
+    FlatArray<ASNode>& getNodes() { return nodes; }
+
+    // Append the bytes held by the nodes, the ASN index and the adjacency arrays
+    void reportMemory(MemoryUsage& out) const;
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// Handle to a node in an ASPathTree
+using PathHandle = uint32_t;
+
+/**
+ * Shared persistent AS-path tree.
+ *
+ * Every path is a node holding one ASN and a parent link to the rest of the
+ * path (towards the origin). Extending a path with a new leading ASN is a
+ * single interned child lookup, so identical paths share one node and an
+ * Announcement only needs to carry a handle plus the path length.
+ *
+ * Walking parent links from a handle yields the path in output order
+ * (receiving AS first, origin last).
+ *
+ * Nodes live in fixed-size blocks. Each writer (one per propagation thread)
+ * bump-allocates from blocks it owns and keeps its own intern table, so
+ * threads can extend paths concurrently without locks as long as each
+ * writer id is used by one thread at a time. Paths created by one writer
+ * are readable by others once the threads have synchronized.
+ */
+class ASPathTree {
+public:
+    // Handle of the empty path (the root every path hangs off)
+    static constexpr PathHandle EMPTY = 0;
+
+private:
+    struct Node {
+        uint32_t asn;
+        PathHandle parent;
+    };
+
+    static constexpr uint32_t BLOCK_BITS = 16;
+    static constexpr uint32_t BLOCK_SIZE = 1u << BLOCK_BITS;
+    static constexpr uint32_t MAX_BLOCKS = 1u << (32 - BLOCK_BITS);
+
+    struct Writer {
+        // Next free handle and end of the writer's current block
+        PathHandle next = EMPTY;
+        PathHandle end = EMPTY;
+
+        // Open-addressing intern table over (parent, asn); EMPTY marks a free slot
+        std::vector<PathHandle> slots;
+        size_t count = 0;
+    };
+
+    // Block directory, sized once so blocks can be published while others read
+    std::vector<std::unique_ptr<Node[]>> blocks;
+    std::atomic<uint32_t> num_blocks{0};
+    std::vector<Writer> writers;
+
+    static size_t hash(PathHandle parent, uint32_t asn) {
+        uint64_t key = (static_cast<uint64_t>(parent) << 32) | asn;
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return static_cast<size_t>(key);
+    }
+
+    Node& node(PathHandle h) { return blocks[h >> BLOCK_BITS][h & (BLOCK_SIZE - 1)]; }
+    const Node& node(PathHandle h) const { return blocks[h >> BLOCK_BITS][h & (BLOCK_SIZE - 1)]; }
+
+    // Hand a fresh block to the writer
+    void new_block(Writer& w);
+
+    // Rebuild a writer's intern table with num_slots slots (a power of two)
+    void rehash(Writer& w, size_t num_slots);
+
+public:
+    explicit ASPathTree(size_t num_writers = 1);
+
+    ASPathTree(const ASPathTree&) = delete;
+    ASPathTree& operator=(const ASPathTree&) = delete;
+
+    // Returns the path "asn, <parent path>", creating it only if this writer has not seen it
+    PathHandle extend(PathHandle parent, uint32_t asn, size_t writer = 0);
+
+    uint32_t asn(PathHandle h) const { return node(h).asn; }
+    PathHandle parent(PathHandle h) const { return node(h).parent; }
+
+    // Materialize a path (receiving AS first, origin last)
+    std::vector<uint32_t> to_vector(PathHandle h) const;
+
+    // Make sure at least n writers exist. Existing handles stay valid.
+    // Not safe to call while other threads are extending paths.
+    void set_num_writers(size_t n);
+    size_t num_writers() const { return writers.size(); }
+
+    // Drop every path except EMPTY (start of a new run)
+    void clear();
+
+    // Number of distinct paths stored (including EMPTY)
+    size_t size() const;
+
+    // Every handle issued so far is below this bound (for handle-indexed side tables)
+    size_t handle_limit() const { return static_cast<size_t>(num_blocks.load(std::memory_order_relaxed)) << BLOCK_BITS; }
+
+    // Heap bytes of the allocated blocks, the block directory and the intern tables
+    uint64_t memory_bytes() const;
+};
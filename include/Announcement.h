@@ -1,37 +1,74 @@
 #pragma once
 
-#include <string>
-#include <vector>
 #include <cstdint>
+#include <iostream>
+#include <type_traits>
+#include "ASPath.h"
 
 // Enum for the relationship from which an announcement is received
-enum class Relationship {
+enum class Relationship : uint8_t {
     PROVIDER,
     PEER,
     CUSTOMER,
     ORIGIN // Special case for the origin of the announcement
 };
 
+// Longest AS path an Announcement can carry (path_length is 16 bits)
+constexpr uint32_t MAX_PATH_LENGTH = UINT16_MAX;
+
+// Relationship score for best path selection: Origin > Customer > Peer > Provider,
+// which is the enum order. 0 is left free so no real route has key 0.
+constexpr uint64_t relationship_score(Relationship rel) { return static_cast<uint64_t>(rel) + 1; }
+
+// Preference key of no route at all; every real route's key is greater
+constexpr uint64_t NO_ROUTE_KEY = 0;
+
+/**
+ * The three best path selection rules folded into one integer, so the better
+ * of two routes is simply the one with the larger key:
+ * 1. Relationship score (bits 48-50, higher is better)
+ * 2. AS path length (bits 32-47, inverted: shorter is better)
+ * 3. Next hop ASN (bits 0-31, inverted: lower is better)
+ * Two routes tie only if all three rules tie.
+ */
+inline uint64_t preference_key(Relationship rel, uint32_t path_length, uint32_t next_hop_asn) {
+    return (relationship_score(rel) << 48) |
+           (static_cast<uint64_t>(MAX_PATH_LENGTH - path_length) << 32) |
+           static_cast<uint64_t>(~next_hop_asn);
+}
+
+// The relationship and path length a preference key was built from
+inline Relationship key_relationship(uint64_t key) { return static_cast<Relationship>((key >> 48) - 1); }
+inline uint32_t key_path_length(uint64_t key) { return MAX_PATH_LENGTH - static_cast<uint32_t>((key >> 32) & 0xFFFF); }
+
+// One route, packed into 16 bytes with no heap storage: RIBs and pending
+// routes hold these by value and every send copies one
 struct Announcement {
-    std::string prefix;
-    std::vector<uint32_t> as_path;
+    uint32_t prefix_id;  // Dense id from PrefixTable; the text form is only needed at output time
+    PathHandle as_path;  // Node in the run's ASPathTree (this AS first, origin last)
     uint32_t next_hop_asn;
+    uint16_t path_length;
     Relationship received_from_relationship;
     bool rov_invalid;  // True if this announcement is invalid according to ROV
 
     // Default constructor
-    Announcement() : next_hop_asn(0), received_from_relationship(Relationship::ORIGIN), rov_invalid(false) {}
+    Announcement() : prefix_id(0), as_path(ASPathTree::EMPTY), next_hop_asn(0), path_length(0), received_from_relationship(Relationship::ORIGIN), rov_invalid(false) {}
 
     // Parameterized constructor for convenience
-    Announcement(const std::string& _prefix, const std::vector<uint32_t>& _as_path, uint32_t _next_hop_asn, Relationship _rel, bool _rov_invalid = false)
-        : prefix(_prefix), as_path(_as_path), next_hop_asn(_next_hop_asn), received_from_relationship(_rel), rov_invalid(_rov_invalid) {}
+    Announcement(uint32_t _prefix_id, PathHandle _as_path, uint16_t _path_length, uint32_t _next_hop_asn, Relationship _rel, bool _rov_invalid = false)
+        : prefix_id(_prefix_id), as_path(_as_path), next_hop_asn(_next_hop_asn), path_length(_path_length), received_from_relationship(_rel), rov_invalid(_rov_invalid) {}
+
+    uint64_t preference() const { return preference_key(received_from_relationship, path_length, next_hop_asn); }
 
     // A helper to print the announcement for debugging
-    void print() const {
-        std::cout << "Prefix: " << prefix << ", Path: ";
-        for (size_t i = 0; i < as_path.size(); ++i) {
-            std::cout << as_path[i] << (i < as_path.size() - 1 ? "-" : "");
+    void print(const ASPathTree& paths) const {
+        std::cout << "Prefix ID: " << prefix_id << ", Path: ";
+        for (PathHandle h = as_path; h != ASPathTree::EMPTY; h = paths.parent(h)) {
+            std::cout << paths.asn(h) << (paths.parent(h) != ASPathTree::EMPTY ? "-" : "");
         }
         std::cout << ", Next Hop: " << next_hop_asn << std::endl;
     }
 };
+
+static_assert(sizeof(Announcement) == 16, "Announcement should stay a 16-byte record");
+static_assert(std::is_trivially_copyable<Announcement>::value, "Announcement is copied on every send");
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <memory_resource>
+#include <initializer_list>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Fixed-size memory blocks shared by the arenas of one engine.
+ *
+ * Blocks handed back by one arena are reused by the next one that needs a
+ * block, so the memory of routes that were pending in one rank is refilled
+ * with RIB entries or with the next rank's pending routes. Spare blocks are
+ * freed by trim() or with the pool. Thread-safe (a lock per 256 KB block
+ * taken or returned).
+ */
+class BlockPool {
+public:
+    static constexpr size_t BLOCK_SIZE = size_t(256) << 10;
+
+    BlockPool() = default;
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+
+    char* acquire();
+
+    // Return blocks for reuse; empties `blocks`
+    void give_back(std::vector<char*>& blocks);
+
+    // Free spare blocks until at most max_spare are left
+    void trim(size_t max_spare);
+
+    // Every block allocated so far, and the ones not held by any arena
+    uint64_t bytes_reserved() const;
+    uint64_t bytes_spare() const;
+
+private:
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<char[]>> owned;
+    std::vector<char*> spare;
+};
+
+/**
+ * Monotonic bump allocator for per-run route state.
+ *
+ * Allocations are carved from pool blocks and never freed one by one.
+ * reset() rewinds to the first block in O(1) and keeps the blocks for the
+ * next fill (scenario runs, per-node scratch tables); release() returns
+ * them to the pool. Requests too large for a block get their own
+ * allocation, freed by either call.
+ *
+ * Used through std::pmr containers. Not thread-safe: one writer at a time
+ * (see ArenaSet for per-thread arenas).
+ */
+class Arena : public std::pmr::memory_resource {
+public:
+    explicit Arena(BlockPool& pool) : pool(pool) {}
+    ~Arena() override { release(); }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Forget every allocation. Nothing allocated before may be used afterwards.
+    void reset();
+    void release();
+
+    // Bytes of blocks currently held (used or not)
+    uint64_t bytes_reserved() const;
+
+private:
+    BlockPool& pool;
+    std::vector<char*> blocks;
+    std::vector<std::unique_ptr<char[]>> oversized;
+    uint64_t oversized_bytes = 0;
+
+    // Block being carved and the free range left in it
+    size_t current = 0;
+    char* next = nullptr;
+    char* end = nullptr;
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+/**
+ * One Arena per writer thread behind a single memory resource.
+ *
+ * Each allocation goes to the arena of the calling thread's writer id for
+ * this set, set with WriterScope (0 outside any scope naming the set).
+ * Containers bound to the set can therefore be filled from several threads
+ * without locks, as long as each writer id is used by one thread at a time.
+ * This is the same contract as ASPathTree writers, and the engine uses the
+ * same ids for both.
+ */
+class ArenaSet : public std::pmr::memory_resource {
+public:
+    explicit ArenaSet(BlockPool& pool) : pool(pool) { set_num_writers(1); }
+
+    ArenaSet(const ArenaSet&) = delete;
+    ArenaSet& operator=(const ArenaSet&) = delete;
+
+    // Makes this thread allocate from `sets` as `writer` until the scope ends.
+    // Scopes nest per thread, so engines sharing a thread keep their own ids.
+    class WriterScope {
+        static constexpr size_t MAX_SETS = 4;
+
+        const WriterScope* outer;
+        const ArenaSet* sets[MAX_SETS];
+        size_t num_sets = 0;
+        size_t writer;
+
+        friend class ArenaSet;
+
+    public:
+        WriterScope(std::initializer_list<ArenaSet*> scoped, size_t writer);
+        ~WriterScope();
+        WriterScope(const WriterScope&) = delete;
+        WriterScope& operator=(const WriterScope&) = delete;
+    };
+
+    // Make sure at least n writers exist. Not safe while others allocate.
+    void set_num_writers(size_t n);
+    size_t num_writers() const { return arenas.size(); }
+
+    // Rewind every writer's arena (keeping blocks), or just one writer's
+    void reset();
+    void reset(size_t writer) { arenas[writer]->reset(); }
+
+    // Hand every writer's blocks back to the pool
+    void release();
+
+    uint64_t bytes_reserved() const;
+
+private:
+    // Innermost WriterScope of the calling thread
+    static thread_local const WriterScope* innermost;
+
+    BlockPool& pool;
+    std::vector<std::unique_ptr<Arena>> arenas;
+
+    // The calling thread's writer id for this set
+    size_t current_writer() const;
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
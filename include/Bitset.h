@@ -0,0 +1,71 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "MemoryAccounting.h"
+
+// One bit per dense node index, used for policy membership (see
+// PolicyAssignment). Bits past size() read as clear, and set() grows the set,
+// so a bitset never has to be resized when the graph gains nodes.
+class DenseBitset {
+    std::vector<uint64_t> words;
+    size_t bits = 0;
+
+public:
+    DenseBitset() = default;
+    explicit DenseBitset(size_t n) { resize(n); }
+
+    // Grow or shrink to n bits; new bits are clear
+    void resize(size_t n) {
+        words.resize((n + 63) / 64, 0);
+        if (n % 64 && !words.empty()) words.back() &= (uint64_t(1) << (n % 64)) - 1;
+        bits = n;
+    }
+    size_t size() const { return bits; }
+
+    bool test(size_t i) const { return i < bits && (words[i / 64] >> (i % 64) & 1); }
+
+    void set(size_t i) {
+        if (i >= bits) resize(i + 1);
+        words[i / 64] |= uint64_t(1) << (i % 64);
+    }
+    void reset(size_t i) {
+        if (i < bits) words[i / 64] &= ~(uint64_t(1) << (i % 64));
+    }
+    void clear() { words.assign(words.size(), 0); }
+
+    // Set every bit that is set in other, growing to its size if needed
+    void merge(const DenseBitset& other) {
+        if (other.bits > bits) resize(other.bits);
+        for (size_t w = 0; w < other.words.size(); ++w) words[w] |= other.words[w];
+    }
+
+    size_t count() const {
+        size_t total = 0;
+        for (uint64_t word : words) total += static_cast<size_t>(__builtin_popcountll(word));
+        return total;
+    }
+
+    // Call f(index) for every set bit, in increasing order
+    template <typename F>
+    void for_each(F&& f) const {
+        for (size_t w = 0; w < words.size(); ++w) {
+            for (uint64_t word = words[w]; word; word &= word - 1) {
+                f(w * 64 + static_cast<size_t>(__builtin_ctzll(word)));
+            }
+        }
+    }
+
+    // Same bits set, regardless of size()
+    bool operator==(const DenseBitset& other) const {
+        const std::vector<uint64_t>& shorter = words.size() < other.words.size() ? words : other.words;
+        const std::vector<uint64_t>& longer = words.size() < other.words.size() ? other.words : words;
+        for (size_t w = 0; w < longer.size(); ++w) {
+            if (longer[w] != (w < shorter.size() ? shorter[w] : 0)) return false;
+        }
+        return true;
+    }
+    bool operator!=(const DenseBitset& other) const { return !(*this == other); }
+
+    uint64_t memory_bytes() const { return vector_bytes(words); }
+};
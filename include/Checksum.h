@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+// Starting value for checksum_words (the FNV-1a 64-bit offset basis)
+constexpr uint64_t CHECKSUM_SEED = 0xcbf29ce484222325ULL;
+
+// FNV-1a over 64-bit words, used to guard the binary file formats.
+// A trailing partial word is zero padded, so hashing a section and then its
+// padding gives the same result as hashing the padded bytes in one call.
+inline uint64_t checksum_words(uint64_t hash, const void* data, size_t bytes) {
+    const char* p = static_cast<const char*>(data);
+    for (size_t i = 0; i < bytes / 8; ++i, p += 8) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        hash ^= word;
+        hash *= 0x100000001b3ULL;
+    }
+    if (bytes % 8) {
+        uint64_t word = 0;
+        std::memcpy(&word, p, bytes % 8);
+        hash ^= word;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Sections of the binary formats are padded to whole 64-bit words
+inline size_t padded_size(size_t bytes) { return (bytes + 7) & ~size_t(7); }
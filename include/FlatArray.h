@@ -0,0 +1,79 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include "MemoryAccounting.h"
+
+// A contiguous array that either owns its elements (a std::vector) or views
+// memory owned by someone else, such as a mapped graph snapshot. A view is
+// read and written in place; the first call that changes the size copies it
+// into owned storage. Copying a FlatArray always copies the elements.
+template <typename T>
+class FlatArray {
+private:
+    std::vector<T> owned;
+    T* view = nullptr;   // Borrowed elements, or nullptr when `owned` is in use
+    size_t view_size = 0;
+
+    // Move a view into owned storage before a size change
+    void own() {
+        if (!view) return;
+        owned.assign(view, view + view_size);
+        view = nullptr;
+        view_size = 0;
+    }
+
+public:
+    FlatArray() = default;
+    FlatArray(const FlatArray& other) : owned(other.begin(), other.end()) {}
+    FlatArray(FlatArray&&) noexcept = default;
+    FlatArray& operator=(FlatArray&&) noexcept = default;
+    FlatArray& operator=(const FlatArray& other) {
+        if (this != &other) {
+            owned.assign(other.begin(), other.end());
+            view = nullptr;
+            view_size = 0;
+        }
+        return *this;
+    }
+
+    // View `count` elements at `data`, which must outlive this array (or its next resize)
+    void adopt(T* data, size_t count) {
+        std::vector<T>().swap(owned);
+        view = count ? data : nullptr;
+        view_size = count;
+    }
+    bool borrowed() const { return view != nullptr; }
+
+    T* data() { return view ? view : owned.data(); }
+    const T* data() const { return view ? view : owned.data(); }
+    size_t size() const { return view ? view_size : owned.size(); }
+    bool empty() const { return size() == 0; }
+
+    T& operator[](size_t i) { return data()[i]; }
+    const T& operator[](size_t i) const { return data()[i]; }
+    T& back() { return data()[size() - 1]; }
+    const T& back() const { return data()[size() - 1]; }
+
+    T* begin() { return data(); }
+    T* end() { return data() + size(); }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + size(); }
+
+    template <typename... Args>
+    T& emplace_back(Args&&... args) {
+        own();
+        owned.emplace_back(std::forward<Args>(args)...);
+        return owned.back();
+    }
+    void resize(size_t count) { own(); owned.resize(count); }
+    void resize(size_t count, const T& value) { own(); owned.resize(count, value); }
+    void assign(size_t count, const T& value) {
+        view = nullptr;
+        view_size = 0;
+        owned.assign(count, value);
+    }
+
+    // Heap bytes of the owned buffer; a view costs none
+    uint64_t heap_bytes() const { return vector_bytes(owned); }
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include "ASGraph.h"
+#include "parse_caida.h"
+
+/**
+ * Binary graph snapshot (--save-graph / --load-graph)
+ *
+ * A snapshot stores a frozen, validated graph so later runs can skip parsing,
+ * cycle detection and ranking. The file is a fixed header followed by flat
+ * arrays, each padded to 8 bytes so the whole file can be mmap'd and used in
+ * place: after validation the graph views these arrays directly.
+ *
+ *   node[N]                      ASNode  asn, dense index, propagation rank
+ *   sorted asn[N]                uint32  every ASN in ascending order
+ *   sorted index[N]              uint32  dense index of each sorted ASN
+ *   provider offsets[N+1], targets[E]    CSR, customer -> provider
+ *   customer offsets[N+1], targets[E]    CSR, provider -> customer
+ *   peer offsets[N+1], targets[P]        CSR, both directions
+ *   metadata                     CAIDA comment lines joined by '\n'
+ *
+ * Values are in host byte order; the magic and version reject foreign files
+ * and a 64-bit checksum over everything after the header rejects damaged ones.
+ */
+
+constexpr uint32_t GRAPH_SNAPSHOT_VERSION = 2;
+
+// Header flags
+enum SnapshotFlags : uint32_t {
+    SNAPSHOT_ACYCLIC = 1u << 0,  // Provider graph was validated to have no cycles
+    SNAPSHOT_RANKED = 1u << 1    // Rank array holds valid propagation ranks
+};
+
+struct GraphSnapshotHeader {
+    char magic[8];               // "BGPGRAPH"
+    uint32_t version;
+    uint32_t flags;              // SnapshotFlags
+    uint64_t num_nodes;
+    uint64_t num_provider_edges; // Entries in each provider/customer target array
+    uint64_t num_peer_edges;     // Entries in the peer target array (two per peering)
+    uint64_t metadata_bytes;
+    uint64_t checksum;           // Over all bytes after the header
+};
+
+// Freeze and rank the graph, then write it to path. Returns false on I/O error.
+bool save_graph_snapshot(ASGraph& graph, const std::string& path, const CaidaMetadata* metadata = nullptr);
+
+// Replace the contents of graph with the snapshot at path, which stays mapped
+// until the graph is destroyed or replaced. On failure an error is printed,
+// false is returned and graph is left unchanged.
+bool load_graph_snapshot(const std::string& path, ASGraph& graph, CaidaMetadata* metadata = nullptr);
@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include "ASGraph.h"
+#include "Prefix.h"
+#include "Propagation.h"
+
+/**
+ * Loaders for the announcement (anns.csv) and ROV ASN inputs.
+ *
+ * Files are mmap'd; a path of "-" reads stdin instead, block by block as it
+ * arrives, so generated inputs can be piped in. Each block is split into
+ * line-aligned chunks that a pointer-scanning tokenizer parses in parallel on
+ * num_threads threads (prefixes included). The rows are then applied in file
+ * order, so node creation order, prefix ids and warnings are exactly those
+ * of reading the file line by line.
+ *
+ * Both return false (after printing an error) only if the input cannot be
+ * read; malformed lines are reported as warnings and skipped.
+ */
+
+/**
+ * anns.csv: seed_asn,prefix,rov_invalid. The first line is a header and is
+ * always skipped. Fields are trimmed, rov_invalid is True, true or 1 for
+ * invalid, and columns past the third are ignored. Seeds the engine (creating
+ * unknown origin ASes) and interns the prefixes; `seeded` counts the rows used.
+ */
+bool load_announcements(const std::string& path, ASGraph& graph, PropagationEngine& engine, PrefixTable& prefixes,
+                        size_t num_threads, size_t& seeded);
+
+/**
+ * One ROV ASN per line. The first line is skipped as a header if it holds
+ * anything but digits. Marks each ASN as ROV in the graph's policies,
+ * creating ASes that are not in the graph.
+ */
+bool load_rov_asns(const std::string& path, ASGraph& graph, size_t num_threads);
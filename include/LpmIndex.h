@@ -0,0 +1,125 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "Prefix.h"
+#include "Policy.h"
+#include "MemoryAccounting.h"
+
+class RibBinaryReader;
+
+/**
+ * Longest-prefix-match index over a prefix set (prefix id = position), one
+ * trie for IPv4 and one for IPv6, built once after propagation and shared by
+ * every AS.
+ *
+ * Each trie is a Poptrie: nodes consume 6 address bits (64 slots) and store
+ * two bitmaps instead of slot arrays. `children` marks the slots with a child
+ * node, and the children of a node are stored contiguously, so a child is
+ * found by popcount. The other slots hold leaves (the most specific prefix
+ * covering the slot, pushed down from shorter prefixes), and `leaf_starts`
+ * marks where a run of equal leaves begins, so each run is stored once. A
+ * lookup is at most 6 (IPv4) or 22 (IPv6) node visits, each two loads and
+ * a popcount.
+ *
+ * match() returns the most specific prefix covering an address. An AS may
+ * not hold a route for it (e.g. ROV dropped it), so each prefix also knows
+ * the next less specific prefix covering it, and lookups fall back along
+ * that chain until they find a prefix the AS has a route for.
+ */
+class LpmIndex {
+private:
+    static constexpr unsigned STRIDE = 6;
+
+    struct Node {
+        uint64_t children = 0;
+        uint64_t leaf_starts = 0;
+        uint32_t first_leaf = 0;   // Index of this node's first leaf run
+        uint32_t first_child = 0;  // Index of this node's first child
+    };
+
+    struct Trie {
+        std::vector<Node> nodes;       // nodes[0] is the root
+        std::vector<uint32_t> leaves;  // Prefix id per leaf run (NO_MATCH if none covers it)
+    };
+
+    // A prefix with its address as a 128-bit key (hi holds the first 8 bytes)
+    struct Entry {
+        uint64_t hi;
+        uint64_t lo;
+        uint8_t length;
+        uint32_t id;
+    };
+
+    Trie ipv4;
+    Trie ipv6;
+    std::vector<uint32_t> parents;  // Next less specific prefix, or NO_MATCH
+
+    void build_trie(Trie& trie, std::vector<Entry>& entries);
+    void build_node(Trie& trie, uint32_t node, const Entry* first, const Entry* last,
+                    unsigned offset, uint32_t inherited);
+
+public:
+    static constexpr uint32_t NO_MATCH = UINT32_MAX;
+
+    LpmIndex() { build({}); }
+    explicit LpmIndex(const std::vector<Prefix>& prefixes) { build(prefixes); }
+    explicit LpmIndex(const PrefixTable& prefixes);
+
+    // Rebuild over prefixes; prefix ids are positions in the vector
+    void build(const std::vector<Prefix>& prefixes);
+
+    // Most specific prefix covering address (only its address bits are used), or NO_MATCH
+    uint32_t match(const Prefix& address) const;
+
+    // Next less specific prefix covering prefix id, or NO_MATCH
+    uint32_t parent(uint32_t id) const { return parents[id]; }
+
+    // Most specific prefix covering address for which has_route(id) is true, or NO_MATCH
+    template <typename HasRoute>
+    uint32_t match(const Prefix& address, HasRoute&& has_route) const {
+        uint32_t id = match(address);
+        while (id != NO_MATCH && !has_route(id)) id = parents[id];
+        return id;
+    }
+
+    size_t num_nodes() const { return ipv4.nodes.size() + ipv6.nodes.size(); }
+
+    uint64_t memory_bytes() const {
+        return vector_bytes(ipv4.nodes) + vector_bytes(ipv4.leaves) + vector_bytes(ipv6.nodes) +
+               vector_bytes(ipv6.leaves) + vector_bytes(parents);
+    }
+};
+
+// The route an AS with this RIB uses to reach address, or nullptr if it has none
+const Announcement* lookup_route(const LpmIndex& index, const LocalRib& rib, const Prefix& address);
+
+/**
+ * Per-AS route arrays read from a ribs.bin file: the routes of each AS
+ * sorted by prefix id, so the routes an LpmIndex lookup probes are found by
+ * binary search in one contiguous range, with no hash tables to build.
+ */
+class RibRouteArrays {
+private:
+    std::vector<uint32_t> asns;          // Sorted
+    std::vector<uint64_t> offsets;       // Routes of asns[i]: [offsets[i], offsets[i + 1])
+    std::vector<uint32_t> prefix_ids;
+    std::vector<uint32_t> path_ids;
+
+public:
+    static constexpr uint32_t NO_ROUTE = UINT32_MAX;
+    static constexpr size_t NO_AS = SIZE_MAX;
+
+    void build(const RibBinaryReader& reader);
+
+    // Position of the AS in the arrays, or NO_AS if it holds no routes
+    size_t find_as(uint32_t asn) const;
+
+    // Path id (in the reader's path table) of the AS's route for prefix_id, or
+    // NO_ROUTE; like RibBinaryReader::path_id it is the path after the AS itself
+    uint32_t path_of(size_t as_slot, uint32_t prefix_id) const;
+
+    uint64_t memory_bytes() const {
+        return vector_bytes(asns) + vector_bytes(offsets) + vector_bytes(prefix_ids) + vector_bytes(path_ids);
+    }
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Read-only mapping of a whole file. An empty file is valid with data() == nullptr.
+// A copy-on-write mapping may also be modified through mutable_data(); the
+// changes stay private to this process and never reach the file.
+class MappedFile {
+private:
+    char* bytes = nullptr;
+    size_t length = 0;
+    bool valid = false;
+
+public:
+    explicit MappedFile(const std::string& path, bool copy_on_write = false) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+
+        struct stat st;
+        if (::fstat(fd, &st) == 0) {
+            length = static_cast<size_t>(st.st_size);
+            if (length == 0) {
+                valid = true;
+            } else {
+                const int prot = copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ;
+                void* p = ::mmap(nullptr, length, prot, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    // Copy-on-write mappings are kept and read at random afterwards
+                    if (!copy_on_write) ::madvise(p, length, MADV_SEQUENTIAL);
+                    bytes = static_cast<char*>(p);
+                    valid = true;
+                }
+            }
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile() {
+        if (bytes) ::munmap(bytes, length);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool ok() const { return valid; }
+    const char* data() const { return bytes; }
+    char* mutable_data() { return bytes; }
+    size_t size() const { return length; }
+};
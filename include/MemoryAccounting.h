@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+// Bytes held by one data structure, reported by --memory-report
+struct MemoryEntry {
+    std::string name;
+    uint64_t bytes;
+    uint64_t items;  // Elements stored (nodes, routes, paths, ...)
+};
+
+using MemoryUsage = std::vector<MemoryEntry>;
+
+// Heap footprint of one malloc(n) with glibc: an 8-byte header, 16-byte
+// granularity and a 32-byte minimum chunk
+inline uint64_t heap_bytes(uint64_t n) {
+    return n == 0 ? 0 : std::max<uint64_t>(32, (n + 8 + 15) & ~uint64_t(15));
+}
+
+// Heap bytes of a vector's buffer (capacity, not size)
+template <typename T>
+uint64_t vector_bytes(const std::vector<T>& v) {
+    return heap_bytes(v.capacity() * sizeof(T));
+}
+
+// Heap bytes of a libstdc++ unordered_map/set: one node per element (next
+// pointer, value and, for non-trivial hashes, the cached hash) plus the
+// bucket array, which is not allocated while there is a single bucket
+template <typename Map>
+uint64_t hash_table_bytes(const Map& map, bool cached_hash = false) {
+    const uint64_t node = sizeof(void*) + sizeof(typename Map::value_type) + (cached_hash ? sizeof(size_t) : 0);
+    const uint64_t buckets = map.bucket_count() > 1 ? heap_bytes(map.bucket_count() * sizeof(void*)) : 0;
+    return map.size() * heap_bytes(node) + buckets;
+}
+
+// Heap bytes of a string's characters (short strings are stored inline)
+inline uint64_t string_bytes(const std::string& s) {
+    return s.capacity() > 15 ? heap_bytes(s.capacity() + 1) : 0;
+}
@@ -1,37 +1,105 @@
 #pragma once
 
 #include "Announcement.h"
+#include "Bitset.h"
 #include <unordered_map>
+#include <memory_resource>
 #include <vector>
-#include <string>
-#include <memory>
+#include <array>
+#include <cstdint>
 
+// Compact per-AS policy tag; the graph keeps one membership bitset per
+// non-default kind in its PolicyAssignment
+enum class PolicyKind : uint8_t {
+    BGP = 0,
+    ROV = 1
+};
+constexpr size_t NUM_POLICY_KINDS = 2;
+
+// Route filters a policy can enable. The propagation engine keeps one
+// DenseBitset of filtering ASes per flag (filter_sets) and drops any
+// announcement whose route_flags() name a set the receiver belongs to.
+enum FilterFlags : uint8_t {
+    FILTER_NONE = 0,
+    FILTER_ROV_INVALID = 1 << 0
+};
+constexpr size_t NUM_FILTER_FLAGS = 1;
+
+// Filter bits carried by an announcement
+inline uint8_t route_flags(const Announcement& ann) {
+    return ann.rov_invalid ? FILTER_ROV_INVALID : FILTER_NONE;
+}
+
+// The Local RIB stores the best announcement for each prefix.
+// Key: prefix id (see PrefixTable)
+// Value: The best announcement object for that prefix.
+// The engine backs its RIBs with an ArenaSet (see Arena.h).
+using LocalRib = std::pmr::unordered_map<uint32_t, Announcement>;
+
+// Routes received from neighbors but not yet adopted. Incoming announcements
+// are folded into this slot on arrival, so only the best candidate per prefix
+// is ever held.
+// Key: prefix id
+// Value: The best candidate so far (path_length already counts the receiver).
+using PendingRoutes = std::pmr::unordered_map<uint32_t, Announcement>;
+
+// Policies describe how an AS treats incoming announcements. They are
+// stateless: one shared instance per PolicyKind (see policy_for), while the
+// per-AS RIB state lives in the PropagationEngine.
+//
+// To add a policy: add a PolicyKind, a subclass here, its instance in
+// policy_for(), and a FilterFlags bit if it needs a new kind of filter.
 class Policy {
 public:
     virtual ~Policy() = default;
-    // This will be the main interface for processing announcements.
-    // We can add virtual functions here later, for example:
-    // virtual void process_incoming_announcement(const Announcement& ann) = 0;
+    virtual PolicyKind kind() const = 0;
+    virtual const char* name() const = 0;
+
+    // Which FilterFlags this policy drops on arrival
+    virtual uint8_t filter_mask() const { return FILTER_NONE; }
 };
 
 class BGP : public Policy {
 public:
-    // The Local RIB stores the best announcement for each prefix.
-    // Key: prefix (e.g., "8.8.8.0/24")
-    // Value: The best announcement object for that prefix.
-    std::unordered_map<std::string, Announcement> local_rib;
-
-    // The received_queue stores all announcements received from neighbors
-    // before they are processed by the policy.
-    // Key: prefix
-    // Value: A list of all announcements received for that prefix.
-    std::unordered_map<std::string, std::vector<Announcement>> received_queue;
+    PolicyKind kind() const override { return PolicyKind::BGP; }
+    const char* name() const override { return "BGP"; }
 };
 
 // ROV (Route Origin Validation) policy extends BGP
 // ROV ASes drop announcements with rov_invalid=true
 class ROV : public BGP {
 public:
-    // ROV inherits all BGP functionality but filters invalid announcements
-    // This is handled in process_announcements by checking rov_invalid
+    PolicyKind kind() const override { return PolicyKind::ROV; }
+    const char* name() const override { return "ROV"; }
+    uint8_t filter_mask() const override { return FILTER_ROV_INVALID; }
+};
+
+// Shared policy instance for a tag
+const Policy& policy_for(PolicyKind kind);
+
+/**
+ * Which policy every AS runs: one membership bitset per non-default
+ * PolicyKind, indexed by dense node index. An AS in no set runs BGP.
+ *
+ * Changing one AS's policy is a couple of bit operations, and copying an
+ * assignment copies n/64 words per policy, so scenario sweeps and per-engine
+ * overrides are set up with a bitset copy.
+ */
+class PolicyAssignment {
+    std::array<DenseBitset, NUM_POLICY_KINDS> sets;  // sets[BGP] stays empty
+
+public:
+    PolicyKind kind(uint32_t index) const;
+
+    // Move an AS into kind's set (and out of any other)
+    void assign(uint32_t index, PolicyKind kind);
+
+    // Members of a non-default kind, for bulk reads and writes
+    const DenseBitset& members(PolicyKind kind) const { return sets[static_cast<size_t>(kind)]; }
+    DenseBitset& members(PolicyKind kind) { return sets[static_cast<size_t>(kind)]; }
+
+    // ASes whose policy drops routes carrying `flag` (a single FilterFlags bit)
+    DenseBitset filtering(uint8_t flag) const;
+
+    uint64_t memory_bytes() const;
 };
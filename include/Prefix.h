@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include "MemoryAccounting.h"
+
+// Binary form of an IP prefix (address plus length), IPv4 or IPv6
+struct Prefix {
+    // Network byte order. IPv4 uses the first 4 bytes, the rest stay zero.
+    std::array<uint8_t, 16> addr{};
+    uint8_t length = 0;
+    bool is_ipv6 = false;
+
+    bool operator==(const Prefix& other) const {
+        return length == other.length && is_ipv6 == other.is_ipv6 && addr == other.addr;
+    }
+};
+
+struct PrefixHash {
+    size_t operator()(const Prefix& p) const;
+};
+
+/**
+ * Parses "a.b.c.d/len" or an IPv6 "x:y::/len" into binary form.
+ * A missing "/len" is treated as a host prefix (/32 or /128).
+ * Returns false if the text is not a valid prefix.
+ */
+bool parse_prefix(const std::string& text, Prefix& out);
+
+// Same, for the `length` characters at `text` (not NUL-terminated)
+bool parse_prefix(const char* text, size_t length, Prefix& out);
+
+/**
+ * Interns prefixes into dense ids (0..N-1).
+ *
+ * Prefixes are parsed once at seeding time; everything downstream keys on the
+ * integer id. The original text is kept only so output can print it back.
+ */
+class PrefixTable {
+private:
+    std::vector<Prefix> prefixes;
+    std::vector<std::string> texts;
+    std::unordered_map<Prefix, uint32_t, PrefixHash> ids;
+
+public:
+    static constexpr uint32_t INVALID_ID = UINT32_MAX;
+
+    // Returns the id for this prefix, assigning a new one if unseen.
+    // Returns INVALID_ID if the text does not parse.
+    uint32_t intern(const std::string& text);
+
+    // Id for an already parsed prefix; `text` (length bytes) is kept if it is new
+    uint32_t intern(const Prefix& prefix, const char* text, size_t length);
+
+    // Id of an interned prefix, or INVALID_ID if it was never interned
+    uint32_t find(const Prefix& prefix) const {
+        auto it = ids.find(prefix);
+        return it == ids.end() ? INVALID_ID : it->second;
+    }
+
+    const Prefix& get(uint32_t id) const { return prefixes[id]; }
+    const std::string& to_string(uint32_t id) const { return texts[id]; }
+    size_t size() const { return prefixes.size(); }
+
+    // Append the bytes held by the binary prefixes, their texts and the id index
+    void report_memory(MemoryUsage& out) const;
+};
@@ -3,23 +3,137 @@
 #include "ASGraph.h"
 #include "Policy.h"
 #include "Announcement.h"
+#include "ASPath.h"
+#include "ThreadPool.h"
+#include "RunStats.h"
+#include "Arena.h"
 #include <unordered_map>
 #include <vector>
+#include <array>
+#include <cstddef>
+
+// One origin change for PropagationEngine::apply_updates
+struct RouteUpdate {
+    enum Kind : uint8_t { ANNOUNCE, WITHDRAW };
+
+    Kind kind;
+    uint32_t index;       // Dense index of the origin AS
+    uint32_t prefix_id;
+    bool rov_invalid;     // ANNOUNCE only
+};
+
+// Wall time of the last run_propagation, in seconds. The prefix-major engine
+// interleaves the phases per prefix, so it only fills in the total.
+struct PhaseTimes {
+    double up = 0.0;
+    double across = 0.0;
+    double down = 0.0;
+    double total = 0.0;
+};
+
+// How run_propagation walks the work
+enum class EngineMode {
+    NODE_MAJOR,   // Rank by rank over all prefixes held in each node's RIB
+    PREFIX_MAJOR  // One prefix at a time over dense per-AS arrays
+};
 
 /**
  * BGP Propagation Engine
- * 
+ *
  * Handles all BGP announcement propagation logic following the three-phase
  * valley-free routing model:
  * 1. UP: Customers to Providers
  * 2. ACROSS: Peers (single hop)
  * 3. DOWN: Providers to Customers
+ *
+ * The engine owns the per-AS RIB state (local_rib and pending routes, indexed
+ * by the graph's dense node index) and the AS-path tree their announcements
+ * point into. Policies are read from the graph's membership bitsets once per
+ * run and turned into one bitset per filter flag, so the send/process loops
+ * never dispatch through the Policy classes (and routes without flags skip
+ * the policy check altogether).
  */
 class PropagationEngine {
 private:
-    // Relationship scores for best path selection
-    // Customer > Peer > Provider > Origin (though Origin is highest priority)
-    static const std::unordered_map<Relationship, int> REL_SCORES;
+    ASGraph& graph;
+
+    // Per-run route memory, declared before the containers it backs. All
+    // arenas draw 256 KB blocks from route_blocks and hand them back there.
+    // rib_memory holds the RIB tables until reset(). The serial engine keeps
+    // pending routes in one arena per receiving rank (rank_memory), released
+    // once that rank has adopted; the parallel engines use pending_memory,
+    // rewound after every node (per-thread scratch) or phase (ACROSS).
+    // After a run, reset() or apply_updates() the pool's spare blocks are
+    // trimmed, so an idle engine only holds what its RIBs use.
+    BlockPool route_blocks;
+    ArenaSet rib_memory{route_blocks};
+    ArenaSet pending_memory{route_blocks};
+    std::vector<std::unique_ptr<Arena>> rank_memory;
+
+    // rib_memory's footprint after the last full run or compaction; updates
+    // that grow it past twice this trigger compact_ribs()
+    uint64_t compact_rib_bytes = 0;
+
+    // Per-AS state, indexed by dense node index
+    std::vector<LocalRib> local_ribs;
+    std::vector<PendingRoutes> pending_routes;
+
+    // filter_sets[b]: ASes that drop routes carrying FilterFlags bit b
+    std::array<DenseBitset, NUM_FILTER_FLAGS> filter_sets;
+
+    ASPathTree path_tree;
+
+    // Policies used instead of the graph's when use_policy_overrides is set (set_policies)
+    PolicyAssignment policy_overrides;
+    bool use_policy_overrides = false;
+
+    // Origins kept across reset(), reused so a reset does not allocate
+    std::vector<RouteUpdate> origin_scratch;
+
+    // Print progress lines from run_propagation/apply_updates
+    bool verbose = true;
+
+    PhaseTimes phase_times;
+
+    // Instrumentation target (nullptr = disabled) and the per-thread counters
+    // of the running phase, which are bumped either way and merged into stats
+    RunStats* stats = nullptr;
+    std::vector<PhaseCounters> thread_counters;
+
+    // Zero the per-thread counters for a phase on num_threads threads
+    void begin_phase(size_t num_threads);
+    // Merge the per-thread counters into the given phase of stats (if enabled)
+    void end_phase(PhaseCounters RunStats::*phase);
+    // Routes adopted by all threads since begin_phase
+    uint64_t adopted_so_far() const;
+
+    // Grow the per-AS state to cover nodes added to the graph since the last call
+    void sync_with_graph();
+
+    // Size the arenas and the path tree for num_threads writers
+    void set_num_writers(size_t num_threads);
+
+    // Serial engine: back each AS's pending table with the arena of its rank
+    void bind_pending_to_ranks(const std::vector<std::vector<uint32_t>>& ranked_ases);
+
+    // Serial engine: drop the (adopted, empty) pending tables of one rank and
+    // return its arena's blocks to the pool
+    void release_rank_pending(const std::vector<uint32_t>& nodes, size_t rank);
+
+    // Empty the scratch table of a writer and rewind that writer's pending arena,
+    // keeping the bucket count so the next node does not rehash from scratch
+    void recycle_scratch(PendingRoutes& scratch, size_t writer);
+
+    // Recompute the filter bitsets from the graph's policies (or the overrides)
+    void load_policies();
+
+    // Whether the AS at index drops a route carrying these FilterFlags
+    bool filters(uint32_t index, uint8_t flags) const {
+        for (; flags; flags &= flags - 1) {
+            if (filter_sets[__builtin_ctz(flags)].test(index)) return true;
+        }
+        return false;
+    }
 
     /**
      * Returns true if ann1 is better than ann2, based on BGP best path selection
@@ -27,58 +141,211 @@ private:
      * 1. Relationship (Customer > Peer > Provider)
      * 2. AS Path Length (shorter is better)
      * 3. Next Hop ASN (lower is better)
+     * All three are compared at once through preference_key().
      */
-    static bool is_better_announcement(
-        const Announcement& ann1, 
-        const Announcement& ann2, 
-        const std::unordered_map<Relationship, int>& rel_scores
-    );
+    static bool is_better_announcement(const Announcement& ann1, const Announcement& ann2) {
+        return ann1.preference() > ann2.preference();
+    }
 
     /**
-     * Processes all announcements in a node's received_queue, resolves conflicts,
-     * and updates its local_rib with the best announcement for each prefix.
-     * 
-     * Also handles ROV filtering - ROV ASes drop announcements with rov_invalid=true
+     * Folds one incoming candidate into a receiver's pending slot for its prefix.
+     * The candidate is kept only if it beats both the pending candidate and, when
+     * there is none yet, the receiver's current local_rib entry. Returns true if
+     * the candidate had to be compared against an existing route.
      */
-    static void process_announcements(
-        ASNode* node, 
-        const std::unordered_map<Relationship, int>& rel_scores
+    static bool fold_candidate(
+        const LocalRib& local_rib,
+        PendingRoutes& pending,
+        uint32_t prefix,
+        const Announcement& candidate
     );
 
+    /**
+     * Offers every local_rib entry of a node to each neighbor. Each announcement
+     * is filtered by the neighbor's policy (ROV ASes drop rov_invalid=true) and
+     * folded straight into the neighbor's pending routes, never buffered.
+     */
+    void send_to_neighbors(uint32_t index, NeighborRange neighbors, Relationship rel, PhaseCounters& counters);
+
     /**
      * Propagate announcements UP the provider-customer hierarchy
      */
-    static void propagate_up(
-        ASGraph& graph,
-        const std::vector<std::vector<ASNode*>>& ranked_ases,
+    void propagate_up(
+        const std::vector<std::vector<uint32_t>>& ranked_ases,
         int max_rank
     );
 
     /**
      * Propagate announcements ACROSS peer relationships (single hop only)
      */
-    static void propagate_across(ASGraph& graph);
+    void propagate_across(const std::vector<std::vector<uint32_t>>& ranked_ases);
 
     /**
      * Propagate announcements DOWN the provider-customer hierarchy
      */
-    static void propagate_down(
-        ASGraph& graph,
-        const std::vector<std::vector<ASNode*>>& ranked_ases,
+    void propagate_down(
+        const std::vector<std::vector<uint32_t>>& ranked_ases,
         int max_rank
     );
 
+    // ------------------------------------------------------------------
+    // Parallel engine (receiver-pull)
+    //
+    // Instead of senders folding into other nodes' pending routes, every node
+    // pulls candidates from the local_rib of its customers, peers or
+    // providers and only ever writes its own RIB. Nodes within one rank never
+    // read each other's RIB during UP/DOWN, so a rank can be processed by all
+    // threads at once without locks.
+    // ------------------------------------------------------------------
+
+    /**
+     * Collects into `pending` every announcement from the neighbors' local_ribs
+     * that would beat the node's current best (same rules and filtering as
+     * send_to_neighbors). Only reads RIBs; writes nothing shared.
+     */
+    void pull_from_neighbors(
+        uint32_t index,
+        NeighborRange neighbors,
+        Relationship rel,
+        PendingRoutes& pending,
+        PhaseCounters& counters
+    ) const;
+
+    /**
+     * Moves pending winners into the node's local_rib, extending each path with
+     * the node's ASN through the given path-tree writer. Clears `pending`.
+     */
+    void apply_pending(uint32_t index, PendingRoutes& pending, size_t writer, PhaseCounters& counters);
+
+    void propagate_up_parallel(
+        const std::vector<std::vector<uint32_t>>& ranked_ases,
+        int max_rank,
+        ThreadPool& pool
+    );
+
+    void propagate_across_parallel(ThreadPool& pool);
+
+    void propagate_down_parallel(
+        const std::vector<std::vector<uint32_t>>& ranked_ases,
+        int max_rank,
+        ThreadPool& pool
+    );
+
+    // ------------------------------------------------------------------
+    // Prefix-major engine
+    //
+    // Prefixes never interact, so each prefix is run through UP/ACROSS/DOWN
+    // on its own using dense per-AS arrays (relationship, path length, next
+    // hop) that are reused between prefixes. Prefixes are spread over the
+    // thread pool, and the finished routes are merged into the RIBs at the end.
+    // ------------------------------------------------------------------
+    void run_prefix_major(
+        int max_rank,
+        ThreadPool& pool
+    );
+
+    /**
+     * Core of the prefix-major engine: propagates every prefix that has a
+     * non-empty seed list (dense indices of its origins, whose RIBs already
+     * hold the origin announcement) and merges the learned routes into the RIBs.
+     */
+    void propagate_prefixes(
+        const std::vector<std::vector<uint32_t>>& seeds_by_prefix,
+        int max_rank,
+        ThreadPool& pool
+    );
+
+    // Copies the live routes out, releases rib_memory and refills the RIBs,
+    // dropping the space of routes that updates overwrote or erased
+    void compact_ribs();
+
 public:
+    explicit PropagationEngine(ASGraph& graph);
+
+    PropagationEngine(const PropagationEngine&) = delete;
+    PropagationEngine& operator=(const PropagationEngine&) = delete;
+
+    /**
+     * Seed an origin announcement for prefix_id at the AS with this dense index.
+     * The AS path is just the origin's ASN.
+     */
+    void seed(uint32_t index, uint32_t prefix_id, bool rov_invalid);
+
+    /**
+     * Drop every learned route and stored path but keep the origin
+     * announcements, so the same seeds can be propagated again (e.g. under a
+     * different ROV deployment). The route arenas are rewound in O(1) and,
+     * like the path blocks, keep their memory for the next run; spare pool
+     * blocks beyond a small reserve are freed.
+     */
+    void reset();
+
+    /**
+     * Use these policies instead of the graph's from the next run on (a
+     * bitset copy). Lets several engines share one graph with different
+     * policies; clear_policies() goes back to the graph's.
+     */
+    void set_policies(const PolicyAssignment& policies) {
+        policy_overrides = policies;
+        use_policy_overrides = true;
+    }
+    void clear_policies() { use_policy_overrides = false; }
+
+    void set_verbose(bool enabled) { verbose = enabled; }
+
+    // Collect per-phase counters and per-rank timings into stats (nullptr disables)
+    void set_stats(RunStats* run_stats) { stats = run_stats; }
+
+    /**
+     * Apply a batch of origin changes on top of converged RIBs (after
+     * run_propagation) and bring the RIBs back to convergence.
+     *
+     * Prefixes never interact, so only the prefixes named in the batch are
+     * recomputed: their learned routes are dropped, the remaining origins are
+     * re-propagated with the prefix-major engine (same ranks and selection
+     * rules), and every other RIB entry is left untouched. The result is the
+     * same as a full run_propagation with the updated seeds. Once replaced
+     * routes have doubled the RIB memory, the RIBs are compacted.
+     *
+     * Policy changes are not incremental; they need a full run.
+     */
+    void apply_updates(const std::vector<RouteUpdate>& updates, size_t num_threads = 1);
+
     /**
      * Run the complete BGP propagation process
-     * 
+     *
      * This executes all three phases of BGP propagation:
      * 1. UP: From customers to providers
      * 2. ACROSS: To peers (single hop)
      * 3. DOWN: From providers to customers
-     * 
-     * @param graph The AS graph to propagate announcements through
+     *
+     * With num_threads > 1 the receiver-pull engine is used, processing all
+     * nodes of a rank (and all nodes in the peer phase) concurrently. Every
+     * RIB ends up with the same routes as under the serial engine, though
+     * the hash maps may iterate them in a different order (the RIB writers
+     * sort each AS's rows by prefix id, so the files are identical).
+     *
+     * With EngineMode::PREFIX_MAJOR each prefix is propagated independently
+     * (in parallel over prefixes when num_threads > 1), again with the same RIB contents.
+     *
+     * @param num_threads Number of threads to use (1 = serial engine)
+     * @param mode Node-major (default) or prefix-major traversal
      */
-    static void run_propagation(ASGraph& graph);
-};
+    void run_propagation(size_t num_threads = 1, EngineMode mode = EngineMode::NODE_MAJOR);
+
+    // RIB of the AS with this dense index
+    const LocalRib& local_rib(uint32_t index) const { return local_ribs[index]; }
+    LocalRib& local_rib(uint32_t index) { sync_with_graph(); return local_ribs[index]; }
 
+    // Per-phase timing of the last run_propagation
+    const PhaseTimes& last_phase_times() const { return phase_times; }
+
+    // Path storage the RIB announcements point into
+    const ASPathTree& paths() const { return path_tree; }
+    ASPathTree& paths() { return path_tree; }
+
+    const ASGraph& getGraph() const { return graph; }
+
+    // Append the bytes held by the RIBs, pending routes, filter masks and path tree
+    void report_memory(MemoryUsage& out) const;
+};
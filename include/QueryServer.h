@@ -0,0 +1,113 @@
+#pragma once
+#include "ASGraph.h"
+#include "Prefix.h"
+#include "Propagation.h"
+#include "LpmIndex.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Answers queries against converged RIBs over a Unix domain socket, so the
+ * graph is built and propagated once instead of once per question.
+ *
+ * Line protocol: one request per line. Every request is answered in order,
+ * either with "OK <n>" followed by n rows or with a single "ERR <message>".
+ * Routes are printed as ribs.csv rows: asn,prefix,"(path)".
+ *
+ *   ROUTE <asn> <prefix>   the AS's route for the prefix (0 or 1 row)
+ *   RIB <asn>              every route of the AS, in prefix id order
+ *   LOOKUP <asn> <address> the route the AS uses to reach the address (longest prefix match; 0 or 1 row)
+ *   SCENARIO <arg>...      a full propagation with overrides, then queries on its RIBs:
+ *       rov=<asn>,...                       ROV adopters replacing the loaded set (may be empty)
+ *       ann=<asn>,<prefix>,<rov_invalid>    an extra origin announcement (repeatable)
+ *       route=<asn>,<prefix>  rib=<asn>     queries answered from the scenario (repeatable)
+ *     The first row is "routes=R invalid_routes=I ases_with_invalid=A".
+ *   PING                   OK 0
+ *   QUIT                   closes the connection
+ *   SHUTDOWN               OK 0, then stops the server
+ *
+ * Each connection has its own thread and may pipeline requests: all complete
+ * lines received so far are answered, and the replies go out in one write.
+ * Lookups only read the converged engine, so clients run concurrently.
+ * Scenarios run on engines taken from a pool, each seeded with the same
+ * origins as the converged engine; the pool grows to the number of scenarios
+ * running at once.
+ */
+class QueryServer {
+private:
+    struct Seed {
+        uint32_t index;
+        uint32_t prefix_id;
+        bool rov_invalid;
+    };
+
+    ASGraph& graph;
+    const PropagationEngine& engine;
+    const PrefixTable& prefixes;
+    size_t num_threads;
+    EngineMode mode;
+
+    // Origin announcements of the converged engine, replayed into scenario engines
+    std::vector<Seed> seeds;
+
+    // Longest-prefix-match index over the loaded prefixes, for LOOKUP
+    LpmIndex lpm;
+
+    std::mutex engines_mutex;
+    std::vector<std::unique_ptr<PropagationEngine>> idle_engines;
+
+    std::atomic<bool> stopping{false};
+    int wake_pipe[2] = {-1, -1};
+
+    std::mutex clients_mutex;
+    std::vector<int> client_fds;
+    std::vector<std::thread> client_threads;
+    // Client threads that have returned from serve_client and can be joined
+    std::vector<std::thread::id> finished_clients;
+
+    // Joins finished client threads; caller holds clients_mutex
+    void reap_finished_clients();
+
+    std::unique_ptr<PropagationEngine> take_engine();
+    void return_engine(std::unique_ptr<PropagationEngine> scenario_engine);
+
+    void answer_route(const std::string& args, std::string& out) const;
+    void answer_rib(const std::string& args, std::string& out) const;
+    void answer_lookup(const std::string& args, std::string& out) const;
+    void answer_scenario(const std::string& args, std::string& out);
+
+    // Reads requests from one connection until it closes, QUIT or SHUTDOWN
+    void serve_client(int fd);
+
+public:
+    QueryServer(ASGraph& graph, const PropagationEngine& engine, const PrefixTable& prefixes,
+                size_t num_threads = 1, EngineMode mode = EngineMode::NODE_MAJOR);
+    ~QueryServer();
+
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    /**
+     * Answers one request line (without its newline) by appending the reply
+     * to out. Returns false if the connection should close afterwards (QUIT,
+     * SHUTDOWN). Safe to call from several threads at once.
+     */
+    bool handle(const std::string& request, std::string& out);
+
+    /**
+     * Listens on socket_path (replacing a stale socket file) and serves
+     * clients until SHUTDOWN or stop(), then closes every connection and
+     * removes the socket file. Returns false (after printing an error) if the
+     * socket cannot be set up or socket_path exists and is not a socket.
+     */
+    bool serve(const std::string& socket_path);
+
+    // Makes serve() return; safe to call from any thread
+    void stop();
+};
@@ -0,0 +1,104 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstdio>
+#include "MappedFile.h"
+
+/**
+ * Columnar binary RIB format (--output-format binary)
+ *
+ * One row per (AS, prefix) route, stored column by column, plus a path table
+ * in which every distinct path is a node (asn, parent) hanging off the empty
+ * path 0, so paths that share a suffix share storage.
+ *
+ * Every AS path starts with the AS holding the route, so a row stores only
+ * the rest of it: the path as received from the next hop. That suffix is the
+ * route the neighbor itself holds, and the table is interned by (parent, asn),
+ * so all the customers and peers that learned one route share a single entry.
+ * The AS path in ribs.csv order is the row's ASN followed by the walk along
+ * parent links from its path id.
+ *
+ * Rows are grouped by AS, so the ASN column is run-length encoded as one
+ * (asn, first row) pair per AS holding routes.
+ *
+ * Layout after the fixed header, each section padded to 8 bytes:
+ *
+ *   as_asn[A]           uint32  ASes holding routes, in row order
+ *   as_rows[A+1]        uint64  rows of as_asn[i] are [as_rows[i], as_rows[i+1])
+ *   row_prefix[R]       uint32  prefix id
+ *   row_path[R]         uint32  path table id of the path after the holder
+ *   path_asn[P]         uint32  path node ASN (entry 0 is the empty path)
+ *   path_parent[P]      uint32  path node parent
+ *   prefix_offsets[N+1] uint32  byte offsets into prefix_text
+ *   prefix_text         char    prefix strings as they appeared in the input
+ *
+ * Values are in host byte order, guarded by magic, version and a checksum
+ * over everything after the header (see Checksum.h).
+ */
+
+constexpr uint32_t RIB_BINARY_VERSION = 2;
+
+struct RibBinaryHeader {
+    char magic[8];              // "BGPRIBS1"
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t num_rows;
+    uint64_t num_ases;          // ASes holding at least one route
+    uint64_t num_paths;         // Including the empty path
+    uint64_t num_prefixes;
+    uint64_t prefix_text_bytes;
+    uint64_t checksum;
+};
+
+extern const char RIB_BINARY_MAGIC[8];
+
+/**
+ * Read-only view of a binary RIB file. The file is mmap'd and the columns
+ * are read in place.
+ */
+class RibBinaryReader {
+private:
+    std::unique_ptr<MappedFile> file;
+    RibBinaryHeader header{};
+
+    const uint32_t* as_asn_col = nullptr;
+    const uint64_t* as_rows_col = nullptr;
+    const uint32_t* row_prefix = nullptr;
+    const uint32_t* row_path = nullptr;
+    const uint32_t* path_asn_col = nullptr;
+    const uint32_t* path_parent_col = nullptr;
+    const uint32_t* prefix_offsets = nullptr;
+    const char* prefix_text = nullptr;
+
+public:
+    // Maps and validates the file. On failure prints an error and returns false.
+    bool open(const std::string& path);
+
+    uint64_t num_rows() const { return header.num_rows; }
+    uint64_t num_ases() const { return header.num_ases; }
+    uint64_t num_paths() const { return header.num_paths; }
+    uint64_t num_prefixes() const { return header.num_prefixes; }
+
+    // AS runs: the rows of as_asn(i) are [as_first_row(i), as_first_row(i + 1))
+    uint32_t as_asn(uint64_t i) const { return as_asn_col[i]; }
+    uint64_t as_first_row(uint64_t i) const { return as_rows_col[i]; }
+
+    // ASN of the AS holding a row (a binary search over the AS runs)
+    uint32_t asn(uint64_t row) const;
+    uint32_t prefix_id(uint64_t row) const { return row_prefix[row]; }
+    // Path after the holder: the AS path is asn(row) followed by this walk
+    uint32_t path_id(uint64_t row) const { return row_path[row]; }
+
+    // Path table: walk path_parent from a path id until 0
+    uint32_t path_asn(uint32_t id) const { return path_asn_col[id]; }
+    uint32_t path_parent(uint32_t id) const { return path_parent_col[id]; }
+
+    std::string prefix(uint32_t id) const {
+        return std::string(prefix_text + prefix_offsets[id], prefix_offsets[id + 1] - prefix_offsets[id]);
+    }
+
+    // Writes the rows as ribs.csv text (same bytes the CSV writer produces).
+    // Returns false on a write error.
+    bool write_csv(std::FILE* out) const;
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "Propagation.h"
+#include "Prefix.h"
+
+// File layout of the RIB dump
+enum class OutputFormat {
+    CSV,     // ribs.csv text
+    BINARY   // Columnar ribs.bin (see RibBinary.h)
+};
+
+// Compression applied to the RIB dump while it is written
+enum class OutputCompression {
+    NONE,
+    GZIP   // Concatenated gzip members, readable by gunzip/zcat and zlib
+};
+
+// Fills routes with rib's announcements in prefix id order, the row order of the RIB writers
+void sorted_routes(const LocalRib& rib, std::vector<const Announcement*>& routes);
+
+/**
+ * Writes every AS's local RIB as "asn,prefix,as_path" CSV rows.
+ *
+ * Rows are formatted in parallel: the ASes are cut into runs of roughly equal
+ * row count, each run is formatted (and compressed, if requested) by one
+ * thread into its own reusable buffer, and finished buffers are written out in
+ * AS order. Within an AS, rows are in prefix id order, so every engine and
+ * thread count writes the same bytes. Paths are printed as Python tuples, "(1, 2, 3)" or "(1,)".
+ *
+ * Returns false (after printing an error) if the file cannot be written.
+ */
+bool write_ribs_csv(
+    const PropagationEngine& engine,
+    const PrefixTable& prefixes,
+    const std::string& path,
+    size_t num_threads = 1,
+    OutputCompression compression = OutputCompression::NONE,
+    uint64_t* rows_written = nullptr
+);
+
+/**
+ * Writes every AS's local RIB in the columnar binary format (RibBinary.h):
+ * run-length ASN, prefix id and path id columns, the deduplicated path table
+ * and the prefix strings. Rows are in the same order as write_ribs_csv.
+ *
+ * Returns false (after printing an error) if the file cannot be written.
+ */
+bool write_ribs_binary(
+    const PropagationEngine& engine,
+    const PrefixTable& prefixes,
+    const std::string& path,
+    uint64_t* rows_written = nullptr
+);
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ctime>
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include "MemoryAccounting.h"
+
+class PropagationEngine;
+class PrefixTable;
+
+// Counters of one propagation phase (one cache line, as each thread has its own)
+struct alignas(64) PhaseCounters {
+    uint64_t sent = 0;          // Announcements offered to a neighbor, before policy filtering
+    uint64_t dropped = 0;       // Dropped by the receiver's policy (ROV and rov_invalid)
+    uint64_t compared = 0;      // Candidates compared against a pending or installed route
+    uint64_t adopted = 0;       // Routes written into a local RIB
+    uint64_t peak_pending = 0;  // Most pending routes one AS held before adopting
+
+    void merge(const PhaseCounters& other);
+};
+
+// Wall and process CPU time since construction or the last restart()
+class Stopwatch {
+    std::chrono::steady_clock::time_point wall_start;
+    std::clock_t cpu_start;
+
+public:
+    Stopwatch() { restart(); }
+    void restart() {
+        wall_start = std::chrono::steady_clock::now();
+        cpu_start = std::clock();
+    }
+    double wall_seconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    }
+    double cpu_seconds() const { return static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC; }
+};
+
+// Resident set size now and the process peak so far, in bytes
+uint64_t current_rss_bytes();
+uint64_t peak_rss_bytes();
+
+struct StepTiming {
+    std::string name;
+    double wall_seconds;
+    double cpu_seconds;
+    uint64_t rss_bytes;       // RSS when the step ended
+    uint64_t peak_rss_bytes;  // Process peak RSS when the step ended
+};
+
+struct RankTiming {
+    int rank;
+    uint32_t nodes;
+    double wall_seconds;
+    double cpu_seconds;
+    uint64_t adopted;
+};
+
+/**
+ * Instrumentation for one simulator run, written out by --stats-json.
+ *
+ * main.cpp times its steps with begin_step/end_step, which also samples the
+ * RSS and peak RSS at the end of each step. A PropagationEngine given
+ * this object (set_stats) adds per-phase counters and per-rank timings for
+ * UP and DOWN. Without it the engine only bumps plain per-thread counters
+ * that are never read, so a disabled run costs next to nothing.
+ *
+ * The prefix-major engine interleaves the phases per prefix, so it reports
+ * step timing and RIB sizes but no per-phase counters or rank timings.
+ */
+class RunStats {
+    Stopwatch step_clock;
+    std::string current_step;
+
+public:
+    std::vector<StepTiming> steps;
+
+    PhaseCounters up, across, down;
+    std::vector<RankTiming> up_ranks, down_ranks;
+
+    // RIB entries per AS after propagation (see record_ribs)
+    uint64_t rib_entries = 0;
+    uint64_t rib_max = 0;
+    uint32_t rib_max_asn = 0;
+    std::vector<uint64_t> rib_histogram;                    // [k] = ASes with 2^(k-1) < size <= 2^k ([0] = empty)
+    std::vector<std::pair<uint32_t, uint64_t>> rib_top;     // Largest RIBs (asn, entries)
+    size_t num_ases = 0;
+
+    // Bytes per data structure (see record_memory); empty unless recorded
+    MemoryUsage memory;
+
+    void begin_step(const std::string& name);
+    void end_step();
+
+    // Summarize the RIB size of every AS
+    void record_ribs(const PropagationEngine& engine, size_t top = 10);
+
+    // Attribute memory to the graph, engine and prefix table (prefixes may be null)
+    void record_memory(const PropagationEngine& engine, const PrefixTable* prefixes);
+
+    // Print the per-step RSS and the per-structure breakdown (--memory-report)
+    void print_memory_report(std::ostream& out) const;
+
+    bool write_json(const std::string& path) const;
+};
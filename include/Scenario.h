@@ -0,0 +1,69 @@
+#pragma once
+
+#include "ASGraph.h"
+#include "Propagation.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * ROV adoption scenario sweeps
+ *
+ * A scenario is one set of ROV-adopting ASes, held as a bitset. All scenarios
+ * of a sweep share the parsed graph and the seeded announcements; each worker
+ * thread owns one PropagationEngine that is reset between scenarios, so a
+ * trial costs one bitset copy and one propagation, with no parsing or RIB
+ * reallocation.
+ */
+struct Scenario {
+    DenseBitset rov_adopters;  // By dense node index
+    size_t id = 0;             // Line number in the scenarios file, or trial number
+};
+
+// What one scenario produced
+struct ScenarioResult {
+    size_t scenario = 0;              // Scenario::id
+    size_t adopters = 0;
+    uint64_t routes = 0;              // RIB entries over all ASes
+    uint64_t invalid_routes = 0;      // RIB entries holding an rov_invalid route
+    uint64_t ases_with_invalid = 0;   // ASes holding at least one rov_invalid route
+};
+
+// Counts the routes and rov_invalid routes in every RIB of a converged engine
+// (scenario and adopters are left at zero)
+ScenarioResult summarize_ribs(const PropagationEngine& engine);
+
+/**
+ * Reads one scenario per line: ROV ASNs separated by commas or whitespace.
+ * Blank lines and lines starting with '#' are skipped; an empty adoption set
+ * can be written as a line with just "-". ASNs not in the graph are ignored;
+ * a line with any other character (a sign, a letter) is skipped with a warning.
+ * Each scenario's id is its line number, so results still match the file
+ * when lines are skipped. Returns false (after printing an error) if the file cannot be read.
+ */
+bool load_scenarios(const std::string& path, const ASGraph& graph, std::vector<Scenario>& scenarios);
+
+/**
+ * Builds `trials` scenarios that each pick round(percent% of all ASes) adopters
+ * uniformly at random. Trial t (its id) uses the generator seeded with seed + t,
+ * so any trial can be reproduced on its own.
+ */
+std::vector<Scenario> random_scenarios(const ASGraph& graph, double percent, uint64_t seed, size_t trials);
+
+/**
+ * Propagates the origins held by `seeded` (which must not have been run) once
+ * per scenario. Scenarios are spread over num_threads engines, each running
+ * the serial engine in the given mode. Results are in scenario order.
+ */
+std::vector<ScenarioResult> run_scenarios(
+    ASGraph& graph,
+    const PropagationEngine& seeded,
+    const std::vector<Scenario>& scenarios,
+    size_t num_threads = 1,
+    EngineMode mode = EngineMode::NODE_MAJOR
+);
+
+// Writes one CSV row per scenario (scenario,adopters,routes,invalid_routes,ases_with_invalid),
+// where scenario is the Scenario::id the result came from
+bool write_scenario_results(const std::string& path, const std::vector<ScenarioResult>& results);
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <cstddef>
+
+/**
+ * Fixed-size pool of worker threads for data-parallel loops.
+ *
+ * The calling thread takes part in every loop as thread 0, so a pool of
+ * size 1 has no workers and simply runs the loop inline.
+ */
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable work_ready;
+    std::condition_variable work_done;
+
+    // Current job; workers run it once per generation
+    std::function<void(size_t)> job;
+    size_t generation = 0;
+    size_t active = 0;
+    bool stopping = false;
+
+    void worker_loop(size_t thread_id);
+
+    // Run job(thread_id) on every thread (including the caller) and wait for all of them
+    void run_on_all(const std::function<void(size_t)>& fn);
+
+public:
+    explicit ThreadPool(size_t num_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Total number of threads taking part in a loop (workers + caller)
+    size_t size() const { return workers.size() + 1; }
+
+    /**
+     * Calls fn(i, thread_id) for every i in [0, count), handing out indices
+     * in chunks of `grain` to whichever thread is free. Blocks until done.
+     */
+    template <typename Fn>
+    void parallel_for(size_t count, Fn&& fn, size_t grain = 1) {
+        if (count == 0) return;
+        if (workers.empty() || count <= grain) {
+            for (size_t i = 0; i < count; ++i) fn(i, 0);
+            return;
+        }
+
+        std::atomic<size_t> next(0);
+        run_on_all([&](size_t thread_id) {
+            for (;;) {
+                size_t begin = next.fetch_add(grain, std::memory_order_relaxed);
+                if (begin >= count) break;
+                size_t end = begin + grain < count ? begin + grain : count;
+                for (size_t i = begin; i < end; ++i) fn(i, thread_id);
+            }
+        });
+    }
+};
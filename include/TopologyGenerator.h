@@ -0,0 +1,60 @@
+#pragma once
+
+#include "ASGraph.h"
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+// Number of ASes in the 2025 CAIDA snapshot; --scale multiplies this
+constexpr uint32_t INTERNET_SCALE_ASES = 78000;
+
+// Shape of a synthetic CAIDA-style topology
+struct TopologyConfig {
+    uint32_t num_ases = INTERNET_SCALE_ASES;
+    uint32_t tier1 = 16;           // Size of the fully peered tier-1 clique
+    uint32_t depth = 5;            // Levels including tier-1 and the stub level (at least 3)
+    double stub_fraction = 0.85;   // Share of ASes that never get customers
+    double multihoming = 0.45;     // Chance of each extra provider beyond the first (max 4 providers)
+    double peering_degree = 8.0;   // Average peer links per non-tier-1 AS
+    uint64_t seed = 1;
+};
+
+/**
+ * A generated topology over dense indices.
+ *
+ * Every AS sits on a level (0 = tier-1, depth-1 = stubs) and providers are
+ * always taken from a strictly lower level, so the provider edges are acyclic
+ * by construction. Providers are picked by preferential attachment on their
+ * customer count, which gives the power-law customer degree of the real graph.
+ */
+struct SyntheticTopology {
+    std::vector<uint32_t> asns;                                   // ASN of each index
+    std::vector<uint8_t> level;                                   // Level of each index
+    std::vector<std::pair<uint32_t, uint32_t>> provider_edges;    // (provider, customer)
+    std::vector<std::pair<uint32_t, uint32_t>> peer_edges;        // Each link once
+};
+
+// Seeded ROV deployment and announcements for a topology
+struct AnnouncementConfig {
+    uint32_t prefixes = 50;        // Legitimate prefixes, one origin each (each reaches most ASes)
+    double hijack_fraction = 0.1;  // Share of prefixes also announced by an rov_invalid origin
+    double rov_fraction = 0.1;     // Share of ASes that deploy ROV
+    uint64_t seed = 1;
+};
+
+SyntheticTopology generate_topology(const TopologyConfig& config);
+
+// Add every edge of the topology to the graph (same as parsing its as-rel file)
+void build_graph(const SyntheticTopology& topology, ASGraph& graph);
+
+// Write the topology as a CAIDA as-rel file: "provider|customer|-1" and "peer|peer|0"
+bool write_as_rel(const SyntheticTopology& topology, const TopologyConfig& config, const std::string& path);
+
+// Write anns.csv (seed_asn,prefix,rov_invalid) and rov_asns.csv for the topology
+bool write_announcements(
+    const SyntheticTopology& topology,
+    const AnnouncementConfig& config,
+    const std::string& anns_path,
+    const std::string& rov_path
+);
@@ -1,9 +1,22 @@
-#pragma once
-#include <string>
-
-// We need to forward declare the class or include the header
-// so the compiler knows what 'ASGraph' is.
-#include "ASGraph.h"
-
-// Updated signature: accepts the filename AND the graph reference
-void parse_caida(const std::string& bz2_filename, ASGraph& graph);
\ No newline at end of file
+#pragma once
+#include <string>
+#include <vector>
+
+// We need to forward declare the class or include the header
+// so the compiler knows what 'ASGraph' is.
+#include "ASGraph.h"
+
+// Header information carried by a CAIDA relationship file
+struct CaidaMetadata {
+    // Comment lines in file order, without the leading '#'
+    // (e.g. " source:topology|BGP|..." or " input clique: 174 209 ...")
+    std::vector<std::string> comments;
+};
+
+// Parse a CAIDA as-rel file (plain text or .bz2) into the graph.
+// Compressed files are decoded in-process with libbz2 and plain files are mmap'd;
+// both are scanned in place without per-line copies.
+// If metadata is given, the file's comment lines are stored in it.
+// Returns false (after printing an error) if the file cannot be opened or
+// its bzip2 data is truncated or corrupt; the graph is then incomplete.
+bool parse_caida(const std::string& filename, ASGraph& graph, CaidaMetadata* metadata = nullptr);
@@ -0,0 +1,124 @@
+#include "LpmIndex.h"
+#include "MappedFile.h"
+#include "RibBinary.h"
+#include <iostream>
+#include <chrono>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Answers "which route does AS X use to reach address A" for a batch of queries
+// against a binary RIB file (--output-format binary), by longest-prefix match.
+// Usage: lpm_lookup <ribs.bin> <queries.csv> [output.csv]
+//   queries.csv: asn,ip per line (a header line is skipped)
+//   output:      asn,ip,prefix,as_path (prefix and path empty if the AS has no route)
+int main(int argc, char* argv[]) {
+    if (argc < 3 || argc > 4) {
+        std::cerr << "Usage: " << argv[0] << " <ribs.bin> <queries.csv> [output.csv]\n";
+        return 1;
+    }
+
+    RibBinaryReader reader;
+    if (!reader.open(argv[1])) {
+        return 1;
+    }
+    MappedFile queries(argv[2]);
+    if (!queries.ok()) {
+        std::cerr << "Error: Could not open queries file: " << argv[2] << "\n";
+        return 1;
+    }
+    std::FILE* out = stdout;
+    if (argc == 4) {
+        out = std::fopen(argv[3], "wb");
+        if (!out) {
+            std::cerr << "Error: Could not open " << argv[3] << " for writing.\n";
+            return 1;
+        }
+    }
+
+    const auto build_start = std::chrono::steady_clock::now();
+    std::vector<Prefix> prefixes(reader.num_prefixes());
+    std::vector<std::string> prefix_texts(reader.num_prefixes());
+    for (uint32_t id = 0; id < reader.num_prefixes(); ++id) {
+        prefix_texts[id] = reader.prefix(id);
+        parse_prefix(prefix_texts[id], prefixes[id]);
+    }
+    const LpmIndex index(prefixes);
+    RibRouteArrays routes;
+    routes.build(reader);
+    const double build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - build_start).count();
+
+    std::string buffer = "asn,ip,prefix,as_path\n";
+    char number[16];
+    uint64_t answered = 0, matched = 0;
+    const auto lookup_start = std::chrono::steady_clock::now();
+
+    const char* p = queries.data();
+    const char* end = p + queries.size();
+    for (bool first = true; p < end; first = false) {
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        const char* line = p;
+        const char* eol = nl ? nl : end;
+        p = nl ? nl + 1 : end;
+        while (eol > line && (eol[-1] == '\r' || eol[-1] == ' ')) --eol;
+        if (line == eol) continue;
+
+        uint32_t asn = 0;
+        const auto [asn_end, error] = std::from_chars(line, eol, asn);
+        Prefix address;
+        if (error != std::errc() || asn_end == eol || *asn_end != ',' ||
+            !parse_prefix(asn_end + 1, static_cast<size_t>(eol - asn_end - 1), address)) {
+            if (!first) std::cerr << "Warning: Could not parse query: " << std::string(line, eol) << "\n";
+            continue;
+        }
+
+        uint32_t path = RibRouteArrays::NO_ROUTE;
+        const size_t as_slot = routes.find_as(asn);
+        const uint32_t prefix_id = as_slot == RibRouteArrays::NO_AS ? LpmIndex::NO_MATCH : index.match(address, [&](uint32_t id) {
+            path = routes.path_of(as_slot, id);
+            return path != RibRouteArrays::NO_ROUTE;
+        });
+        answered++;
+
+        buffer.append(line, eol);
+        buffer += ',';
+        if (prefix_id != LpmIndex::NO_MATCH) {
+            matched++;
+            buffer += prefix_texts[prefix_id];
+            buffer += ",\"(";
+            buffer.append(number, std::to_chars(number, number + sizeof(number), asn).ptr);
+            buffer += ',';
+            for (uint32_t id = path; id != 0; id = reader.path_parent(id)) {
+                buffer += ' ';
+                buffer.append(number, std::to_chars(number, number + sizeof(number), reader.path_asn(id)).ptr);
+                if (reader.path_parent(id) != 0) buffer += ',';
+            }
+            buffer += ")\"";
+        } else {
+            buffer += ',';
+        }
+        buffer += '\n';
+
+        if (buffer.size() >= (1u << 20)) {
+            std::fwrite(buffer.data(), 1, buffer.size(), out);
+            buffer.clear();
+        }
+    }
+    const double lookup_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - lookup_start).count();
+
+    std::fwrite(buffer.data(), 1, buffer.size(), out);
+    const bool ok = out != stdout ? std::fclose(out) == 0 : std::fflush(out) == 0;
+    if (!ok) {
+        std::cerr << "Error: failed writing lookup output.\n";
+        return 1;
+    }
+
+    std::cerr << "Indexed " << reader.num_prefixes() << " prefixes and " << reader.num_rows() << " routes in "
+              << build_seconds << " s; answered " << answered << " lookups (" << matched << " routed) in "
+              << lookup_seconds << " s";
+    if (answered) std::cerr << " (" << lookup_seconds * 1e9 / static_cast<double>(answered) << " ns each, with output)";
+    std::cerr << ".\n";
+    return 0;
+}
@@ -0,0 +1,42 @@
+#include "RibBinary.h"
+#include <iostream>
+#include <cstdio>
+#include <string>
+
+// Converts a binary RIB file (--output-format binary) to ribs.csv text.
+// Usage: rib_reader <ribs.bin> [output.csv]   (CSV goes to stdout if no output is given)
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "Usage: " << argv[0] << " <ribs.bin> [output.csv]\n";
+        return 1;
+    }
+
+    RibBinaryReader reader;
+    if (!reader.open(argv[1])) {
+        return 1;
+    }
+
+    std::FILE* out = stdout;
+    if (argc == 3) {
+        out = std::fopen(argv[2], "wb");
+        if (!out) {
+            std::cerr << "Error: Could not open " << argv[2] << " for writing.\n";
+            return 1;
+        }
+    }
+
+    bool ok = reader.write_csv(out);
+    if (out != stdout) {
+        ok = std::fclose(out) == 0 && ok;
+    } else {
+        ok = std::fflush(out) == 0 && ok;
+    }
+    if (!ok) {
+        std::cerr << "Error: failed writing CSV output.\n";
+        return 1;
+    }
+
+    std::cerr << "Converted " << reader.num_rows() << " routes (" << reader.num_paths()
+              << " distinct paths, " << reader.num_prefixes() << " prefixes).\n";
+    return 0;
+}
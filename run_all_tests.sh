@@ -31,7 +31,7 @@ echo ""
 # Check if simulator exists
 if [ ! -f "$SIMULATOR" ]; then
     echo -e "${RED}Error: bgp_simulator not found at $SIMULATOR${NC}"
-    echo "Please compile first: g++ src/*.cpp -Iinclude -o bgp_simulator -std=c++17 -lcurl"
+    echo "Please compile first: g++ src/*.cpp -Iinclude -o bgp_simulator -std=c++17 -pthread -lbz2 -lz -lcurl"
     exit 1
 fi
 
@@ -0,0 +1,85 @@
+#!/bin/bash
+
+# Run the per-phase benchmark on the small, medium and full-size inputs
+# Usage: ./run_benchmarks.sh [--update-baseline] [--threshold PERCENT] [extra benchmark args...]
+# Run from: cse3150_final_project/ directory
+#
+# Results go to benchmarks/results/<size>.json. If benchmarks/baseline/<size>.json
+# exists, every phase is compared against it and the script fails when one is
+# slower by more than the threshold (default 10%). --update-baseline copies the
+# new results over the baseline instead.
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(cd "$SCRIPT_DIR/.." && pwd)"
+
+BENCH_DIR="$PROJECT_ROOT/bench"
+BENCHMARK="$SCRIPT_DIR/benchmark"
+RESULTS_DIR="$SCRIPT_DIR/benchmarks/results"
+BASELINE_DIR="$SCRIPT_DIR/benchmarks/baseline"
+
+UPDATE_BASELINE=0
+THRESHOLD=10
+EXTRA_ARGS=()
+while [ $# -gt 0 ]; do
+    case "$1" in
+        --update-baseline) UPDATE_BASELINE=1 ;;
+        --threshold) THRESHOLD="$2"; shift ;;
+        *) EXTRA_ARGS+=("$1") ;;
+    esac
+    shift
+done
+
+if [ ! -f "$BENCHMARK" ]; then
+    echo "Error: benchmark not found at $BENCHMARK"
+    echo "Please compile first: g++ -O2 benchmark.cpp src/Propagation.cpp src/ASGraph.cpp src/ASPath.cpp src/Prefix.cpp src/Policy.cpp src/ThreadPool.cpp src/RibWriter.cpp src/RibBinary.cpp src/RunStats.cpp src/Arena.cpp src/InputLoader.cpp src/parse_caida.cpp -Iinclude -o benchmark -std=c++17 -pthread -lbz2 -lz"
+    exit 1
+fi
+
+mkdir -p "$RESULTS_DIR" "$BASELINE_DIR"
+
+REGRESSED=0
+
+# Function to benchmark one input set
+run_benchmark() {
+    local size=$1
+    local bench_dir=$2
+    local baseline="$BASELINE_DIR/$size.json"
+    local args=(
+        --relationships "$bench_dir/CAIDAASGraphCollector_2025.10.16.txt"
+        --announcements "$bench_dir/anns.csv"
+        --rov-asns "$bench_dir/rov_asns.csv"
+        --label "$size"
+        --output "$RESULTS_DIR/$size.json"
+        --threshold "$THRESHOLD"
+    )
+    if [ $UPDATE_BASELINE -eq 0 ] && [ -f "$baseline" ]; then
+        args+=(--baseline "$baseline")
+    fi
+
+    echo "Benchmark: $size ($bench_dir)"
+    echo "----------------------------------------"
+    "$BENCHMARK" "${args[@]}" "${EXTRA_ARGS[@]}"
+    local status=$?
+    if [ $status -eq 2 ]; then
+        REGRESSED=$((REGRESSED + 1))
+    elif [ $status -ne 0 ]; then
+        echo "FAILED: benchmark error for $size"
+        exit 1
+    fi
+
+    if [ $UPDATE_BASELINE -eq 1 ]; then
+        cp "$RESULTS_DIR/$size.json" "$baseline"
+        echo "Baseline updated: $baseline"
+    fi
+    echo ""
+}
+
+run_benchmark "small" "$BENCH_DIR/subprefix"
+run_benchmark "medium" "$BENCH_DIR/prefix"
+run_benchmark "full" "$BENCH_DIR/many"
+
+if [ $REGRESSED -gt 0 ]; then
+    echo "$REGRESSED input set(s) regressed against the baseline."
+    exit 1
+fi
+echo "No regressions."
@@ -1,124 +1,342 @@
-#include "ASGraph.h"
-#include <queue>
-#include <algorithm>
-
-// Retrieve a node or create it if it doesn't exist
-ASNode* ASGraph::getOrCreateNode(uint32_t asn) {
-    if (nodes.find(asn) == nodes.end()) {
-        nodes[asn] = std::make_shared<ASNode>(asn);
-    }
-    return nodes[asn].get();
-}
-
-// [cite: 85] Extract relationships
-// as1 | as2 | rel
-// rel = -1: as1 is provider of as2
-// rel =  0: as1 is peer of as2
-void ASGraph::addRelationship(uint32_t as1, uint32_t as2, int relationship) {
-    ASNode* u = getOrCreateNode(as1);
-    ASNode* v = getOrCreateNode(as2);
-
-    if (relationship == -1) {
-        // as1 is provider of as2
-        v->providers.push_back(u); // as2 adds as1 as provider
-        u->customers.push_back(v); // as1 adds as2 as customer
-    } else if (relationship == 0) {
-        // Peers
-        u->peers.push_back(v);
-        v->peers.push_back(u);
-    }
-}
-
-//  Check specifically that there are no provider cycles
-// Standard DFS cycle detection
-bool ASGraph::detectProviderCycles() {
-    std::cout << "Running cycle detection on " << nodes.size() << " nodes...\n";
-    
-    std::unordered_map<uint32_t, bool> visited;
-    std::unordered_map<uint32_t, bool> recursionStack;
-
-    for (auto& pair : nodes) {
-        ASNode* node = pair.second.get();
-        if (hasProviderCycleDFS(node, visited, recursionStack)) {
-            std::cerr << "CYCLE DETECTED involving ASN: " << node->asn << "\n";
-            return true;
-        }
-    }
-    std::cout << "No provider cycles found.\n";
-    return false;
-}
-
-bool ASGraph::hasProviderCycleDFS(ASNode* node, 
-                                  std::unordered_map<uint32_t, bool>& visited, 
-                                  std::unordered_map<uint32_t, bool>& recursionStack) {
-    
-    uint32_t asn = node->asn;
-
-    // If currently in recursion stack, we found a cycle
-    if (recursionStack[asn]) return true;
-    
-    // If already fully processed, no cycle here
-    if (visited[asn]) return false;
-
-    // Mark current
-    visited[asn] = true;
-    recursionStack[asn] = true;
-
-    // Traverse ONLY providers for this check 
-    for (ASNode* provider : node->providers) {
-        if (hasProviderCycleDFS(provider, visited, recursionStack)) {
-            return true;
-        }
-    }
-
-    // Unmark from recursion stack
-    recursionStack[asn] = false;
-    return false;
-}
-
-std::vector<std::vector<ASNode*>> ASGraph::getRankedASes() {
-    std::queue<ASNode*> q;
-    std::unordered_map<uint32_t, size_t> customer_counts;
-    int max_rank = 0;
-
-    // Initialize ranks to 0 and calculate initial customer counts.
-    for (auto const& [asn, node_ptr] : nodes) {
-        node_ptr->propagation_rank = 0;
-        size_t count = node_ptr->customers.size();
-        customer_counts[asn] = count;
-        if (count == 0) {
-            q.push(node_ptr.get());
-        }
-    }
-
-    // Process nodes in topological order (customer to provider).
-    while (!q.empty()) {
-        ASNode* customer_node = q.front();
-        q.pop();
-
-        for (ASNode* provider_node : customer_node->providers) {
-            // A provider's rank is the max of its customers' ranks + 1.
-            provider_node->propagation_rank = std::max(
-                provider_node->propagation_rank,
-                customer_node->propagation_rank + 1
-            );
-            max_rank = std::max(max_rank, provider_node->propagation_rank);
-
-            // This provider has one less customer to be processed.
-            customer_counts[provider_node->asn]--;
-
-            // If all customers of this provider are processed, it's ready to be a "customer" for its own providers.
-            if (customer_counts[provider_node->asn] == 0) {
-                q.push(provider_node);
-            }
-        }
-    }
-
-    // Now that ranks are assigned, create the flattened vector structure.
-    std::vector<std::vector<ASNode*>> ranked_ases(max_rank + 1);
-    for (auto const& [asn, node_ptr] : nodes) {
-        ranked_ases[node_ptr->propagation_rank].push_back(node_ptr.get());
-    }
-
-    return ranked_ases;
-}
\ No newline at end of file
+#include "ASGraph.h"
+#include "MappedFile.h"
+#include <algorithm>
+
+uint32_t ASGraph::lookupIndex(uint32_t asn) const {
+    auto it = std::lower_bound(sorted_asns.begin(), sorted_asns.end(), asn);
+    if (it != sorted_asns.end() && *it == asn) {
+        return sorted_indices[it - sorted_asns.begin()];
+    }
+    if (unsorted_asns.empty()) return NO_INDEX;
+    auto pending = unsorted_asns.find(asn);
+    return pending == unsorted_asns.end() ? NO_INDEX : pending->second;
+}
+
+void ASGraph::indexAsns() {
+    if (unsorted_asns.empty() && sorted_asns.size() == nodes.size()) return;
+
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    pairs.reserve(nodes.size());
+    for (const ASNode& node : nodes) {
+        pairs.emplace_back(node.asn, node.index);
+    }
+    std::sort(pairs.begin(), pairs.end());
+
+    sorted_asns.resize(pairs.size());
+    sorted_indices.resize(pairs.size());
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        sorted_asns[i] = pairs[i].first;
+        sorted_indices[i] = pairs[i].second;
+    }
+    std::unordered_map<uint32_t, uint32_t>().swap(unsorted_asns);
+}
+
+// Retrieve a node or create it if it doesn't exist
+ASNode* ASGraph::getOrCreateNode(uint32_t asn) {
+    const uint32_t found = lookupIndex(asn);
+    if (found != NO_INDEX) {
+        return &nodes[found];
+    }
+
+    uint32_t index = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back(asn, index);
+    unsorted_asns.emplace(asn, index);
+
+    // A new node needs its own (empty) rows in the CSR arrays
+    invalidate();
+    return &nodes.back();
+}
+
+const ASNode* ASGraph::findNode(uint32_t asn) const {
+    const uint32_t index = lookupIndex(asn);
+    return index == NO_INDEX ? nullptr : &nodes[index];
+}
+
+// [cite: 85] Extract relationships
+// as1 | as2 | rel
+// rel = -1: as1 is provider of as2
+// rel =  0: as1 is peer of as2
+void ASGraph::addRelationship(uint32_t as1, uint32_t as2, int relationship) {
+    uint32_t u = getOrCreateNode(as1)->index;
+    uint32_t v = getOrCreateNode(as2)->index;
+
+    if (relationship == -1) {
+        // as1 is provider of as2
+        pending_provider_edges.emplace_back(v, u);
+    } else if (relationship == 0) {
+        // Peers
+        pending_peer_edges.emplace_back(u, v);
+        pending_peer_edges.emplace_back(v, u);
+    }
+    invalidate();
+}
+
+void ASGraph::reserveEdges(size_t count) {
+    // A rough bound for either list; they still grow normally past it
+    pending_provider_edges.reserve(pending_provider_edges.size() + count);
+    pending_peer_edges.reserve(pending_peer_edges.size() + count);
+}
+
+// Sort + dedup an edge list and lay it out as CSR rows
+static void buildCSR(size_t num_nodes, std::vector<std::pair<uint32_t, uint32_t>>& edges, CSRAdjacency& out) {
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    out.offsets.assign(num_nodes + 1, 0);
+    for (const auto& e : edges) {
+        out.offsets[e.first + 1]++;
+    }
+    for (size_t i = 0; i < num_nodes; ++i) {
+        out.offsets[i + 1] += out.offsets[i];
+    }
+
+    // Edges are sorted by source, so targets are already in row order
+    out.targets.resize(edges.size());
+    for (size_t i = 0; i < edges.size(); ++i) {
+        out.targets[i] = edges[i].second;
+    }
+}
+
+// Append the edges already stored in a CSR array back onto an edge list
+static void appendCSREdges(const CSRAdjacency& adj, std::vector<std::pair<uint32_t, uint32_t>>& edges) {
+    if (adj.offsets.empty()) return;
+    for (uint32_t i = 0; i + 1 < adj.offsets.size(); ++i) {
+        for (uint32_t t : adj.neighbors(i)) {
+            edges.emplace_back(i, t);
+        }
+    }
+}
+
+void ASGraph::freeze() {
+    if (frozen) return;
+
+    indexAsns();
+    const size_t n = nodes.size();
+
+    if (pending_provider_edges.empty() && pending_peer_edges.empty() && !provider_adj.offsets.empty()) {
+        // Only nodes were added since the last freeze: give them empty rows
+        for (CSRAdjacency* adj : {&provider_adj, &customer_adj, &peer_adj}) {
+            adj->offsets.resize(n + 1, adj->offsets.back());
+        }
+        frozen = true;
+        return;
+    }
+
+    // Fold any previously frozen edges back in (only happens if edges are added after a freeze)
+    std::vector<std::pair<uint32_t, uint32_t>> up_edges = std::move(pending_provider_edges);
+    std::vector<std::pair<uint32_t, uint32_t>> peer_edges = std::move(pending_peer_edges);
+    appendCSREdges(provider_adj, up_edges);
+    appendCSREdges(peer_adj, peer_edges);
+    pending_provider_edges.clear();
+    pending_peer_edges.clear();
+
+    // customer -> provider
+    buildCSR(n, up_edges, provider_adj);
+
+    // provider -> customer (reverse of the deduplicated provider edges)
+    for (auto& e : up_edges) {
+        std::swap(e.first, e.second);
+    }
+    buildCSR(n, up_edges, customer_adj);
+
+    buildCSR(n, peer_edges, peer_adj);
+
+    frozen = true;
+}
+
+// One iterative Kahn pass over dense indices, customers before providers.
+// A provider's rank is one more than its highest-ranked customer. Nodes on (or
+// above) a provider cycle never run out of unprocessed customers, so they are
+// left unranked; if `ranked` is given it records which nodes were reached.
+bool ASGraph::assignRanks(std::vector<char>* ranked) {
+    const uint32_t n = static_cast<uint32_t>(nodes.size());
+    std::vector<uint32_t> customer_counts(n);
+    std::vector<uint32_t> queue;
+    queue.reserve(n);
+
+    // Initialize ranks to 0 and calculate initial customer counts.
+    for (uint32_t i = 0; i < n; ++i) {
+        nodes[i].propagation_rank = 0;
+        customer_counts[i] = static_cast<uint32_t>(customers(i).size());
+        if (customer_counts[i] == 0) {
+            queue.push_back(i);
+        }
+    }
+
+    // Process nodes in topological order (customer to provider).
+    for (size_t head = 0; head < queue.size(); ++head) {
+        const ASNode& customer_node = nodes[queue[head]];
+
+        for (uint32_t provider : providers(customer_node.index)) {
+            ASNode& provider_node = nodes[provider];
+
+            // A provider's rank is the max of its customers' ranks + 1.
+            provider_node.propagation_rank = std::max(
+                provider_node.propagation_rank,
+                customer_node.propagation_rank + 1
+            );
+
+            // This provider has one less customer to be processed.
+            // If all customers of this provider are processed, it's ready to be a "customer" for its own providers.
+            if (--customer_counts[provider] == 0) {
+                queue.push_back(provider);
+            }
+        }
+    }
+
+    if (ranked) {
+        ranked->assign(n, 0);
+        for (uint32_t i : queue) {
+            (*ranked)[i] = 1;
+        }
+    }
+
+    ranks_valid = true;
+    acyclic = queue.size() == n;
+    return acyclic;
+}
+
+// Check specifically that there are no provider cycles
+bool ASGraph::detectProviderCycles() {
+    freeze();
+    if (acyclic) {
+        std::cout << "No provider cycles (already validated).\n";
+        return false;
+    }
+    std::cout << "Running cycle detection on " << nodes.size() << " nodes...\n";
+
+    std::vector<std::vector<uint32_t>> cycles = findProviderCycles();
+    if (cycles.empty()) {
+        std::cout << "No provider cycles found.\n";
+        return false;
+    }
+
+    for (const std::vector<uint32_t>& cycle : cycles) {
+        std::cerr << "CYCLE DETECTED among " << cycle.size() << " AS(es):";
+        for (uint32_t asn : cycle) {
+            std::cerr << " " << asn;
+        }
+        std::cerr << "\n";
+    }
+    return true;
+}
+
+std::vector<std::vector<uint32_t>> ASGraph::findProviderCycles() {
+    freeze();
+
+    std::vector<char> ranked;
+    if (assignRanks(&ranked)) {
+        return {};
+    }
+
+    // Iterative Tarjan over the provider edges of the unranked nodes only:
+    // ranked nodes cannot lie on a cycle, so the search stays small.
+    const uint32_t n = static_cast<uint32_t>(nodes.size());
+    constexpr uint32_t UNVISITED = UINT32_MAX;
+    std::vector<uint32_t> order(n, UNVISITED);
+    std::vector<uint32_t> low(n, 0);
+    std::vector<char> on_stack(n, 0);
+    std::vector<uint32_t> component_stack;
+    std::vector<std::pair<uint32_t, uint32_t>> call_stack;  // (node, next provider position)
+    uint32_t counter = 0;
+
+    std::vector<std::vector<uint32_t>> cycles;
+
+    auto visit = [&](uint32_t v) {
+        order[v] = low[v] = counter++;
+        component_stack.push_back(v);
+        on_stack[v] = 1;
+        call_stack.emplace_back(v, 0);
+    };
+
+    for (uint32_t root = 0; root < n; ++root) {
+        if (ranked[root] || order[root] != UNVISITED) continue;
+        visit(root);
+
+        while (!call_stack.empty()) {
+            const uint32_t v = call_stack.back().first;
+            const NeighborRange up = providers(v);
+
+            if (call_stack.back().second < up.size()) {
+                const uint32_t w = up.begin()[call_stack.back().second++];
+                if (ranked[w]) continue;
+                if (order[w] == UNVISITED) {
+                    visit(w);
+                } else if (on_stack[w]) {
+                    low[v] = std::min(low[v], order[w]);
+                }
+                continue;
+            }
+
+            // All providers of v explored: close its component if v is the root
+            if (low[v] == order[v]) {
+                std::vector<uint32_t> component;
+                uint32_t w;
+                do {
+                    w = component_stack.back();
+                    component_stack.pop_back();
+                    on_stack[w] = 0;
+                    component.push_back(nodes[w].asn);
+                } while (w != v);
+
+                bool self_loop = std::find(up.begin(), up.end(), v) != up.end();
+                if (component.size() > 1 || self_loop) {
+                    std::sort(component.begin(), component.end());
+                    cycles.push_back(std::move(component));
+                }
+            }
+
+            call_stack.pop_back();
+            if (!call_stack.empty()) {
+                uint32_t parent = call_stack.back().first;
+                low[parent] = std::min(low[parent], low[v]);
+            }
+        }
+    }
+
+    return cycles;
+}
+
+std::vector<std::vector<uint32_t>> ASGraph::getRankedASes() {
+    freeze();
+
+    if (!ranks_valid) {
+        assignRanks();
+    }
+
+    // Now that ranks are assigned, create the flattened vector structure.
+    const uint32_t n = static_cast<uint32_t>(nodes.size());
+    int max_rank = 0;
+    for (const ASNode& node : nodes) {
+        max_rank = std::max(max_rank, node.propagation_rank);
+    }
+
+    std::vector<std::vector<uint32_t>> ranked_ases(max_rank + 1);
+    for (uint32_t i = 0; i < n; ++i) {
+        ranked_ases[nodes[i].propagation_rank].push_back(i);
+    }
+
+    return ranked_ases;
+}
+
+void ASGraph::reportMemory(MemoryUsage& out) const {
+    out.push_back({"graph.nodes", nodes.heap_bytes(), nodes.size()});
+    out.push_back({"graph.asn_index", sorted_asns.heap_bytes() + sorted_indices.heap_bytes() + hash_table_bytes(unsorted_asns),
+                   sorted_asns.size() + unsorted_asns.size()});
+    out.push_back({"graph.policies", policies.memory_bytes(), nodes.size()});
+
+    uint64_t adjacency = 0;
+    for (const CSRAdjacency* adj : {&provider_adj, &customer_adj, &peer_adj}) {
+        adjacency += adj->offsets.heap_bytes() + adj->targets.heap_bytes();
+    }
+    out.push_back({"graph.adjacency", adjacency, provider_adj.numEdges() + customer_adj.numEdges() + peer_adj.numEdges()});
+
+    // Arrays still viewing a loaded snapshot live in its mapping, not on the heap
+    if (snapshot) {
+        out.push_back({"graph.snapshot_mapping", snapshot->size(), nodes.size()});
+    }
+
+    // Cleared by freeze() but the buffers keep their capacity
+    out.push_back({"graph.pending_edges", vector_bytes(pending_provider_edges) + vector_bytes(pending_peer_edges),
+                   pending_provider_edges.size() + pending_peer_edges.size()});
+}
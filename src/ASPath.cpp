@@ -0,0 +1,112 @@
+#include "ASPath.h"
+#include "MemoryAccounting.h"
+
+#include <stdexcept>
+
+ASPathTree::ASPathTree(size_t num_writers) : blocks(MAX_BLOCKS), writers(num_writers < 1 ? 1 : num_writers) {
+    clear();
+}
+
+void ASPathTree::new_block(Writer& w) {
+    uint32_t b = num_blocks.fetch_add(1, std::memory_order_relaxed);
+    if (b >= MAX_BLOCKS) {
+        throw std::length_error("ASPathTree: out of path handles");
+    }
+    if (!blocks[b]) {
+        blocks[b].reset(new Node[BLOCK_SIZE]);
+    }
+    w.next = b << BLOCK_BITS;
+    w.end = w.next + (BLOCK_SIZE - 1);
+}
+
+PathHandle ASPathTree::extend(PathHandle parent, uint32_t asn, size_t writer) {
+    Writer& w = writers[writer];
+
+    // Keep the table at most half full so probe chains stay short
+    if ((w.count + 1) * 2 > w.slots.size()) {
+        rehash(w, w.slots.size() * 2);
+    }
+
+    const size_t mask = w.slots.size() - 1;
+    size_t slot = hash(parent, asn) & mask;
+    while (w.slots[slot] != EMPTY) {
+        const Node& existing = node(w.slots[slot]);
+        if (existing.parent == parent && existing.asn == asn) {
+            return w.slots[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (w.next == EMPTY || w.next > w.end) {
+        new_block(w);
+    }
+    PathHandle h = w.next++;
+    node(h) = {asn, parent};
+    w.slots[slot] = h;
+    w.count++;
+    return h;
+}
+
+void ASPathTree::rehash(Writer& w, size_t num_slots) {
+    std::vector<PathHandle> old_slots(num_slots, EMPTY);
+    old_slots.swap(w.slots);
+
+    const size_t mask = w.slots.size() - 1;
+    for (PathHandle h : old_slots) {
+        if (h == EMPTY) continue;
+        size_t slot = hash(node(h).parent, node(h).asn) & mask;
+        while (w.slots[slot] != EMPTY) {
+            slot = (slot + 1) & mask;
+        }
+        w.slots[slot] = h;
+    }
+}
+
+std::vector<uint32_t> ASPathTree::to_vector(PathHandle h) const {
+    std::vector<uint32_t> path;
+    for (; h != EMPTY; h = node(h).parent) {
+        path.push_back(node(h).asn);
+    }
+    return path;
+}
+
+void ASPathTree::set_num_writers(size_t n) {
+    while (writers.size() < n) {
+        writers.emplace_back();
+        writers.back().slots.assign(16, EMPTY);
+    }
+}
+
+void ASPathTree::clear() {
+    // Keep allocated blocks around for reuse; only the handles are reset
+    num_blocks.store(0, std::memory_order_relaxed);
+    for (Writer& w : writers) {
+        w.next = w.end = EMPTY;
+        w.slots.assign(16, EMPTY);
+        w.count = 0;
+    }
+
+    // Writer 0 owns block 0, whose first slot is the EMPTY root
+    new_block(writers[0]);
+    node(EMPTY) = {0, EMPTY};
+    writers[0].next = EMPTY + 1;
+}
+
+size_t ASPathTree::size() const {
+    size_t total = 1; // EMPTY
+    for (const Writer& w : writers) {
+        total += w.count;
+    }
+    return total;
+}
+
+uint64_t ASPathTree::memory_bytes() const {
+    uint64_t bytes = vector_bytes(blocks) + vector_bytes(writers);
+    for (const auto& block : blocks) {
+        if (block) bytes += heap_bytes(BLOCK_SIZE * sizeof(Node));
+    }
+    for (const Writer& w : writers) {
+        bytes += vector_bytes(w.slots);
+    }
+    return bytes;
+}
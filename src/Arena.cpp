@@ -0,0 +1,155 @@
+#include "Arena.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+
+namespace {
+
+// Requests above this share of a block get their own allocation
+constexpr size_t MAX_IN_BLOCK = BlockPool::BLOCK_SIZE / 4;
+
+inline char* align_up(char* p, size_t alignment) {
+    const uintptr_t address = reinterpret_cast<uintptr_t>(p);
+    return p + ((alignment - address % alignment) % alignment);
+}
+
+} // namespace
+
+char* BlockPool::acquire() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!spare.empty()) {
+        char* block = spare.back();
+        spare.pop_back();
+        return block;
+    }
+    owned.emplace_back(new char[BLOCK_SIZE]);
+    return owned.back().get();
+}
+
+void BlockPool::give_back(std::vector<char*>& blocks) {
+    std::lock_guard<std::mutex> lock(mutex);
+    spare.insert(spare.end(), blocks.begin(), blocks.end());
+    blocks.clear();
+}
+
+void BlockPool::trim(size_t max_spare) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (spare.size() <= max_spare) return;
+
+    std::vector<char*> freed(spare.begin() + max_spare, spare.end());
+    spare.resize(max_spare);
+    std::sort(freed.begin(), freed.end());
+    owned.erase(std::remove_if(owned.begin(), owned.end(), [&freed](const std::unique_ptr<char[]>& block) {
+        return std::binary_search(freed.begin(), freed.end(), block.get());
+    }), owned.end());
+}
+
+uint64_t BlockPool::bytes_reserved() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return owned.size() * static_cast<uint64_t>(BLOCK_SIZE);
+}
+
+uint64_t BlockPool::bytes_spare() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return spare.size() * static_cast<uint64_t>(BLOCK_SIZE);
+}
+
+void Arena::reset() {
+    current = 0;
+    next = blocks.empty() ? nullptr : blocks[0];
+    end = blocks.empty() ? nullptr : next + BlockPool::BLOCK_SIZE;
+    oversized.clear();
+    oversized_bytes = 0;
+}
+
+void Arena::release() {
+    pool.give_back(blocks);
+    reset();
+}
+
+uint64_t Arena::bytes_reserved() const {
+    return blocks.size() * static_cast<uint64_t>(BlockPool::BLOCK_SIZE) + oversized_bytes;
+}
+
+void* Arena::do_allocate(size_t bytes, size_t alignment) {
+    if (next) {
+        char* p = align_up(next, alignment);
+        if (p + bytes <= end) {
+            next = p + bytes;
+            return p;
+        }
+    }
+
+    if (bytes + alignment > MAX_IN_BLOCK) {
+        oversized.emplace_back(new char[bytes + alignment]);
+        oversized_bytes += bytes + alignment;
+        return align_up(oversized.back().get(), alignment);
+    }
+
+    // Move on to the next block, reusing one kept from an earlier fill if there is one
+    if (next) current++;
+    if (current == blocks.size()) {
+        blocks.push_back(pool.acquire());
+    }
+    char* p = align_up(blocks[current], alignment);
+    next = p + bytes;
+    end = blocks[current] + BlockPool::BLOCK_SIZE;
+    return p;
+}
+
+thread_local const ArenaSet::WriterScope* ArenaSet::innermost = nullptr;
+
+ArenaSet::WriterScope::WriterScope(std::initializer_list<ArenaSet*> scoped, size_t writer)
+    : outer(innermost), writer(writer) {
+    if (scoped.size() > MAX_SETS) throw std::invalid_argument("WriterScope: too many arena sets");
+    for (ArenaSet* set : scoped) sets[num_sets++] = set;
+    innermost = this;
+}
+
+ArenaSet::WriterScope::~WriterScope() {
+    innermost = outer;
+}
+
+size_t ArenaSet::current_writer() const {
+    for (const WriterScope* scope = innermost; scope; scope = scope->outer) {
+        for (size_t s = 0; s < scope->num_sets; ++s) {
+            if (scope->sets[s] == this) return scope->writer;
+        }
+    }
+    return 0;
+}
+
+void ArenaSet::set_num_writers(size_t n) {
+    while (arenas.size() < n) {
+        arenas.push_back(std::make_unique<Arena>(pool));
+    }
+}
+
+void ArenaSet::reset() {
+    for (auto& arena : arenas) {
+        arena->reset();
+    }
+}
+
+void ArenaSet::release() {
+    for (auto& arena : arenas) {
+        arena->release();
+    }
+}
+
+uint64_t ArenaSet::bytes_reserved() const {
+    uint64_t total = 0;
+    for (const auto& arena : arenas) {
+        total += arena->bytes_reserved();
+    }
+    return total;
+}
+
+void* ArenaSet::do_allocate(size_t bytes, size_t alignment) {
+    // A thread whose writer id this set has never been sized for can only be
+    // the engine's own caller, which is writer 0
+    const size_t current = current_writer();
+    const size_t writer = current < arenas.size() ? current : 0;
+    return arenas[writer]->allocate(bytes, alignment);
+}
@@ -0,0 +1,230 @@
+#include "GraphSnapshot.h"
+#include "MappedFile.h"
+#include "Checksum.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <memory>
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = {'B', 'G', 'P', 'G', 'R', 'A', 'P', 'H'};
+
+// One flat array of the payload, in file order
+struct Section {
+    const void* data;
+    size_t bytes;
+};
+
+} // namespace
+
+bool save_graph_snapshot(ASGraph& graph, const std::string& path, const CaidaMetadata* metadata) {
+    // freeze() also sorts every ASN into the index written below
+    graph.freeze();
+    graph.getRankedASes();
+
+    const size_t n = graph.getNumNodes();
+
+    std::string meta_text;
+    if (metadata) {
+        for (const std::string& line : metadata->comments) {
+            meta_text += line;
+            meta_text += '\n';
+        }
+    }
+
+    const Section sections[] = {
+        {graph.nodes.data(), n * sizeof(ASNode)},
+        {graph.sorted_asns.data(), n * sizeof(uint32_t)},
+        {graph.sorted_indices.data(), n * sizeof(uint32_t)},
+        {graph.provider_adj.offsets.data(), graph.provider_adj.offsets.size() * sizeof(uint32_t)},
+        {graph.provider_adj.targets.data(), graph.provider_adj.targets.size() * sizeof(uint32_t)},
+        {graph.customer_adj.offsets.data(), graph.customer_adj.offsets.size() * sizeof(uint32_t)},
+        {graph.customer_adj.targets.data(), graph.customer_adj.targets.size() * sizeof(uint32_t)},
+        {graph.peer_adj.offsets.data(), graph.peer_adj.offsets.size() * sizeof(uint32_t)},
+        {graph.peer_adj.targets.data(), graph.peer_adj.targets.size() * sizeof(uint32_t)},
+        {meta_text.data(), meta_text.size()},
+    };
+
+    GraphSnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = GRAPH_SNAPSHOT_VERSION;
+    // Ranks are only complete when ranking ran to the end without a provider cycle
+    header.flags = (graph.acyclic ? static_cast<uint32_t>(SNAPSHOT_ACYCLIC) : 0u) |
+                   (graph.ranks_valid && graph.acyclic ? static_cast<uint32_t>(SNAPSHOT_RANKED) : 0u);
+    header.num_nodes = n;
+    header.num_provider_edges = graph.provider_adj.targets.size();
+    header.num_peer_edges = graph.peer_adj.targets.size();
+    header.metadata_bytes = meta_text.size();
+
+    header.checksum = CHECKSUM_SEED;
+    for (const Section& s : sections) {
+        header.checksum = checksum_words(header.checksum, s.data, s.bytes);
+    }
+
+    // The graph may still be viewing an earlier snapshot at this path, so
+    // write a new file and rename it over instead of truncating in place
+    const std::string temp_path = path + ".tmp";
+    std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Error: cannot write graph snapshot: " << path << "\n";
+        return false;
+    }
+
+    static const char zeros[8] = {};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const Section& s : sections) {
+        out.write(static_cast<const char*>(s.data), static_cast<std::streamsize>(s.bytes));
+        out.write(zeros, static_cast<std::streamsize>(padded_size(s.bytes) - s.bytes));
+    }
+
+    out.close();
+    if (!out || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Error: failed writing graph snapshot: " << path << "\n";
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool load_graph_snapshot(const std::string& path, ASGraph& graph, CaidaMetadata* metadata) {
+    // Copy-on-write, so the graph can update ranks in place without touching the file
+    auto file = std::make_shared<MappedFile>(path, true);
+    if (!file->ok()) {
+        std::cerr << "Error: cannot open graph snapshot: " << path << "\n";
+        return false;
+    }
+
+    GraphSnapshotHeader header;
+    if (file->size() < sizeof(header)) {
+        std::cerr << "Error: graph snapshot is truncated: " << path << "\n";
+        return false;
+    }
+    std::memcpy(&header, file->data(), sizeof(header));
+
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+        std::cerr << "Error: not a graph snapshot: " << path << "\n";
+        return false;
+    }
+    if (header.version != GRAPH_SNAPSHOT_VERSION) {
+        std::cerr << "Error: graph snapshot version " << header.version
+                  << " is not supported (expected " << GRAPH_SNAPSHOT_VERSION << "): " << path << "\n";
+        return false;
+    }
+
+    const uint64_t n = header.num_nodes;
+    const uint64_t e = header.num_provider_edges;
+    const uint64_t p = header.num_peer_edges;
+    if (n >= UINT32_MAX || e >= UINT32_MAX || p >= UINT32_MAX || header.metadata_bytes > file->size()) {
+        std::cerr << "Error: graph snapshot header is corrupt: " << path << "\n";
+        return false;
+    }
+
+    const size_t section_bytes[] = {
+        n * sizeof(ASNode), n * 4, n * 4,
+        (n + 1) * 4, e * 4,
+        (n + 1) * 4, e * 4,
+        (n + 1) * 4, p * 4,
+        header.metadata_bytes,
+    };
+    constexpr size_t NUM_SECTIONS = sizeof(section_bytes) / sizeof(section_bytes[0]);
+    size_t payload = 0;
+    for (size_t bytes : section_bytes) payload += padded_size(bytes);
+
+    if (file->size() != sizeof(header) + payload) {
+        std::cerr << "Error: graph snapshot size does not match its header: " << path << "\n";
+        return false;
+    }
+
+    char* base = file->mutable_data() + sizeof(header);
+    if (checksum_words(CHECKSUM_SEED, base, payload) != header.checksum) {
+        std::cerr << "Error: graph snapshot checksum mismatch: " << path << "\n";
+        return false;
+    }
+
+    // Payload sections in file order
+    char* section[NUM_SECTIONS];
+    char* cursor = base;
+    for (size_t i = 0; i < NUM_SECTIONS; ++i) {
+        section[i] = cursor;
+        cursor += padded_size(section_bytes[i]);
+    }
+    auto words = [&](size_t i) { return reinterpret_cast<uint32_t*>(section[i]); };
+
+    // Everything below is validated where it lies in the mapping, then adopted
+    // by the graph as is: loading allocates nothing per node or edge.
+
+    // Reject arrays that would index out of bounds before anything reads them
+    const uint64_t edge_counts[] = {e, e, p};
+    for (size_t a = 0; a < 3; ++a) {
+        const uint32_t* offsets = words(3 + 2 * a);
+        const uint32_t* targets = words(4 + 2 * a);
+        bool valid = offsets[0] == 0 && offsets[n] == edge_counts[a];
+        for (uint64_t i = 0; valid && i < n; ++i) {
+            valid = offsets[i] <= offsets[i + 1];
+        }
+        for (uint64_t i = 0; valid && i < edge_counts[a]; ++i) {
+            valid = targets[i] < n;
+        }
+        if (!valid) {
+            std::cerr << "Error: graph snapshot adjacency is corrupt: " << path << "\n";
+            return false;
+        }
+    }
+
+    ASNode* nodes = reinterpret_cast<ASNode*>(section[0]);
+    const bool ranked = (header.flags & SNAPSHOT_RANKED) != 0;
+    for (uint64_t i = 0; i < n; ++i) {
+        const int32_t rank = nodes[i].propagation_rank;
+        if (nodes[i].index != i || (ranked && (rank < 0 || static_cast<uint64_t>(rank) >= n))) {
+            std::cerr << "Error: graph snapshot nodes are corrupt: " << path << "\n";
+            return false;
+        }
+    }
+
+    // Strictly increasing ASNs, each naming the node that holds it, make the
+    // index a one-to-one map over all nodes
+    const uint32_t* sorted_asns = words(1);
+    const uint32_t* sorted_indices = words(2);
+    for (uint64_t i = 0; i < n; ++i) {
+        if ((i > 0 && sorted_asns[i - 1] >= sorted_asns[i]) || sorted_indices[i] >= n ||
+            nodes[sorted_indices[i]].asn != sorted_asns[i]) {
+            std::cerr << "Error: graph snapshot ASN index is corrupt: " << path << "\n";
+            return false;
+        }
+    }
+
+    ASGraph loaded;
+    loaded.nodes.adopt(nodes, n);
+    loaded.sorted_asns.adopt(words(1), n);
+    loaded.sorted_indices.adopt(words(2), n);
+    CSRAdjacency* adjacency[] = {&loaded.provider_adj, &loaded.customer_adj, &loaded.peer_adj};
+    for (size_t a = 0; a < 3; ++a) {
+        adjacency[a]->offsets.adopt(words(3 + 2 * a), n + 1);
+        adjacency[a]->targets.adopt(words(4 + 2 * a), edge_counts[a]);
+    }
+    loaded.snapshot = std::move(file);
+
+    loaded.frozen = true;
+    loaded.acyclic = (header.flags & SNAPSHOT_ACYCLIC) != 0;
+    loaded.ranks_valid = ranked;
+
+    if (metadata) {
+        metadata->comments.clear();
+        const char* text = section[NUM_SECTIONS - 1];
+        const char* end = text + header.metadata_bytes;
+        while (text < end) {
+            const char* eol = static_cast<const char*>(std::memchr(text, '\n', static_cast<size_t>(end - text)));
+            if (!eol) eol = end;
+            metadata->comments.emplace_back(text, eol);
+            text = eol + 1;
+        }
+    }
+
+    graph = std::move(loaded);
+    return true;
+}
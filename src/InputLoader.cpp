@@ -0,0 +1,299 @@
+#include "InputLoader.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <unistd.h>
+
+namespace {
+
+// Input parsed per round from a mapped file
+constexpr size_t BLOCK_SIZE = 32u << 20;
+
+// stdin is handed off once this much has arrived, or sooner when the writer
+// pauses, so parsing starts before EOF and keeps up with a slow pipe
+constexpr size_t STDIN_BLOCK_SIZE = 1u << 20;
+
+// A block is only split into chunks of at least this size
+constexpr size_t MIN_CHUNK_BYTES = 64u << 10;
+
+// Chunks per thread, so uneven lines still balance
+constexpr size_t CHUNKS_PER_THREAD = 4;
+
+inline bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+inline void trim(const char*& p, const char*& end) {
+    while (p < end && is_space(*p)) ++p;
+    while (end > p && is_space(end[-1])) --end;
+}
+
+// Leading decimal digits of [p, end) as a 32-bit ASN (trailing text is ignored,
+// as with stoul); false if there are no digits or the value does not fit
+inline bool scan_asn(const char* p, const char* end, uint32_t& out) {
+    const char* start = p;
+    uint64_t value = 0;
+    while (p < end && static_cast<unsigned>(*p - '0') < 10) {
+        value = value * 10 + static_cast<uint64_t>(*p - '0');
+        if (value > UINT32_MAX) return false;
+        ++p;
+    }
+    out = static_cast<uint32_t>(value);
+    return p != start;
+}
+
+/**
+ * Hands consume(begin, end) the input in line-aligned blocks, in order; the
+ * last block may end without a newline. "-" reads stdin, carrying a partial
+ * last line over to the next block.
+ */
+template <typename Consume>
+bool for_each_block(const std::string& path, const char* what, Consume&& consume) {
+    if (path == "-") {
+        std::vector<char> buffer(2 * STDIN_BLOCK_SIZE);
+        size_t filled = 0;
+        for (;;) {
+            const size_t wanted = buffer.size() - filled;
+            const ssize_t got = ::read(STDIN_FILENO, buffer.data() + filled, wanted);
+            if (got < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "Error: Could not read " << what << " from stdin." << std::endl;
+                return false;
+            }
+            filled += static_cast<size_t>(got);
+            if (got == 0) {
+                if (filled) consume(buffer.data(), buffer.data() + filled);
+                return true;
+            }
+            // A short read means the writer has nothing more buffered right now
+            if (filled < STDIN_BLOCK_SIZE && static_cast<size_t>(got) == wanted) continue;
+
+            const char* last = static_cast<const char*>(::memrchr(buffer.data(), '\n', filled));
+            if (!last) {
+                if (filled == buffer.size()) buffer.resize(buffer.size() * 2);  // A single line longer than the buffer
+                continue;
+            }
+            const size_t used = static_cast<size_t>(last + 1 - buffer.data());
+            consume(buffer.data(), buffer.data() + used);
+            std::memmove(buffer.data(), buffer.data() + used, filled - used);
+            filled -= used;
+        }
+    }
+
+    MappedFile file(path);
+    if (!file.ok()) {
+        std::cerr << "Error: Could not open " << what << " file: " << path << std::endl;
+        return false;
+    }
+    const char* p = file.data();
+    const char* end = p + file.size();
+    while (p < end) {
+        const char* stop = end;
+        if (static_cast<size_t>(end - p) > BLOCK_SIZE) {
+            const char* nl = static_cast<const char*>(std::memchr(p + BLOCK_SIZE, '\n', static_cast<size_t>(end - p - BLOCK_SIZE)));
+            stop = nl ? nl + 1 : end;
+        }
+        consume(p, stop);
+        p = stop;
+    }
+    return true;
+}
+
+// Splits [begin, end) at line boundaries into chunks and runs parse(chunk, first, last) on the pool
+template <typename Parse>
+void parse_chunks(ThreadPool& pool, const char* begin, const char* end, size_t& num_chunks, Parse&& parse) {
+    const size_t bytes = static_cast<size_t>(end - begin);
+    num_chunks = std::max<size_t>(1, std::min(pool.size() * CHUNKS_PER_THREAD, bytes / MIN_CHUNK_BYTES));
+
+    std::vector<const char*> bounds(num_chunks + 1, end);
+    bounds[0] = begin;
+    for (size_t c = 1; c < num_chunks; ++c) {
+        const char* at = std::max(bounds[c - 1], begin + bytes / num_chunks * c);
+        const char* nl = at < end ? static_cast<const char*>(std::memchr(at, '\n', static_cast<size_t>(end - at))) : nullptr;
+        bounds[c] = nl ? nl + 1 : end;
+    }
+
+    pool.parallel_for(num_chunks, [&](size_t c, size_t) { parse(c, bounds[c], bounds[c + 1]); });
+}
+
+// Calls f(line, eol) for every line of [p, end); eol excludes the newline
+template <typename F>
+void for_each_line(const char* p, const char* end, F&& f) {
+    while (p < end) {
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        const char* eol = nl ? nl : end;
+        f(p, eol);
+        p = nl ? nl + 1 : end;
+    }
+}
+
+// Splits off the first line of a block; returns where the rest starts
+inline const char* first_line_end(const char* begin, const char* end, const char*& eol) {
+    const char* nl = static_cast<const char*>(std::memchr(begin, '\n', static_cast<size_t>(end - begin)));
+    eol = nl ? nl : end;
+    return nl ? nl + 1 : end;
+}
+
+enum class RowStatus : uint8_t { OK, BAD_FIELDS, BAD_PREFIX, BAD_ASN };
+
+// One parsed anns.csv line
+struct AnnouncementRow {
+    const char* line;
+    const char* eol;
+    const char* prefix_text;
+    uint32_t prefix_length;
+    uint32_t asn;
+    Prefix prefix;
+    RowStatus status;
+    bool rov_invalid;
+};
+
+// Tokenizes seed_asn,prefix,rov_invalid the way getline(',') does: three
+// fields are needed, and the third must not be the empty end of the line
+void parse_announcement(const char* line, const char* eol, std::vector<AnnouncementRow>& rows) {
+    AnnouncementRow row{};
+    row.line = line;
+    row.eol = eol;
+
+    const char* c1 = static_cast<const char*>(std::memchr(line, ',', static_cast<size_t>(eol - line)));
+    const char* c2 = c1 && c1 + 1 < eol ? static_cast<const char*>(std::memchr(c1 + 1, ',', static_cast<size_t>(eol - c1 - 1))) : nullptr;
+    if (!c2 || c2 + 1 == eol) {
+        row.status = RowStatus::BAD_FIELDS;
+        rows.push_back(row);
+        return;
+    }
+    const char* c3 = static_cast<const char*>(std::memchr(c2 + 1, ',', static_cast<size_t>(eol - c2 - 1)));
+
+    const char* asn = line;
+    const char* asn_end = c1;
+    const char* prefix = c1 + 1;
+    const char* prefix_end = c2;
+    const char* flag = c2 + 1;
+    const char* flag_end = c3 ? c3 : eol;
+    trim(asn, asn_end);
+    trim(prefix, prefix_end);
+    trim(flag, flag_end);
+
+    row.prefix_text = prefix;
+    row.prefix_length = static_cast<uint32_t>(prefix_end - prefix);
+    const size_t flag_length = static_cast<size_t>(flag_end - flag);
+    row.rov_invalid = (flag_length == 4 && (std::memcmp(flag, "True", 4) == 0 || std::memcmp(flag, "true", 4) == 0)) ||
+                      (flag_length == 1 && *flag == '1');
+
+    if (!parse_prefix(prefix, row.prefix_length, row.prefix)) {
+        row.status = RowStatus::BAD_PREFIX;
+    } else if (!scan_asn(asn, asn_end, row.asn)) {
+        row.status = RowStatus::BAD_ASN;
+    } else {
+        row.status = RowStatus::OK;
+    }
+    rows.push_back(row);
+}
+
+// One parsed ROV line (valid or not); blank lines are dropped while parsing
+struct RovRow {
+    const char* line;
+    const char* eol;
+    uint32_t asn;
+    bool ok;
+};
+
+void parse_rov_line(const char* line, const char* eol, std::vector<RovRow>& rows) {
+    while (eol > line && (eol[-1] == '\r' || eol[-1] == ' ')) --eol;
+    if (line == eol) return;
+
+    const char* p = line;
+    while (p < eol && is_space(*p)) ++p;
+    RovRow row{line, eol, 0, false};
+    row.ok = scan_asn(p, eol, row.asn);
+    rows.push_back(row);
+}
+
+} // namespace
+
+bool load_announcements(const std::string& path, ASGraph& graph, PropagationEngine& engine, PrefixTable& prefixes,
+                        size_t num_threads, size_t& seeded) {
+    ThreadPool pool(num_threads);
+    std::vector<std::vector<AnnouncementRow>> chunks;
+    bool header = true;
+    seeded = 0;
+
+    return for_each_block(path, "announcements", [&](const char* begin, const char* end) {
+        if (header) {
+            const char* eol;
+            begin = first_line_end(begin, end, eol);
+            header = false;
+        }
+
+        size_t num_chunks = 0;
+        chunks.resize(std::max(chunks.size(), pool.size() * CHUNKS_PER_THREAD));
+        parse_chunks(pool, begin, end, num_chunks, [&](size_t c, const char* first, const char* last) {
+            chunks[c].clear();
+            for_each_line(first, last, [&](const char* line, const char* eol) {
+                if (line != eol) parse_announcement(line, eol, chunks[c]);
+            });
+        });
+
+        // Interning and seeding stay in file order, so prefix ids and node indices match a sequential read
+        for (size_t c = 0; c < num_chunks; ++c) {
+            for (const AnnouncementRow& row : chunks[c]) {
+                if (row.status == RowStatus::BAD_FIELDS) {
+                    std::cerr << "Warning: Could not parse announcement line: " << std::string(row.line, row.eol) << std::endl;
+                    continue;
+                }
+                if (row.status == RowStatus::BAD_PREFIX) {
+                    std::cerr << "Warning: Could not parse prefix in announcement line: " << std::string(row.line, row.eol) << std::endl;
+                    continue;
+                }
+                if (row.status == RowStatus::BAD_ASN) {
+                    std::cerr << "Warning: Could not parse announcement line: " << std::string(row.line, row.eol) << " (invalid ASN)" << std::endl;
+                    continue;
+                }
+                // Only accepted rows intern, so rejected lines leave no prefix ids behind
+                const uint32_t prefix_id = prefixes.intern(row.prefix, row.prefix_text, row.prefix_length);
+                engine.seed(graph.getOrCreateNode(row.asn)->index, prefix_id, row.rov_invalid);
+                seeded++;
+            }
+        }
+    });
+}
+
+bool load_rov_asns(const std::string& path, ASGraph& graph, size_t num_threads) {
+    ThreadPool pool(num_threads);
+    std::vector<std::vector<RovRow>> chunks;
+    bool first = true;
+
+    return for_each_block(path, "ROV ASNs", [&](const char* begin, const char* end) {
+        if (first) {
+            // The first line is a header if it holds anything but digits
+            const char* eol;
+            const char* rest = first_line_end(begin, end, eol);
+            bool is_header = false;
+            for (const char* p = begin; p < eol; ++p) {
+                is_header |= static_cast<unsigned>(*p - '0') >= 10 && *p != '\r';
+            }
+            if (is_header) begin = rest;
+            first = false;
+        }
+
+        size_t num_chunks = 0;
+        chunks.resize(std::max(chunks.size(), pool.size() * CHUNKS_PER_THREAD));
+        parse_chunks(pool, begin, end, num_chunks, [&](size_t c, const char* first_byte, const char* last) {
+            chunks[c].clear();
+            for_each_line(first_byte, last, [&](const char* line, const char* eol) { parse_rov_line(line, eol, chunks[c]); });
+        });
+
+        for (size_t c = 0; c < num_chunks; ++c) {
+            for (const RovRow& row : chunks[c]) {
+                if (!row.ok) {
+                    std::cerr << "Warning: Could not parse ROV ASN: " << std::string(row.line, row.eol) << std::endl;
+                    continue;
+                }
+                graph.setPolicy(graph.getOrCreateNode(row.asn)->index, PolicyKind::ROV);
+            }
+        }
+    });
+}
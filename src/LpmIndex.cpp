@@ -0,0 +1,230 @@
+#include "LpmIndex.h"
+#include "RibBinary.h"
+
+#include <algorithm>
+#include <array>
+
+namespace {
+
+constexpr uint64_t SLOT_MASK = 63;
+
+// Address bytes as a 128-bit key, most significant bit first
+inline void address_key(const Prefix& address, uint64_t& hi, uint64_t& lo) {
+    hi = lo = 0;
+    for (int i = 0; i < 8; ++i) hi = hi << 8 | address.addr[i];
+    for (int i = 8; i < 16; ++i) lo = lo << 8 | address.addr[i];
+}
+
+// Clears every bit past the first `length`
+inline void mask_key(uint64_t& hi, uint64_t& lo, unsigned length) {
+    if (length == 0) {
+        hi = lo = 0;
+    } else if (length <= 64) {
+        hi &= ~uint64_t(0) << (64 - length);
+        lo = 0;
+    } else {
+        lo &= ~uint64_t(0) << (128 - length);
+    }
+}
+
+// The 6 key bits starting at bit `offset`; bits past 128 read as zero
+inline uint64_t slot_at(uint64_t hi, uint64_t lo, unsigned offset) {
+    if (offset + 6 <= 64) return hi >> (58 - offset) & SLOT_MASK;
+    if (offset >= 64) {
+        const unsigned in_lo = offset - 64;
+        return (in_lo <= 58 ? lo >> (58 - in_lo) : lo << (in_lo - 58)) & SLOT_MASK;
+    }
+    const unsigned from_lo = offset + 6 - 64;
+    return (hi << from_lo | lo >> (64 - from_lo)) & SLOT_MASK;
+}
+
+inline bool key_less(uint64_t a_hi, uint64_t a_lo, uint8_t a_length, uint64_t b_hi, uint64_t b_lo, uint8_t b_length) {
+    if (a_hi != b_hi) return a_hi < b_hi;
+    if (a_lo != b_lo) return a_lo < b_lo;
+    return a_length < b_length;
+}
+
+} // namespace
+
+LpmIndex::LpmIndex(const PrefixTable& prefixes) {
+    std::vector<Prefix> all(prefixes.size());
+    for (uint32_t id = 0; id < prefixes.size(); ++id) all[id] = prefixes.get(id);
+    build(all);
+}
+
+void LpmIndex::build(const std::vector<Prefix>& prefixes) {
+    std::vector<Entry> v4, v6;
+    for (uint32_t id = 0; id < prefixes.size(); ++id) {
+        const Prefix& p = prefixes[id];
+        Entry entry;
+        address_key(p, entry.hi, entry.lo);
+        mask_key(entry.hi, entry.lo, p.length);
+        entry.length = p.length;
+        entry.id = id;
+        (p.is_ipv6 ? v6 : v4).push_back(entry);
+    }
+
+    parents.assign(prefixes.size(), NO_MATCH);
+    build_trie(ipv4, v4);
+    build_trie(ipv6, v6);
+}
+
+void LpmIndex::build_trie(Trie& trie, std::vector<Entry>& entries) {
+    // Address order with shorter prefixes first: a prefix follows every prefix that covers it
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return key_less(a.hi, a.lo, a.length, b.hi, b.lo, b.length);
+    });
+
+    // The covering prefixes of the current one are exactly the stack
+    std::vector<const Entry*> covering;
+    for (const Entry& entry : entries) {
+        while (!covering.empty()) {
+            uint64_t hi = entry.hi, lo = entry.lo;
+            mask_key(hi, lo, covering.back()->length);
+            if (hi == covering.back()->hi && lo == covering.back()->lo) break;
+            covering.pop_back();
+        }
+        if (!covering.empty()) parents[entry.id] = covering.back()->id;
+        covering.push_back(&entry);
+    }
+
+    trie.nodes.assign(1, Node());
+    trie.leaves.clear();
+    build_node(trie, 0, entries.data(), entries.data() + entries.size(), 0, NO_MATCH);
+    trie.nodes.shrink_to_fit();
+    trie.leaves.shrink_to_fit();
+}
+
+// [first, last) is every entry under this node in address order; the ones that
+// end at or before `offset` were already pushed down as `inherited`
+void LpmIndex::build_node(Trie& trie, uint32_t node, const Entry* first, const Entry* last,
+                          unsigned offset, uint32_t inherited) {
+    std::array<uint32_t, 64> leaf;
+    leaf.fill(inherited);
+
+    // Prefixes ending in this node cover a run of slots; shorter ones go first so longer ones win
+    std::vector<const Entry*> ending;
+    for (const Entry* e = first; e != last; ++e) {
+        if ((offset == 0 || e->length > offset) && e->length <= offset + STRIDE) ending.push_back(e);
+    }
+    std::stable_sort(ending.begin(), ending.end(), [](const Entry* a, const Entry* b) { return a->length < b->length; });
+    for (const Entry* e : ending) {
+        const uint64_t start = slot_at(e->hi, e->lo, offset);
+        const uint64_t span = uint64_t(1) << (offset + STRIDE - e->length);
+        std::fill(leaf.begin() + start, leaf.begin() + start + span, e->id);
+    }
+
+    // Longer prefixes continue in a child; entries sharing a slot are contiguous
+    struct Child {
+        uint64_t slot;
+        const Entry* first;
+        const Entry* last;
+    };
+    std::vector<Child> children;
+    uint64_t child_bits = 0;
+    for (const Entry* e = first; e != last; ++e) {
+        if (e->length <= offset + STRIDE) continue;
+        const uint64_t slot = slot_at(e->hi, e->lo, offset);
+        if (!children.empty() && children.back().slot == slot) {
+            children.back().last = e + 1;
+        } else {
+            children.push_back({slot, e, e + 1});
+            child_bits |= uint64_t(1) << slot;
+        }
+    }
+
+    uint64_t leaf_starts = 0;
+    const uint32_t first_leaf = static_cast<uint32_t>(trie.leaves.size());
+    bool any_leaf = false;
+    for (uint64_t slot = 0; slot < 64; ++slot) {
+        if (child_bits >> slot & 1) continue;
+        if (!any_leaf || leaf[slot] != trie.leaves.back()) {
+            leaf_starts |= uint64_t(1) << slot;
+            trie.leaves.push_back(leaf[slot]);
+            any_leaf = true;
+        }
+    }
+
+    const uint32_t first_child = static_cast<uint32_t>(trie.nodes.size());
+    trie.nodes.resize(trie.nodes.size() + children.size());
+    trie.nodes[node] = {child_bits, leaf_starts, first_leaf, first_child};
+
+    for (size_t c = 0; c < children.size(); ++c) {
+        build_node(trie, first_child + static_cast<uint32_t>(c), children[c].first, children[c].last,
+                   offset + STRIDE, leaf[children[c].slot]);
+    }
+}
+
+uint32_t LpmIndex::match(const Prefix& address) const {
+    const Trie& trie = address.is_ipv6 ? ipv6 : ipv4;
+    uint64_t hi, lo;
+    address_key(address, hi, lo);
+
+    const Node* node = &trie.nodes[0];
+    for (unsigned offset = 0;; offset += STRIDE) {
+        const uint64_t bit = uint64_t(1) << slot_at(hi, lo, offset);
+        const uint64_t upto = bit | (bit - 1);
+        if (!(node->children & bit)) {
+            return trie.leaves[node->first_leaf + __builtin_popcountll(node->leaf_starts & upto) - 1];
+        }
+        node = &trie.nodes[node->first_child + __builtin_popcountll(node->children & upto) - 1];
+    }
+}
+
+const Announcement* lookup_route(const LpmIndex& index, const LocalRib& rib, const Prefix& address) {
+    const Announcement* route = nullptr;
+    index.match(address, [&](uint32_t id) {
+        auto it = rib.find(id);
+        if (it == rib.end()) return false;
+        route = &it->second;
+        return true;
+    });
+    return route;
+}
+
+void RibRouteArrays::build(const RibBinaryReader& reader) {
+    // Rows are grouped by AS; order the groups by ASN and each group by prefix id
+    struct Group {
+        uint32_t asn;
+        uint64_t first;
+        uint64_t last;
+    };
+    std::vector<Group> groups;
+    for (uint64_t a = 0; a < reader.num_ases(); ++a) {
+        groups.push_back({reader.as_asn(a), reader.as_first_row(a), reader.as_first_row(a + 1)});
+    }
+    std::sort(groups.begin(), groups.end(), [](const Group& a, const Group& b) { return a.asn < b.asn; });
+
+    asns.clear();
+    offsets.assign(1, 0);
+    prefix_ids.clear();
+    path_ids.clear();
+    prefix_ids.reserve(reader.num_rows());
+    path_ids.reserve(reader.num_rows());
+
+    std::vector<uint64_t> rows;
+    for (const Group& group : groups) {
+        rows.clear();
+        for (uint64_t row = group.first; row < group.last; ++row) rows.push_back(row);
+        std::sort(rows.begin(), rows.end(),
+                  [&reader](uint64_t a, uint64_t b) { return reader.prefix_id(a) < reader.prefix_id(b); });
+        for (uint64_t row : rows) {
+            prefix_ids.push_back(reader.prefix_id(row));
+            path_ids.push_back(reader.path_id(row));
+        }
+        asns.push_back(group.asn);
+        offsets.push_back(prefix_ids.size());
+    }
+}
+
+size_t RibRouteArrays::find_as(uint32_t asn) const {
+    auto it = std::lower_bound(asns.begin(), asns.end(), asn);
+    return it != asns.end() && *it == asn ? static_cast<size_t>(it - asns.begin()) : NO_AS;
+}
+
+uint32_t RibRouteArrays::path_of(size_t as_slot, uint32_t prefix_id) const {
+    const auto first = prefix_ids.begin() + static_cast<std::ptrdiff_t>(offsets[as_slot]);
+    const auto last = prefix_ids.begin() + static_cast<std::ptrdiff_t>(offsets[as_slot + 1]);
+    auto it = std::lower_bound(first, last, prefix_id);
+    return it != last && *it == prefix_id ? path_ids[static_cast<size_t>(it - prefix_ids.begin())] : NO_ROUTE;
+}
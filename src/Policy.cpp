@@ -0,0 +1,42 @@
+#include "Policy.h"
+
+const Policy& policy_for(PolicyKind kind) {
+    static const BGP bgp;
+    static const ROV rov;
+
+    switch (kind) {
+        case PolicyKind::ROV: return rov;
+        case PolicyKind::BGP:
+        default: return bgp;
+    }
+}
+
+PolicyKind PolicyAssignment::kind(uint32_t index) const {
+    for (size_t k = 1; k < NUM_POLICY_KINDS; ++k) {
+        if (sets[k].test(index)) return static_cast<PolicyKind>(k);
+    }
+    return PolicyKind::BGP;
+}
+
+void PolicyAssignment::assign(uint32_t index, PolicyKind kind) {
+    for (size_t k = 1; k < NUM_POLICY_KINDS; ++k) {
+        sets[k].reset(index);
+    }
+    if (kind != PolicyKind::BGP) sets[static_cast<size_t>(kind)].set(index);
+}
+
+DenseBitset PolicyAssignment::filtering(uint8_t flag) const {
+    DenseBitset result;
+    for (size_t k = 1; k < NUM_POLICY_KINDS; ++k) {
+        if (policy_for(static_cast<PolicyKind>(k)).filter_mask() & flag) result.merge(sets[k]);
+    }
+    return result;
+}
+
+uint64_t PolicyAssignment::memory_bytes() const {
+    uint64_t bytes = 0;
+    for (const DenseBitset& set : sets) {
+        bytes += set.memory_bytes();
+    }
+    return bytes;
+}
@@ -0,0 +1,90 @@
+#include "Prefix.h"
+
+#include <arpa/inet.h>
+#include <cstdlib>
+#include <cstring>
+
+size_t PrefixHash::operator()(const Prefix& p) const {
+    // FNV-1a over the address bytes, length and family
+    uint64_t h = 1469598103934665603ULL;
+    for (uint8_t b : p.addr) {
+        h = (h ^ b) * 1099511628211ULL;
+    }
+    h = (h ^ p.length) * 1099511628211ULL;
+    h = (h ^ static_cast<uint8_t>(p.is_ipv6)) * 1099511628211ULL;
+    return static_cast<size_t>(h);
+}
+
+bool parse_prefix(const std::string& text, Prefix& out) {
+    return parse_prefix(text.data(), text.size(), out);
+}
+
+bool parse_prefix(const char* text, size_t length, Prefix& out) {
+    // inet_pton and strtol need NUL-terminated input; no valid prefix comes close to this size
+    char buffer[64];
+    if (length >= sizeof(buffer)) {
+        out = Prefix();
+        return false;
+    }
+    std::memcpy(buffer, text, length);
+    buffer[length] = '\0';
+
+    char* slash = static_cast<char*>(std::memchr(buffer, '/', length));
+    if (slash) *slash = '\0';
+
+    out = Prefix();
+    out.is_ipv6 = std::memchr(buffer, ':', slash ? static_cast<size_t>(slash - buffer) : length) != nullptr;
+    const int max_len = out.is_ipv6 ? 128 : 32;
+
+    if (inet_pton(out.is_ipv6 ? AF_INET6 : AF_INET, buffer, out.addr.data()) != 1) {
+        return false;
+    }
+
+    if (!slash) {
+        out.length = static_cast<uint8_t>(max_len);
+        return true;
+    }
+
+    const char* len_str = slash + 1;
+    char* end = nullptr;
+    long len = std::strtol(len_str, &end, 10);
+    if (end == len_str || *end != '\0' || len < 0 || len > max_len) {
+        return false;
+    }
+    out.length = static_cast<uint8_t>(len);
+    return true;
+}
+
+uint32_t PrefixTable::intern(const std::string& text) {
+    Prefix prefix;
+    if (!parse_prefix(text, prefix)) {
+        return INVALID_ID;
+    }
+    return intern(prefix, text.data(), text.size());
+}
+
+uint32_t PrefixTable::intern(const Prefix& prefix, const char* text, size_t length) {
+    auto it = ids.find(prefix);
+    if (it != ids.end()) {
+        return it->second;
+    }
+
+    uint32_t id = static_cast<uint32_t>(prefixes.size());
+    prefixes.push_back(prefix);
+    texts.emplace_back(text, length);
+    ids.emplace(prefix, id);
+    return id;
+}
+
+void PrefixTable::report_memory(MemoryUsage& out) const {
+    out.push_back({"prefixes.binary", vector_bytes(prefixes), prefixes.size()});
+
+    uint64_t text_bytes = vector_bytes(texts);
+    for (const std::string& text : texts) {
+        text_bytes += string_bytes(text);
+    }
+    out.push_back({"prefixes.text", text_bytes, texts.size()});
+
+    // PrefixHash may throw, so libstdc++ caches the hash in each node
+    out.push_back({"prefixes.index", hash_table_bytes(ids, true), ids.size()});
+}
@@ -2,186 +2,763 @@
 #include "ASGraph.h"
 #include "Policy.h"
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
 
-// Relationship scores for conflict resolution
-const std::unordered_map<Relationship, int> PropagationEngine::REL_SCORES = {
-    {Relationship::ORIGIN, 3},
-    {Relationship::CUSTOMER, 2},
-    {Relationship::PEER, 1},
-    {Relationship::PROVIDER, 0}
-};
+// Spare route blocks kept in the pool between runs (16 MB); the rest are freed
+static constexpr size_t SPARE_BLOCKS_KEPT = 64;
 
-bool PropagationEngine::is_better_announcement(
-    const Announcement& ann1, 
-    const Announcement& ann2, 
-    const std::unordered_map<Relationship, int>& rel_scores
-) {
-    // Rule 1: Relationship (Customer > Peer > Provider)
-    int score1 = rel_scores.at(ann1.received_from_relationship);
-    int score2 = rel_scores.at(ann2.received_from_relationship);
-    if (score1 != score2) {
-        return score1 > score2;
+// A valley-free path climbs at most max_rank ranks, takes one peer hop and
+// descends at most max_rank ranks; it has to fit Announcement::path_length
+static void check_path_length_bound(int max_rank) {
+    if (2 * static_cast<uint64_t>(std::max(max_rank, 0)) + 2 > MAX_PATH_LENGTH) {
+        throw std::length_error("PropagationEngine: graph too deep for 16-bit AS path lengths");
     }
+}
 
-    // Rule 2: AS Path Length
-    if (ann1.as_path.size() != ann2.as_path.size()) {
-        return ann1.as_path.size() < ann2.as_path.size();
+PropagationEngine::PropagationEngine(ASGraph& graph) : graph(graph) {
+    sync_with_graph();
+}
+
+void PropagationEngine::sync_with_graph() {
+    const size_t n = graph.getNumNodes();
+    if (local_ribs.size() < n) {
+        local_ribs.reserve(n);
+        pending_routes.reserve(n);
+        while (local_ribs.size() < n) {
+            local_ribs.emplace_back(&rib_memory);
+            pending_routes.emplace_back(&pending_memory);
+        }
     }
+}
 
-    // Rule 3: Next Hop ASN (lower is better)
-    return ann1.next_hop_asn < ann2.next_hop_asn;
+void PropagationEngine::set_num_writers(size_t num_threads) {
+    path_tree.set_num_writers(num_threads);
+    rib_memory.set_num_writers(num_threads);
+    pending_memory.set_num_writers(num_threads);
 }
 
-void PropagationEngine::process_announcements(
-    ASNode* node, 
-    const std::unordered_map<Relationship, int>& rel_scores
-) {
-    BGP* policy = dynamic_cast<BGP*>(node->policy.get());
-    if (!policy || policy->received_queue.empty()) {
-        return;
+void PropagationEngine::bind_pending_to_ranks(const std::vector<std::vector<uint32_t>>& ranked_ases) {
+    while (rank_memory.size() < ranked_ases.size()) {
+        rank_memory.push_back(std::make_unique<Arena>(route_blocks));
+    }
+    std::vector<Arena*> arena_of(pending_routes.size(), nullptr);
+    for (size_t rank = 0; rank < ranked_ases.size(); ++rank) {
+        for (uint32_t index : ranked_ases[rank]) {
+            arena_of[index] = rank_memory[rank].get();
+        }
     }
 
-    // Check if this node uses ROV policy
-    ROV* rov_policy = dynamic_cast<ROV*>(node->policy.get());
-    bool is_rov = (rov_policy != nullptr);
+    // Assigning a table bound to another resource would keep the old one, so
+    // the (empty) tables are rebuilt
+    pending_routes.clear();
+    for (Arena* arena : arena_of) {
+        if (arena) pending_routes.emplace_back(arena);
+        else pending_routes.emplace_back(&pending_memory);
+    }
+}
 
-    for (auto const& [prefix, received_anns] : policy->received_queue) {
-        // Find the current best announcement for this prefix (if it exists)
-        Announcement* current_best = nullptr;
-        auto it = policy->local_rib.find(prefix);
-        if (it != policy->local_rib.end()) {
-            current_best = &it->second;
-        }
+void PropagationEngine::release_rank_pending(const std::vector<uint32_t>& nodes, size_t rank) {
+    // Rebinding drops each table's bucket array before the arena forgets it
+    Arena& arena = *rank_memory[rank];
+    for (uint32_t index : nodes) {
+        pending_routes[index] = PendingRoutes(&arena);
+    }
+    arena.release();
+}
 
-        // Compare against all newly received announcements
-        for (const auto& new_ann_const : received_anns) {
-            // ROV ASes drop announcements with rov_invalid=true
-            if (is_rov && new_ann_const.rov_invalid) {
-                continue;  // Drop this announcement
-            }
+void PropagationEngine::recycle_scratch(PendingRoutes& scratch, size_t writer) {
+    const size_t buckets = scratch.bucket_count();
+    scratch = PendingRoutes(&pending_memory);
+    pending_memory.reset(writer);
+    scratch.rehash(buckets);
+}
 
-            // The new path if we adopt this announcement includes our own ASN
-            Announcement potential_new_ann = new_ann_const;
-            potential_new_ann.as_path.insert(potential_new_ann.as_path.begin(), node->asn);
+void PropagationEngine::load_policies() {
+    const PolicyAssignment& policies = use_policy_overrides ? policy_overrides : graph.getPolicies();
+    for (size_t bit = 0; bit < NUM_FILTER_FLAGS; ++bit) {
+        filter_sets[bit] = policies.filtering(static_cast<uint8_t>(1u << bit));
+    }
+}
 
-            if (current_best == nullptr || is_better_announcement(potential_new_ann, *current_best, rel_scores)) {
-                // If the new one is better, it becomes the new best.
-                // We update the local_rib directly, and our pointer to it.
-                policy->local_rib[prefix] = potential_new_ann;
-                current_best = &policy->local_rib[prefix];
+void PropagationEngine::reset() {
+    origin_scratch.clear();
+    for (uint32_t i = 0; i < local_ribs.size(); ++i) {
+        for (const auto& [prefix, ann] : local_ribs[i]) {
+            if (ann.received_from_relationship == Relationship::ORIGIN) {
+                origin_scratch.push_back({RouteUpdate::ANNOUNCE, i, prefix, ann.rov_invalid});
             }
         }
+        local_ribs[i] = LocalRib(&rib_memory);
+    }
+    rib_memory.reset();
+    route_blocks.trim(SPARE_BLOCKS_KEPT);
+
+    // Origin paths are re-interned into the emptied tree
+    path_tree.clear();
+    for (const RouteUpdate& origin : origin_scratch) {
+        seed(origin.index, origin.prefix_id, origin.rov_invalid);
+    }
+}
+
+void PropagationEngine::compact_ribs() {
+    std::vector<Announcement> routes;
+    std::vector<uint32_t> counts(local_ribs.size());
+    for (size_t i = 0; i < local_ribs.size(); ++i) {
+        counts[i] = static_cast<uint32_t>(local_ribs[i].size());
+        for (const auto& rib_entry : local_ribs[i]) routes.push_back(rib_entry.second);
+        local_ribs[i] = LocalRib(&rib_memory);
+    }
+    rib_memory.release();
+
+    size_t at = 0;
+    for (size_t i = 0; i < local_ribs.size(); ++i) {
+        local_ribs[i].reserve(counts[i]);
+        for (uint32_t k = 0; k < counts[i]; ++k, ++at) local_ribs[i].emplace(routes[at].prefix_id, routes[at]);
+    }
+    compact_rib_bytes = rib_memory.bytes_reserved();
+}
+
+void PropagationEngine::seed(uint32_t index, uint32_t prefix_id, bool rov_invalid) {
+    sync_with_graph();
+    const uint32_t asn = graph.node(index).asn;
+    local_ribs[index][prefix_id] = Announcement(
+        prefix_id,
+        path_tree.extend(ASPathTree::EMPTY, asn),
+        1,
+        asn,
+        Relationship::ORIGIN,
+        rov_invalid
+    );
+}
+
+bool PropagationEngine::fold_candidate(
+    const LocalRib& local_rib,
+    PendingRoutes& pending,
+    uint32_t prefix,
+    const Announcement& candidate
+) {
+    auto pending_it = pending.find(prefix);
+    if (pending_it != pending.end()) {
+        if (is_better_announcement(candidate, pending_it->second)) {
+            pending_it->second = candidate;
+        }
+        return true;
+    }
+
+    auto rib_it = local_rib.find(prefix);
+    if (rib_it == local_rib.end()) {
+        pending.emplace(prefix, candidate);
+        return false;
     }
+    if (is_better_announcement(candidate, rib_it->second)) {
+        pending.emplace(prefix, candidate);
+    }
+    return true;
+}
+
+void PropagationEngine::begin_phase(size_t num_threads) {
+    thread_counters.assign(num_threads, PhaseCounters());
+}
+
+void PropagationEngine::end_phase(PhaseCounters RunStats::*phase) {
+    if (!stats) return;
+    for (const PhaseCounters& counters : thread_counters) {
+        (stats->*phase).merge(counters);
+    }
+}
+
+uint64_t PropagationEngine::adopted_so_far() const {
+    uint64_t adopted = 0;
+    for (const PhaseCounters& counters : thread_counters) adopted += counters.adopted;
+    return adopted;
+}
+
+void PropagationEngine::send_to_neighbors(uint32_t index, NeighborRange neighbors, Relationship rel, PhaseCounters& counters) {
+    if (neighbors.empty()) return;
+
+    const uint32_t asn = graph.node(index).asn;
+    counters.sent += local_ribs[index].size() * neighbors.size();
+    for (auto const& [prefix, ann] : local_ribs[index]) {
+        const uint8_t flags = route_flags(ann);
 
-    policy->received_queue.clear();
+        // What each neighbor receives, seen with its own ASN prepended.
+        // Only its length matters for comparison; the path itself is extended on adoption.
+        Announcement candidate = ann;
+        candidate.next_hop_asn = asn;
+        candidate.received_from_relationship = rel;
+        candidate.path_length += 1;
+
+        for (uint32_t neighbor : neighbors) {
+            // Policy filters, e.g. ROV ASes drop announcements with rov_invalid=true
+            if (filters(neighbor, flags)) {
+                counters.dropped++;
+                continue;
+            }
+            counters.compared += fold_candidate(local_ribs[neighbor], pending_routes[neighbor], prefix, candidate);
+        }
+    }
 }
 
 void PropagationEngine::propagate_up(
-    ASGraph& graph,
-    const std::vector<std::vector<ASNode*>>& ranked_ases,
+    const std::vector<std::vector<uint32_t>>& ranked_ases,
     int max_rank
 ) {
-    std::cout << "  - Propagating UP from customers to providers...\n";
+    if (verbose) std::cout << "  - Propagating UP from customers to providers...\n";
+    begin_phase(1);
+    PhaseCounters& counters = thread_counters[0];
     
     for (int rank = 0; rank <= max_rank; ++rank) {
-        // First, all nodes at this rank process announcements they have received
-        for (ASNode* node : ranked_ases[rank]) {
-            process_announcements(node, REL_SCORES);
+        Stopwatch rank_clock;
+        const uint64_t adopted_before = counters.adopted;
+
+        // First, all nodes at this rank adopt the best routes they have received
+        for (uint32_t index : ranked_ases[rank]) {
+            apply_pending(index, pending_routes[index], 0, counters);
         }
+        release_rank_pending(ranked_ases[rank], rank);
 
         // Second, all nodes at this rank send from their updated local RIB to providers
-        for (ASNode* node : ranked_ases[rank]) {
-            BGP* policy = dynamic_cast<BGP*>(node->policy.get());
-            if (!policy) continue;
-
-            for (auto const& [prefix, ann] : policy->local_rib) {
-                for (ASNode* provider : node->providers) {
-                    BGP* provider_policy = dynamic_cast<BGP*>(provider->policy.get());
-                    if (provider_policy) {
-                        Announcement prop_ann = ann;
-                        prop_ann.next_hop_asn = node->asn;
-                        prop_ann.received_from_relationship = Relationship::CUSTOMER;
-                        provider_policy->received_queue[prefix].push_back(prop_ann);
-                    }
-                }
-            }
+        for (uint32_t index : ranked_ases[rank]) {
+            send_to_neighbors(index, graph.providers(index), Relationship::CUSTOMER, counters);
+        }
+
+        if (stats) {
+            stats->up_ranks.push_back({rank, static_cast<uint32_t>(ranked_ases[rank].size()), rank_clock.wall_seconds(),
+                                       rank_clock.cpu_seconds(), counters.adopted - adopted_before});
         }
     }
+    end_phase(&RunStats::up);
 }
 
-void PropagationEngine::propagate_across(ASGraph& graph) {
-    std::cout << "  - Propagating ACROSS to peers...\n";
+void PropagationEngine::propagate_across(const std::vector<std::vector<uint32_t>>& ranked_ases) {
+    if (verbose) std::cout << "  - Propagating ACROSS to peers...\n";
+    begin_phase(1);
+    PhaseCounters& counters = thread_counters[0];
     
+    const uint32_t n = static_cast<uint32_t>(graph.getNumNodes());
+
     // First, all ASes send to their peers
-    for (auto const& [asn, node_ptr] : graph.getNodes()) {
-        ASNode* node = node_ptr.get();
-        BGP* policy = dynamic_cast<BGP*>(node->policy.get());
-        if (!policy) continue;
-
-        for (auto const& [prefix, ann] : policy->local_rib) {
-            for (ASNode* peer : node->peers) {
-                BGP* peer_policy = dynamic_cast<BGP*>(peer->policy.get());
-                if (peer_policy) {
-                    Announcement prop_ann = ann;
-                    prop_ann.next_hop_asn = node->asn;
-                    prop_ann.received_from_relationship = Relationship::PEER;
-                    peer_policy->received_queue[prefix].push_back(prop_ann);
-                }
-            }
-        }
+    for (uint32_t index = 0; index < n; ++index) {
+        send_to_neighbors(index, graph.peers(index), Relationship::PEER, counters);
     }
 
-    // Second, all ASes process announcements received from peers
-    for (auto const& [asn, node_ptr] : graph.getNodes()) {
-        process_announcements(node_ptr.get(), REL_SCORES);
+    // Second, all ASes adopt the best routes received from peers
+    for (uint32_t index = 0; index < n; ++index) {
+        apply_pending(index, pending_routes[index], 0, counters);
+    }
+    for (size_t rank = 0; rank < ranked_ases.size(); ++rank) {
+        release_rank_pending(ranked_ases[rank], rank);
     }
+    end_phase(&RunStats::across);
 }
 
 void PropagationEngine::propagate_down(
-    ASGraph& graph,
-    const std::vector<std::vector<ASNode*>>& ranked_ases,
+    const std::vector<std::vector<uint32_t>>& ranked_ases,
     int max_rank
 ) {
-    std::cout << "  - Propagating DOWN from providers to customers...\n";
+    if (verbose) std::cout << "  - Propagating DOWN from providers to customers...\n";
+    begin_phase(1);
+    PhaseCounters& counters = thread_counters[0];
     
     for (int rank = max_rank; rank >= 0; --rank) {
-        // First, process any announcements received from the previous (higher) rank or peers
-        for (ASNode* node : ranked_ases[rank]) {
-            process_announcements(node, REL_SCORES);
+        Stopwatch rank_clock;
+        const uint64_t adopted_before = counters.adopted;
+
+        // First, adopt any routes received from the previous (higher) rank
+        for (uint32_t index : ranked_ases[rank]) {
+            apply_pending(index, pending_routes[index], 0, counters);
         }
+        release_rank_pending(ranked_ases[rank], rank);
 
         // Second, send from local RIB to all customers
-        for (ASNode* node : ranked_ases[rank]) {
-            BGP* policy = dynamic_cast<BGP*>(node->policy.get());
-            if (!policy) continue;
-
-            for (auto const& [prefix, ann] : policy->local_rib) {
-                for (ASNode* customer : node->customers) {
-                    BGP* customer_policy = dynamic_cast<BGP*>(customer->policy.get());
-                    if (customer_policy) {
-                        Announcement prop_ann = ann;
-                        prop_ann.next_hop_asn = node->asn;
-                        prop_ann.received_from_relationship = Relationship::PROVIDER;
-                        customer_policy->received_queue[prefix].push_back(prop_ann);
+        for (uint32_t index : ranked_ases[rank]) {
+            send_to_neighbors(index, graph.customers(index), Relationship::PROVIDER, counters);
+        }
+
+        if (stats) {
+            stats->down_ranks.push_back({rank, static_cast<uint32_t>(ranked_ases[rank].size()), rank_clock.wall_seconds(),
+                                         rank_clock.cpu_seconds(), counters.adopted - adopted_before});
+        }
+    }
+    end_phase(&RunStats::down);
+}
+
+void PropagationEngine::pull_from_neighbors(
+    uint32_t index,
+    NeighborRange neighbors,
+    Relationship rel,
+    PendingRoutes& pending,
+    PhaseCounters& counters
+) const {
+    const LocalRib& local_rib = local_ribs[index];
+    uint8_t filter_mask = FILTER_NONE;
+    for (size_t bit = 0; bit < NUM_FILTER_FLAGS; ++bit) {
+        if (filter_sets[bit].test(index)) filter_mask |= static_cast<uint8_t>(1u << bit);
+    }
+
+    for (uint32_t neighbor : neighbors) {
+        const uint32_t sender_asn = graph.node(neighbor).asn;
+        counters.sent += local_ribs[neighbor].size();
+
+        for (auto const& [prefix, ann] : local_ribs[neighbor]) {
+            // Policy filters, e.g. ROV ASes drop announcements with rov_invalid=true
+            if (filter_mask & route_flags(ann)) {
+                counters.dropped++;
+                continue;
+            }
+
+            // What the sender would have offered, seen with our ASN prepended
+            Announcement candidate = ann;
+            candidate.next_hop_asn = sender_asn;
+            candidate.received_from_relationship = rel;
+            candidate.path_length += 1;
+
+            counters.compared += fold_candidate(local_rib, pending, prefix, candidate);
+        }
+    }
+}
+
+void PropagationEngine::apply_pending(uint32_t index, PendingRoutes& pending, size_t writer, PhaseCounters& counters) {
+    LocalRib& local_rib = local_ribs[index];
+    const uint32_t asn = graph.node(index).asn;
+    counters.adopted += pending.size();
+    counters.peak_pending = std::max<uint64_t>(counters.peak_pending, pending.size());
+    for (auto& [prefix, ann] : pending) {
+        ann.as_path = path_tree.extend(ann.as_path, asn, writer);
+        local_rib[prefix] = ann;
+    }
+    pending.clear();
+}
+
+void PropagationEngine::propagate_up_parallel(
+    const std::vector<std::vector<uint32_t>>& ranked_ases,
+    int max_rank,
+    ThreadPool& pool
+) {
+    if (verbose) std::cout << "  - Propagating UP from customers to providers...\n";
+
+    std::vector<PendingRoutes> scratch;
+    for (size_t t = 0; t < pool.size(); ++t) scratch.emplace_back(&pending_memory);
+    begin_phase(pool.size());
+
+    for (int rank = 0; rank <= max_rank; ++rank) {
+        Stopwatch rank_clock;
+        const uint64_t adopted_before = stats ? adopted_so_far() : 0;
+
+        // Rank 0 has no customers, so there is nothing to pull; it is still
+        // recorded so the per-rank stats cover the same ranks as the serial engine
+        const std::vector<uint32_t>& nodes = ranked_ases[rank];
+        if (rank > 0) pool.parallel_for(nodes.size(), [&](size_t i, size_t thread_id) {
+            ArenaSet::WriterScope writer({&rib_memory, &pending_memory}, thread_id);
+            uint32_t index = nodes[i];
+            PhaseCounters& counters = thread_counters[thread_id];
+            pull_from_neighbors(index, graph.customers(index), Relationship::CUSTOMER, scratch[thread_id], counters);
+            apply_pending(index, scratch[thread_id], thread_id, counters);
+            recycle_scratch(scratch[thread_id], thread_id);
+        });
+
+        if (stats) {
+            stats->up_ranks.push_back({rank, static_cast<uint32_t>(nodes.size()), rank_clock.wall_seconds(),
+                                       rank_clock.cpu_seconds(), adopted_so_far() - adopted_before});
+        }
+    }
+    end_phase(&RunStats::up);
+}
+
+void PropagationEngine::propagate_across_parallel(ThreadPool& pool) {
+    if (verbose) std::cout << "  - Propagating ACROSS to peers...\n";
+
+    const size_t n = graph.getNumNodes();
+
+    // Every node reads its peers' RIBs as they were after UP, so nothing may be
+    // applied until all nodes have pulled.
+    std::vector<PendingRoutes> pending;
+    pending.reserve(n);
+    for (size_t i = 0; i < n; ++i) pending.emplace_back(&pending_memory);
+    begin_phase(pool.size());
+    pool.parallel_for(n, [&](size_t i, size_t thread_id) {
+        ArenaSet::WriterScope writer({&rib_memory, &pending_memory}, thread_id);
+        uint32_t index = static_cast<uint32_t>(i);
+        pull_from_neighbors(index, graph.peers(index), Relationship::PEER, pending[i], thread_counters[thread_id]);
+    }, 64);
+
+    pool.parallel_for(n, [&](size_t i, size_t thread_id) {
+        ArenaSet::WriterScope writer({&rib_memory, &pending_memory}, thread_id);
+        apply_pending(static_cast<uint32_t>(i), pending[i], thread_id, thread_counters[thread_id]);
+    }, 64);
+    pending.clear();
+    pending_memory.reset();
+    end_phase(&RunStats::across);
+}
+
+void PropagationEngine::propagate_down_parallel(
+    const std::vector<std::vector<uint32_t>>& ranked_ases,
+    int max_rank,
+    ThreadPool& pool
+) {
+    if (verbose) std::cout << "  - Propagating DOWN from providers to customers...\n";
+
+    std::vector<PendingRoutes> scratch;
+    for (size_t t = 0; t < pool.size(); ++t) scratch.emplace_back(&pending_memory);
+    begin_phase(pool.size());
+
+    for (int rank = max_rank; rank >= 0; --rank) {
+        Stopwatch rank_clock;
+        const uint64_t adopted_before = stats ? adopted_so_far() : 0;
+
+        // The top rank has no providers, so there is nothing to pull; it is
+        // still recorded so the per-rank stats match the serial engine's
+        const std::vector<uint32_t>& nodes = ranked_ases[rank];
+        if (rank < max_rank) pool.parallel_for(nodes.size(), [&](size_t i, size_t thread_id) {
+            ArenaSet::WriterScope writer({&rib_memory, &pending_memory}, thread_id);
+            uint32_t index = nodes[i];
+            PhaseCounters& counters = thread_counters[thread_id];
+            pull_from_neighbors(index, graph.providers(index), Relationship::PROVIDER, scratch[thread_id], counters);
+            apply_pending(index, scratch[thread_id], thread_id, counters);
+            recycle_scratch(scratch[thread_id], thread_id);
+        });
+
+        if (stats) {
+            stats->down_ranks.push_back({rank, static_cast<uint32_t>(nodes.size()), rank_clock.wall_seconds(),
+                                         rank_clock.cpu_seconds(), adopted_so_far() - adopted_before});
+        }
+    }
+    end_phase(&RunStats::down);
+}
+
+namespace {
+
+// Per-thread scratch state for the prefix-major engine, sized once and reused for every prefix
+struct PrefixWorkspace {
+    std::vector<uint64_t> key;         // preference_key() of the best route, or NO_ROUTE_KEY
+    std::vector<uint8_t> flags;        // route_flags() of the best route
+    std::vector<uint32_t> next_hop;    // Dense index of the neighbor the route came from (self for seeds)
+    std::vector<PathHandle> path;      // Resolved after DOWN; preset for seeds
+
+    std::vector<uint32_t> touched;                 // ASes holding a route for the current prefix
+    std::vector<std::vector<uint32_t>> buckets;    // Per-rank worklists
+    std::vector<uint32_t> chain;                   // Scratch for path resolution
+
+    // Finished routes, grouped by node shard so the merge can run in parallel
+    std::vector<std::vector<std::pair<uint32_t, Announcement>>> results;
+
+    void init(size_t num_nodes, size_t num_ranks, size_t num_shards) {
+        key.assign(num_nodes, NO_ROUTE_KEY);
+        flags.assign(num_nodes, FILTER_NONE);
+        next_hop.assign(num_nodes, 0);
+        path.assign(num_nodes, ASPathTree::EMPTY);
+        buckets.assign(num_ranks, {});
+        results.assign(num_shards, {});
+    }
+};
+
+} // namespace
+
+void PropagationEngine::run_prefix_major(
+    int max_rank,
+    ThreadPool& pool
+) {
+    if (verbose) std::cout << "  - Propagating prefix by prefix (UP, ACROSS, DOWN)...\n";
+
+    // Before propagation every RIB entry is a seed
+    const uint32_t n = static_cast<uint32_t>(graph.getNumNodes());
+    std::vector<std::vector<uint32_t>> seeds_by_prefix;
+    for (uint32_t i = 0; i < n; ++i) {
+        for (auto const& [prefix, ann] : local_ribs[i]) {
+            if (prefix >= seeds_by_prefix.size()) {
+                seeds_by_prefix.resize(prefix + 1);
+            }
+            seeds_by_prefix[prefix].push_back(i);
+        }
+    }
+
+    propagate_prefixes(seeds_by_prefix, max_rank, pool);
+}
+
+void PropagationEngine::propagate_prefixes(
+    const std::vector<std::vector<uint32_t>>& seeds_by_prefix,
+    int max_rank,
+    ThreadPool& pool
+) {
+    const uint32_t n = static_cast<uint32_t>(graph.getNumNodes());
+
+    // Flat per-AS tables so the inner loops never touch ASNode
+    std::vector<uint32_t> asn_of(n);
+    std::vector<int> rank_of(n);
+    for (uint32_t i = 0; i < n; ++i) {
+        const ASNode& node = graph.node(i);
+        asn_of[i] = node.asn;
+        rank_of[i] = node.propagation_rank;
+    }
+
+    const size_t num_shards = pool.size() * 8;
+    std::vector<PrefixWorkspace> workspaces(pool.size());
+    for (PrefixWorkspace& ws : workspaces) {
+        ws.init(n, max_rank + 1, num_shards);
+    }
+
+    pool.parallel_for(seeds_by_prefix.size(), [&](size_t prefix_index, size_t thread_id) {
+        const std::vector<uint32_t>& seeds = seeds_by_prefix[prefix_index];
+        if (seeds.empty()) return;
+
+        const uint32_t prefix = static_cast<uint32_t>(prefix_index);
+        PrefixWorkspace& ws = workspaces[thread_id];
+
+        // Offer sender's route to receiver, keeping it if it wins under the usual
+        // selection rules. Returns true if the receiver had no route before.
+        auto offer = [&](uint32_t receiver, uint32_t sender, Relationship rel) {
+            if (filters(receiver, ws.flags[sender])) {
+                return false;  // Dropped by policy, e.g. ROV and rov_invalid
+            }
+
+            const uint64_t key = preference_key(rel, key_path_length(ws.key[sender]) + 1, asn_of[sender]);
+            const uint64_t current = ws.key[receiver];
+            if (key <= current) return false;
+
+            ws.key[receiver] = key;
+            ws.next_hop[receiver] = sender;
+            ws.flags[receiver] = ws.flags[sender];
+            if (current == NO_ROUTE_KEY) {
+                ws.touched.push_back(receiver);
+                return true;
+            }
+            return false;
+        };
+
+        // Seeds come straight from the RIBs
+        for (uint32_t origin : seeds) {
+            const Announcement& ann = local_ribs[origin].at(prefix);
+            ws.key[origin] = ann.preference();
+            ws.next_hop[origin] = origin;
+            ws.path[origin] = ann.as_path;
+            ws.flags[origin] = route_flags(ann);
+            ws.touched.push_back(origin);
+            ws.buckets[rank_of[origin]].push_back(origin);
+        }
+
+        // UP: a node's route is final once its rank is reached (customers are all lower)
+        for (int rank = 0; rank <= max_rank; ++rank) {
+            for (uint32_t sender : ws.buckets[rank]) {
+                for (uint32_t provider : graph.providers(sender)) {
+                    if (offer(provider, sender, Relationship::CUSTOMER)) {
+                        ws.buckets[rank_of[provider]].push_back(provider);
+                    }
+                }
+            }
+            ws.buckets[rank].clear();
+        }
+
+        // ACROSS: only routes held after UP are sent, so peer routes never travel two hops
+        const size_t up_count = ws.touched.size();
+        for (size_t k = 0; k < up_count; ++k) {
+            uint32_t sender = ws.touched[k];
+            for (uint32_t peer : graph.peers(sender)) {
+                offer(peer, sender, Relationship::PEER);
+            }
+        }
+
+        // DOWN: providers are always ranked above their customers
+        for (uint32_t i : ws.touched) {
+            ws.buckets[rank_of[i]].push_back(i);
+        }
+        for (int rank = max_rank; rank >= 0; --rank) {
+            for (size_t k = 0; k < ws.buckets[rank].size(); ++k) {
+                uint32_t sender = ws.buckets[rank][k];
+                for (uint32_t customer : graph.customers(sender)) {
+                    if (offer(customer, sender, Relationship::PROVIDER)) {
+                        ws.buckets[rank_of[customer]].push_back(customer);
                     }
                 }
             }
+            ws.buckets[rank].clear();
+        }
+
+        // Resolve paths: each route extends its next hop's final path
+        for (uint32_t i : ws.touched) {
+            uint32_t j = i;
+            while (ws.path[j] == ASPathTree::EMPTY && ws.next_hop[j] != j) {
+                ws.chain.push_back(j);
+                j = ws.next_hop[j];
+            }
+            while (!ws.chain.empty()) {
+                uint32_t k = ws.chain.back();
+                ws.chain.pop_back();
+                ws.path[k] = path_tree.extend(ws.path[ws.next_hop[k]], asn_of[k], thread_id);
+            }
+        }
+
+        // Emit learned routes (seeds are already in their RIBs) and reset the touched slots
+        for (uint32_t i : ws.touched) {
+            if (ws.next_hop[i] != i) {
+                ws.results[i % num_shards].emplace_back(i, Announcement(
+                    prefix,
+                    ws.path[i],
+                    static_cast<uint16_t>(key_path_length(ws.key[i])),
+                    asn_of[ws.next_hop[i]],
+                    key_relationship(ws.key[i]),
+                    (ws.flags[i] & FILTER_ROV_INVALID) != 0
+                ));
+            }
+            ws.key[i] = NO_ROUTE_KEY;
+            ws.path[i] = ASPathTree::EMPTY;
+        }
+        ws.touched.clear();
+    }, 16);
+
+    // Merge: each shard owns a disjoint set of nodes, so shards can fill RIBs concurrently
+    pool.parallel_for(num_shards, [&](size_t shard, size_t thread_id) {
+        ArenaSet::WriterScope writer({&rib_memory, &pending_memory}, thread_id);
+        for (PrefixWorkspace& ws : workspaces) {
+            for (auto const& [index, ann] : ws.results[shard]) {
+                local_ribs[index][ann.prefix_id] = ann;
+            }
+            std::vector<std::pair<uint32_t, Announcement>>().swap(ws.results[shard]);
+        }
+    });
+}
+
+void PropagationEngine::apply_updates(const std::vector<RouteUpdate>& updates, size_t num_threads) {
+    if (updates.empty()) return;
+
+    auto ranked_ases = graph.getRankedASes();
+    const int max_rank = static_cast<int>(ranked_ases.size()) - 1;
+    check_path_length_bound(max_rank);
+
+    sync_with_graph();
+    load_policies();
+
+    // Change the origins first; later updates in the batch win over earlier ones
+    std::vector<uint32_t> affected;
+    for (const RouteUpdate& update : updates) {
+        if (update.kind == RouteUpdate::ANNOUNCE) {
+            seed(update.index, update.prefix_id, update.rov_invalid);
+        } else {
+            auto it = local_ribs[update.index].find(update.prefix_id);
+            if (it != local_ribs[update.index].end() && it->second.received_from_relationship == Relationship::ORIGIN) {
+                local_ribs[update.index].erase(it);
+            }
+        }
+        affected.push_back(update.prefix_id);
+    }
+    std::sort(affected.begin(), affected.end());
+    affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+
+    // Drop the learned routes of the affected prefixes, keeping their origins as seeds
+    std::vector<std::vector<uint32_t>> seeds_by_prefix(affected.back() + 1);
+    const uint32_t n = static_cast<uint32_t>(graph.getNumNodes());
+    for (uint32_t i = 0; i < n; ++i) {
+        LocalRib& local_rib = local_ribs[i];
+        if (local_rib.empty()) continue;
+
+        for (uint32_t prefix : affected) {
+            auto it = local_rib.find(prefix);
+            if (it == local_rib.end()) continue;
+            if (it->second.received_from_relationship == Relationship::ORIGIN) {
+                seeds_by_prefix[prefix].push_back(i);
+            } else {
+                local_rib.erase(it);
+            }
         }
     }
+
+    ThreadPool pool(num_threads);
+    set_num_writers(pool.size());
+    propagate_prefixes(seeds_by_prefix, max_rank, pool);
+
+    // The arenas never free a replaced route, so repeated updates are bounded by compaction
+    if (compact_rib_bytes == 0) compact_rib_bytes = rib_memory.bytes_reserved();
+    else if (rib_memory.bytes_reserved() > 2 * compact_rib_bytes) compact_ribs();
+    route_blocks.trim(SPARE_BLOCKS_KEPT);
+
+    if (verbose) std::cout << "[Info] Applied " << updates.size() << " update(s), recomputed "
+              << affected.size() << " prefix(es).\n";
 }
 
-void PropagationEngine::run_propagation(ASGraph& graph) {
-    std::cout << "\n[Step 5] Running BGP propagation...\n";
+void PropagationEngine::run_propagation(size_t num_threads, EngineMode mode) {
+    if (verbose) std::cout << "\n[Step 5] Running BGP propagation...\n";
+
+    using Clock = std::chrono::steady_clock;
+    auto seconds_since = [](Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    };
+    const Clock::time_point run_start = Clock::now();
+    phase_times = PhaseTimes();
 
     // Get the ranked graph structure for propagation
     auto ranked_ases = graph.getRankedASes();
     int max_rank = ranked_ases.size() - 1;
+    check_path_length_bound(max_rank);
 
-    // Execute the three phases of BGP propagation
-    propagate_up(graph, ranked_ases, max_rank);
-    propagate_across(graph);
-    propagate_down(graph, ranked_ases, max_rank);
+    sync_with_graph();
+    load_policies();
+
+    if (mode == EngineMode::PREFIX_MAJOR) {
+        if (verbose) std::cout << "[Info] Using prefix-major engine with " << num_threads << " thread(s).\n";
+        ThreadPool pool(num_threads);
+        set_num_writers(pool.size());
+
+        // UP, ACROSS and DOWN are interleaved per prefix, so only the total is timed
+        run_prefix_major(max_rank, pool);
+    } else if (num_threads > 1) {
+        if (verbose) std::cout << "[Info] Using parallel engine with " << num_threads << " threads.\n";
+        ThreadPool pool(num_threads);
+        set_num_writers(pool.size());
+
+        Clock::time_point start = Clock::now();
+        propagate_up_parallel(ranked_ases, max_rank, pool);
+        phase_times.up = seconds_since(start);
+        start = Clock::now();
+        propagate_across_parallel(pool);
+        phase_times.across = seconds_since(start);
+        start = Clock::now();
+        propagate_down_parallel(ranked_ases, max_rank, pool);
+        phase_times.down = seconds_since(start);
+    } else {
+        // Execute the three phases of BGP propagation
+        bind_pending_to_ranks(ranked_ases);
+        Clock::time_point start = Clock::now();
+        propagate_up(ranked_ases, max_rank);
+        phase_times.up = seconds_since(start);
+        start = Clock::now();
+        propagate_across(ranked_ases);
+        phase_times.across = seconds_since(start);
+        start = Clock::now();
+        propagate_down(ranked_ases, max_rank);
+        phase_times.down = seconds_since(start);
+    }
+    phase_times.total = seconds_since(run_start);
+    compact_rib_bytes = rib_memory.bytes_reserved();
+    route_blocks.trim(SPARE_BLOCKS_KEPT);
     
-    std::cout << "[Info] Propagation complete.\n";
+    if (verbose) std::cout << "[Info] Propagation complete.\n";
 }
 
+void PropagationEngine::report_memory(MemoryUsage& out) const {
+    // RIB and pending nodes live in the arenas, counted by the blocks they hold
+    uint64_t routes = 0;
+    for (const LocalRib& rib : local_ribs) {
+        routes += rib.size();
+    }
+    out.push_back({"engine.local_ribs", vector_bytes(local_ribs) + rib_memory.bytes_reserved(), routes});
+
+    // Empty between runs; the serial engine's rank arenas have handed their blocks back by then
+    uint64_t pending = 0;
+    for (const PendingRoutes& queue : pending_routes) {
+        pending += queue.size();
+    }
+    uint64_t pending_bytes = vector_bytes(pending_routes) + pending_memory.bytes_reserved();
+    for (const auto& arena : rank_memory) {
+        pending_bytes += arena->bytes_reserved();
+    }
+    out.push_back({"engine.pending_routes", pending_bytes, pending});
+    out.push_back({"engine.spare_blocks", route_blocks.bytes_spare(), route_blocks.bytes_spare() / BlockPool::BLOCK_SIZE});
+
+    uint64_t policy_bytes = policy_overrides.memory_bytes();
+    for (const DenseBitset& set : filter_sets) {
+        policy_bytes += set.memory_bytes();
+    }
+    out.push_back({"engine.filter_sets", policy_bytes, graph.getNumNodes()});
+    out.push_back({"engine.path_tree", path_tree.memory_bytes(), path_tree.size()});
+}
@@ -0,0 +1,473 @@
+#include "QueryServer.h"
+#include "RibWriter.h"
+#include "Scenario.h"
+
+#include <iostream>
+#include <algorithm>
+#include <charconv>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// Receive buffer per connection; a request line may span several reads
+constexpr size_t READ_SIZE = 64 * 1024;
+
+bool parse_asn(const std::string& text, uint32_t& asn) {
+    if (text.empty() || text[0] < '0' || text[0] > '9') return false;
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long value = std::strtoul(text.c_str(), &end, 10);
+    if (*end != '\0' || errno == ERANGE || value > UINT32_MAX) return false;
+    asn = static_cast<uint32_t>(value);
+    return true;
+}
+
+std::vector<std::string> split(const std::string& text, char separator) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    for (;;) {
+        const size_t at = text.find(separator, start);
+        parts.push_back(text.substr(start, at == std::string::npos ? std::string::npos : at - start));
+        if (at == std::string::npos) return parts;
+        start = at + 1;
+    }
+}
+
+// Appends a ribs.csv row: asn,prefix,"(path)"
+void append_route(std::string& rows, uint32_t asn, const std::string& prefix_text,
+                  const ASPathTree& paths, const Announcement& ann) {
+    char number[16];
+    rows.append(number, std::to_chars(number, number + sizeof(number), asn).ptr);
+    rows += ',';
+    rows += prefix_text;
+    rows += ",\"(";
+    for (PathHandle h = ann.as_path; h != ASPathTree::EMPTY; h = paths.parent(h)) {
+        rows.append(number, std::to_chars(number, number + sizeof(number), paths.asn(h)).ptr);
+        if (paths.parent(h) != ASPathTree::EMPTY) {
+            rows += ", ";
+        } else if (ann.path_length == 1) {
+            rows += ',';
+        }
+    }
+    rows += ")\"\n";
+}
+
+// Appends every route of one RIB in prefix id order
+template <typename PrefixText>
+size_t append_rib(std::string& rows, uint32_t asn, const LocalRib& rib, const ASPathTree& paths, PrefixText&& prefix_text) {
+    std::vector<const Announcement*> routes;
+    sorted_routes(rib, routes);
+    for (const Announcement* ann : routes) append_route(rows, asn, prefix_text(ann->prefix_id), paths, *ann);
+    return routes.size();
+}
+
+void append_reply(std::string& out, size_t count, const std::string& rows) {
+    out += "OK ";
+    out += std::to_string(count);
+    out += '\n';
+    out += rows;
+}
+
+void append_error(std::string& out, const std::string& message) {
+    out += "ERR ";
+    out += message;
+    out += '\n';
+}
+
+bool send_all(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        const ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+QueryServer::QueryServer(ASGraph& graph, const PropagationEngine& engine, const PrefixTable& prefixes,
+                         size_t num_threads, EngineMode mode)
+    : graph(graph), engine(engine), prefixes(prefixes), num_threads(num_threads), mode(mode), lpm(prefixes) {
+    // Freeze and rank up front so scenario engines only ever read the graph
+    graph.getRankedASes();
+
+    // An origin always keeps its own announcement, so the ORIGIN entries are the seeds
+    for (uint32_t i = 0; i < graph.getNumNodes(); ++i) {
+        for (const auto& [prefix, ann] : engine.local_rib(i)) {
+            if (ann.received_from_relationship == Relationship::ORIGIN) {
+                seeds.push_back({i, prefix, ann.rov_invalid});
+            }
+        }
+    }
+
+    if (::pipe(wake_pipe) != 0) {
+        wake_pipe[0] = wake_pipe[1] = -1;
+    }
+}
+
+QueryServer::~QueryServer() {
+    stop();
+    for (int fd : wake_pipe) {
+        if (fd >= 0) ::close(fd);
+    }
+}
+
+std::unique_ptr<PropagationEngine> QueryServer::take_engine() {
+    {
+        std::lock_guard<std::mutex> lock(engines_mutex);
+        if (!idle_engines.empty()) {
+            std::unique_ptr<PropagationEngine> scenario_engine = std::move(idle_engines.back());
+            idle_engines.pop_back();
+            return scenario_engine;
+        }
+    }
+    auto scenario_engine = std::make_unique<PropagationEngine>(graph);
+    scenario_engine->set_verbose(false);
+    for (const Seed& seed : seeds) scenario_engine->seed(seed.index, seed.prefix_id, seed.rov_invalid);
+    return scenario_engine;
+}
+
+void QueryServer::return_engine(std::unique_ptr<PropagationEngine> scenario_engine) {
+    scenario_engine->reset();
+    std::lock_guard<std::mutex> lock(engines_mutex);
+    idle_engines.push_back(std::move(scenario_engine));
+}
+
+void QueryServer::answer_route(const std::string& args, std::string& out) const {
+    const std::vector<std::string> fields = split(args, ' ');
+    uint32_t asn;
+    Prefix prefix;
+    if (fields.size() != 2 || !parse_asn(fields[0], asn)) {
+        append_error(out, "usage: ROUTE <asn> <prefix>");
+        return;
+    }
+    const ASNode* node = graph.findNode(asn);
+    if (!node) {
+        append_error(out, "unknown AS " + fields[0]);
+        return;
+    }
+    if (!parse_prefix(fields[1], prefix)) {
+        append_error(out, "invalid prefix " + fields[1]);
+        return;
+    }
+
+    std::string rows;
+    size_t count = 0;
+    const uint32_t prefix_id = prefixes.find(prefix);
+    if (prefix_id != PrefixTable::INVALID_ID) {
+        const LocalRib& rib = engine.local_rib(node->index);
+        auto it = rib.find(prefix_id);
+        if (it != rib.end()) {
+            append_route(rows, asn, prefixes.to_string(prefix_id), engine.paths(), it->second);
+            count = 1;
+        }
+    }
+    append_reply(out, count, rows);
+}
+
+void QueryServer::answer_rib(const std::string& args, std::string& out) const {
+    uint32_t asn;
+    if (!parse_asn(args, asn)) {
+        append_error(out, "usage: RIB <asn>");
+        return;
+    }
+    const ASNode* node = graph.findNode(asn);
+    if (!node) {
+        append_error(out, "unknown AS " + args);
+        return;
+    }
+
+    std::string rows;
+    const size_t count = append_rib(rows, asn, engine.local_rib(node->index), engine.paths(),
+                                    [this](uint32_t id) -> const std::string& { return prefixes.to_string(id); });
+    append_reply(out, count, rows);
+}
+
+void QueryServer::answer_lookup(const std::string& args, std::string& out) const {
+    const std::vector<std::string> fields = split(args, ' ');
+    uint32_t asn;
+    Prefix address;
+    if (fields.size() != 2 || !parse_asn(fields[0], asn)) {
+        append_error(out, "usage: LOOKUP <asn> <address>");
+        return;
+    }
+    const ASNode* node = graph.findNode(asn);
+    if (!node) {
+        append_error(out, "unknown AS " + fields[0]);
+        return;
+    }
+    if (!parse_prefix(fields[1], address)) {
+        append_error(out, "invalid address " + fields[1]);
+        return;
+    }
+
+    std::string rows;
+    const Announcement* route = lookup_route(lpm, engine.local_rib(node->index), address);
+    if (route) append_route(rows, asn, prefixes.to_string(route->prefix_id), engine.paths(), *route);
+    append_reply(out, route ? 1 : 0, rows);
+}
+
+void QueryServer::answer_scenario(const std::string& args, std::string& out) {
+    bool override_rov = false;
+    PolicyAssignment policies;
+    std::vector<Seed> extra_seeds;
+    std::vector<std::pair<uint32_t, uint32_t>> route_queries;  // (index, prefix id)
+    std::vector<uint32_t> rib_queries;
+
+    // Prefixes the announcements add on top of the table get ids past its end
+    std::vector<Prefix> extra_prefixes;
+    std::vector<std::string> extra_texts;
+    auto prefix_id_of = [&](const Prefix& prefix) {
+        const uint32_t id = prefixes.find(prefix);
+        if (id != PrefixTable::INVALID_ID) return id;
+        for (size_t i = 0; i < extra_prefixes.size(); ++i) {
+            if (extra_prefixes[i] == prefix) return static_cast<uint32_t>(prefixes.size() + i);
+        }
+        return PrefixTable::INVALID_ID;
+    };
+    auto prefix_text = [&](uint32_t id) -> const std::string& {
+        return id < prefixes.size() ? prefixes.to_string(id) : extra_texts[id - prefixes.size()];
+    };
+    auto find_index = [&](const std::string& text, uint32_t& index) {
+        uint32_t asn;
+        const ASNode* node = parse_asn(text, asn) ? graph.findNode(asn) : nullptr;
+        if (!node) {
+            append_error(out, "unknown AS " + text);
+            return false;
+        }
+        index = node->index;
+        return true;
+    };
+
+    for (const std::string& arg : split(args, ' ')) {
+        if (arg.empty()) continue;
+        const size_t eq = arg.find('=');
+        const std::string key = arg.substr(0, eq);
+        const std::vector<std::string> values = split(eq == std::string::npos ? "" : arg.substr(eq + 1), ',');
+        uint32_t index;
+
+        if (key == "rov") {
+            override_rov = true;
+            for (const std::string& value : values) {
+                if (value.empty()) continue;
+                if (!find_index(value, index)) return;
+                policies.assign(index, PolicyKind::ROV);
+            }
+        } else if (key == "ann" && values.size() == 3) {
+            Prefix prefix;
+            if (!find_index(values[0], index)) return;
+            if (!parse_prefix(values[1], prefix)) {
+                append_error(out, "invalid prefix " + values[1]);
+                return;
+            }
+            uint32_t prefix_id = prefix_id_of(prefix);
+            if (prefix_id == PrefixTable::INVALID_ID) {
+                prefix_id = static_cast<uint32_t>(prefixes.size() + extra_prefixes.size());
+                extra_prefixes.push_back(prefix);
+                extra_texts.push_back(values[1]);
+            }
+            const bool rov_invalid = values[2] == "True" || values[2] == "true" || values[2] == "1";
+            extra_seeds.push_back({index, prefix_id, rov_invalid});
+        } else if (key == "route" && values.size() == 2) {
+            Prefix prefix;
+            if (!find_index(values[0], index)) return;
+            if (!parse_prefix(values[1], prefix)) {
+                append_error(out, "invalid prefix " + values[1]);
+                return;
+            }
+            route_queries.push_back({index, prefix_id_of(prefix)});
+        } else if (key == "rib" && values.size() == 1) {
+            if (!find_index(values[0], index)) return;
+            rib_queries.push_back(index);
+        } else {
+            append_error(out, "invalid scenario argument " + arg);
+            return;
+        }
+    }
+
+    std::unique_ptr<PropagationEngine> scenario_engine = take_engine();
+    if (override_rov) scenario_engine->set_policies(policies);
+    else scenario_engine->clear_policies();
+    for (const Seed& seed : extra_seeds) scenario_engine->seed(seed.index, seed.prefix_id, seed.rov_invalid);
+    scenario_engine->run_propagation(num_threads, mode);
+
+    const ScenarioResult summary = summarize_ribs(*scenario_engine);
+    std::string rows = "routes=" + std::to_string(summary.routes) + " invalid_routes=" + std::to_string(summary.invalid_routes) +
+                       " ases_with_invalid=" + std::to_string(summary.ases_with_invalid) + "\n";
+    size_t count = 1;
+    const ASPathTree& paths = scenario_engine->paths();
+    for (const auto& [index, prefix_id] : route_queries) {
+        const LocalRib& rib = scenario_engine->local_rib(index);
+        auto it = prefix_id == PrefixTable::INVALID_ID ? rib.end() : rib.find(prefix_id);
+        if (it != rib.end()) {
+            append_route(rows, graph.node(index).asn, prefix_text(prefix_id), paths, it->second);
+            count++;
+        }
+    }
+    for (uint32_t index : rib_queries) {
+        count += append_rib(rows, graph.node(index).asn, scenario_engine->local_rib(index), paths, prefix_text);
+    }
+    append_reply(out, count, rows);
+
+    // Extra announcements stay seeded through reset(), so such an engine is not reused
+    if (extra_seeds.empty()) return_engine(std::move(scenario_engine));
+}
+
+bool QueryServer::handle(const std::string& request, std::string& out) {
+    std::string line = request;
+    while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+    if (line.empty()) return true;
+
+    const size_t space = line.find(' ');
+    const std::string command = line.substr(0, space);
+    const std::string args = space == std::string::npos ? "" : line.substr(space + 1);
+
+    try {
+        if (command == "ROUTE") {
+            answer_route(args, out);
+        } else if (command == "RIB") {
+            answer_rib(args, out);
+        } else if (command == "LOOKUP") {
+            answer_lookup(args, out);
+        } else if (command == "SCENARIO") {
+            answer_scenario(args, out);
+        } else if (command == "PING") {
+            append_reply(out, 0, "");
+        } else if (command == "QUIT") {
+            return false;
+        } else if (command == "SHUTDOWN") {
+            append_reply(out, 0, "");
+            stop();
+            return false;
+        } else {
+            append_error(out, "unknown command " + command);
+        }
+    } catch (const std::exception& e) {
+        // e.g. a scenario path longer than an Announcement can hold
+        append_error(out, e.what());
+    }
+    return true;
+}
+
+void QueryServer::serve_client(int fd) {
+    std::vector<char> buffer(READ_SIZE);
+    std::string pending;
+    std::string out;
+    bool open = true;
+
+    while (open) {
+        const ssize_t got = ::recv(fd, buffer.data(), buffer.size(), 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        pending.append(buffer.data(), static_cast<size_t>(got));
+
+        // Answer every complete line received so far, then reply in one write
+        size_t start = 0;
+        for (size_t nl; open && (nl = pending.find('\n', start)) != std::string::npos; start = nl + 1) {
+            open = handle(pending.substr(start, nl - start), out);
+        }
+        pending.erase(0, start);
+        if (!send_all(fd, out)) break;
+        out.clear();
+    }
+
+    std::lock_guard<std::mutex> lock(clients_mutex);
+    client_fds.erase(std::find(client_fds.begin(), client_fds.end(), fd));
+    ::close(fd);
+    finished_clients.push_back(std::this_thread::get_id());
+}
+
+void QueryServer::reap_finished_clients() {
+    for (std::thread::id id : finished_clients) {
+        auto it = std::find_if(client_threads.begin(), client_threads.end(),
+                               [id](const std::thread& thread) { return thread.get_id() == id; });
+        if (it == client_threads.end()) continue;
+        // The thread is past its last use of shared state, so this join only waits for it to exit
+        it->join();
+        *it = std::move(client_threads.back());
+        client_threads.pop_back();
+    }
+    finished_clients.clear();
+}
+
+bool QueryServer::serve(const std::string& socket_path) {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Error: Socket path is too long: " << socket_path << std::endl;
+        return false;
+    }
+    std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    if (wake_pipe[0] < 0) {
+        std::cerr << "Error: Could not create the server wake-up pipe." << std::endl;
+        return false;
+    }
+    // Only a stale socket may be replaced; never delete a regular file given by mistake
+    struct stat existing;
+    if (::lstat(socket_path.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            std::cerr << "Error: " << socket_path << " exists and is not a socket." << std::endl;
+            return false;
+        }
+        ::unlink(socket_path.c_str());
+    }
+    const int listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0 || ::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(listen_fd, SOMAXCONN) != 0) {
+        std::cerr << "Error: Could not listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+        if (listen_fd >= 0) ::close(listen_fd);
+        return false;
+    }
+
+    while (!stopping) {
+        pollfd fds[2] = {{listen_fd, POLLIN, 0}, {wake_pipe[0], POLLIN, 0}};
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents) break;
+        if (!(fds[0].revents & POLLIN)) continue;
+
+        const int fd = ::accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) continue;
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        reap_finished_clients();
+        client_fds.push_back(fd);
+        client_threads.emplace_back(&QueryServer::serve_client, this, fd);
+    }
+    ::close(listen_fd);
+    ::unlink(socket_path.c_str());
+
+    // Wake clients blocked in recv but let replies in flight (SHUTDOWN's own) go out;
+    // each thread closes its own connection
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        for (int fd : client_fds) ::shutdown(fd, SHUT_RD);
+        threads.swap(client_threads);
+        finished_clients.clear();
+    }
+    for (std::thread& thread : threads) thread.join();
+    return true;
+}
+
+void QueryServer::stop() {
+    if (stopping.exchange(true)) return;
+    if (wake_pipe[1] >= 0) {
+        const char byte = 1;
+        (void)!::write(wake_pipe[1], &byte, 1);
+    }
+}
@@ -0,0 +1,168 @@
+#include "RibBinary.h"
+#include "Checksum.h"
+
+#include <iostream>
+#include <cstring>
+#include <charconv>
+#include <vector>
+#include <algorithm>
+
+const char RIB_BINARY_MAGIC[8] = {'B', 'G', 'P', 'R', 'I', 'B', 'S', '1'};
+
+bool RibBinaryReader::open(const std::string& path) {
+    auto mapped = std::make_unique<MappedFile>(path);
+    if (!mapped->ok()) {
+        std::cerr << "Error: cannot open binary RIB file: " << path << "\n";
+        return false;
+    }
+    if (mapped->size() < sizeof(RibBinaryHeader)) {
+        std::cerr << "Error: binary RIB file is truncated: " << path << "\n";
+        return false;
+    }
+
+    RibBinaryHeader h;
+    std::memcpy(&h, mapped->data(), sizeof(h));
+    if (std::memcmp(h.magic, RIB_BINARY_MAGIC, sizeof(h.magic)) != 0) {
+        std::cerr << "Error: not a binary RIB file: " << path << "\n";
+        return false;
+    }
+    if (h.version != RIB_BINARY_VERSION) {
+        std::cerr << "Error: binary RIB version " << h.version
+                  << " is not supported (expected " << RIB_BINARY_VERSION << "): " << path << "\n";
+        return false;
+    }
+
+    const uint64_t limit = mapped->size();
+    if (h.num_rows > limit || h.num_ases > limit || h.num_paths == 0 || h.num_paths > limit ||
+        h.num_prefixes > limit || h.prefix_text_bytes > limit) {
+        std::cerr << "Error: binary RIB header is corrupt: " << path << "\n";
+        return false;
+    }
+
+    const size_t section_bytes[] = {
+        h.num_ases * 4, (h.num_ases + 1) * 8,
+        h.num_rows * 4, h.num_rows * 4,
+        h.num_paths * 4, h.num_paths * 4,
+        (h.num_prefixes + 1) * 4,
+        h.prefix_text_bytes,
+    };
+    size_t payload = 0;
+    for (size_t bytes : section_bytes) payload += padded_size(bytes);
+
+    if (limit != sizeof(h) + payload) {
+        std::cerr << "Error: binary RIB size does not match its header: " << path << "\n";
+        return false;
+    }
+
+    const char* base = mapped->data() + sizeof(h);
+    if (checksum_words(CHECKSUM_SEED, base, payload) != h.checksum) {
+        std::cerr << "Error: binary RIB checksum mismatch: " << path << "\n";
+        return false;
+    }
+
+    constexpr size_t NUM_SECTIONS = sizeof(section_bytes) / sizeof(section_bytes[0]);
+    const char* section[NUM_SECTIONS];
+    const char* cursor = base;
+    for (size_t i = 0; i < NUM_SECTIONS; ++i) {
+        section[i] = cursor;
+        cursor += padded_size(section_bytes[i]);
+    }
+
+    const uint64_t* runs = reinterpret_cast<const uint64_t*>(section[1]);
+    const uint32_t* rows_prefix = reinterpret_cast<const uint32_t*>(section[2]);
+    const uint32_t* rows_path = reinterpret_cast<const uint32_t*>(section[3]);
+    const uint32_t* parents = reinterpret_cast<const uint32_t*>(section[5]);
+    const uint32_t* offsets = reinterpret_cast<const uint32_t*>(section[6]);
+
+    // Every walk must terminate and every index must be in range
+    bool valid = parents[0] == 0 && offsets[0] == 0 && offsets[h.num_prefixes] == h.prefix_text_bytes &&
+                 runs[0] == 0 && runs[h.num_ases] == h.num_rows;
+    for (uint64_t i = 0; valid && i < h.num_ases; ++i) {
+        valid = runs[i] < runs[i + 1];
+    }
+    for (uint64_t id = 1; valid && id < h.num_paths; ++id) {
+        valid = parents[id] < id;
+    }
+    for (uint64_t i = 0; valid && i < h.num_prefixes; ++i) {
+        valid = offsets[i] <= offsets[i + 1];
+    }
+    for (uint64_t r = 0; valid && r < h.num_rows; ++r) {
+        valid = rows_prefix[r] < h.num_prefixes && rows_path[r] < h.num_paths;
+    }
+    if (!valid) {
+        std::cerr << "Error: binary RIB contents are corrupt: " << path << "\n";
+        return false;
+    }
+
+    header = h;
+    as_asn_col = reinterpret_cast<const uint32_t*>(section[0]);
+    as_rows_col = runs;
+    row_prefix = rows_prefix;
+    row_path = rows_path;
+    path_asn_col = reinterpret_cast<const uint32_t*>(section[4]);
+    path_parent_col = parents;
+    prefix_offsets = offsets;
+    prefix_text = section[7];
+    file = std::move(mapped);
+    return true;
+}
+
+uint32_t RibBinaryReader::asn(uint64_t row) const {
+    const uint64_t* run = std::upper_bound(as_rows_col + 1, as_rows_col + header.num_ases + 1, row);
+    return as_asn_col[run - as_rows_col - 1];
+}
+
+bool RibBinaryReader::write_csv(std::FILE* out) const {
+    std::vector<char> buffer(1 << 20);
+    size_t used = 0;
+
+    auto flush = [&]() {
+        bool ok = std::fwrite(buffer.data(), 1, used, out) == used;
+        used = 0;
+        return ok;
+    };
+
+    static const char header_row[] = "asn,prefix,as_path\n";
+    std::memcpy(buffer.data(), header_row, sizeof(header_row) - 1);
+    used = sizeof(header_row) - 1;
+
+    for (uint64_t a = 0; a < header.num_ases; ++a) {
+        const uint32_t asn = as_asn_col[a];
+        for (uint64_t r = as_rows_col[a]; r < as_rows_col[a + 1]; ++r) {
+            const uint32_t prefix = row_prefix[r];
+            const size_t prefix_len = prefix_offsets[prefix + 1] - prefix_offsets[prefix];
+
+            // Make room for the row; long paths are bounded by the path table depth
+            size_t path_len = 0;
+            for (uint32_t id = row_path[r]; id != 0; id = path_parent_col[id]) path_len++;
+            const size_t bound = 32 + prefix_len + path_len * 12;
+            if (used + bound > buffer.size()) {
+                if (!flush()) return false;
+                if (bound > buffer.size()) buffer.resize(bound);
+            }
+
+            // The holder is both the row's ASN and the first hop of its path
+            char* p = buffer.data() + used;
+            p = std::to_chars(p, p + 10, asn).ptr;
+            *p++ = ',';
+            std::memcpy(p, prefix_text + prefix_offsets[prefix], prefix_len);
+            p += prefix_len;
+            *p++ = ',';
+            *p++ = '"';
+            *p++ = '(';
+            p = std::to_chars(p, p + 10, asn).ptr;
+            *p++ = ',';
+            for (uint32_t id = row_path[r]; id != 0; id = path_parent_col[id]) {
+                *p++ = ' ';
+                p = std::to_chars(p, p + 10, path_asn_col[id]).ptr;
+                if (path_parent_col[id] != 0) *p++ = ',';
+            }
+            *p++ = ')';
+            *p++ = '"';
+            *p++ = '\n';
+            used = static_cast<size_t>(p - buffer.data());
+        }
+    }
+
+    return flush();
+}
@@ -0,0 +1,339 @@
+#include "RibWriter.h"
+#include "ThreadPool.h"
+#include "RibBinary.h"
+#include "Checksum.h"
+
+#include <zlib.h>
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <charconv>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+
+// Target rows per formatting run; an AS with a larger RIB gets a run of its own
+constexpr size_t ROWS_PER_RUN = 1 << 16;
+
+// Upper bound on the characters of one printed uint32 plus its separator
+constexpr size_t MAX_NUMBER_CHARS = 12;
+
+// A contiguous range of node indices formatted by one thread
+struct Run {
+    uint32_t first;
+    uint32_t last;
+};
+
+// Growable byte buffer whose capacity is kept between runs
+struct OutBuffer {
+    std::vector<char> bytes;
+    size_t length = 0;
+
+    // Returns room for at least n more bytes at the end
+    char* reserve(size_t n) {
+        if (length + n > bytes.size()) {
+            bytes.resize(std::max(bytes.size() * 2, length + n));
+        }
+        return bytes.data() + length;
+    }
+    void commit(char* end) { length = static_cast<size_t>(end - bytes.data()); }
+};
+
+inline char* write_uint(char* out, uint32_t value) {
+    return std::to_chars(out, out + MAX_NUMBER_CHARS, value).ptr;
+}
+
+// Formats all rows of nodes [run.first, run.last) into out
+void format_run(const PropagationEngine& engine, const PrefixTable& prefixes, Run run, OutBuffer& out) {
+    const ASGraph& graph = engine.getGraph();
+    const ASPathTree& paths = engine.paths();
+    std::vector<const Announcement*> entries;
+
+    for (uint32_t index = run.first; index < run.last; ++index) {
+        const uint32_t asn = graph.node(index).asn;
+
+        sorted_routes(engine.local_rib(index), entries);
+        for (const Announcement* entry : entries) {
+            const Announcement& ann = *entry;
+            const std::string& prefix_text = prefixes.to_string(ann.prefix_id);
+
+            char* p = out.reserve(MAX_NUMBER_CHARS + prefix_text.size() + 8 + ann.path_length * MAX_NUMBER_CHARS);
+            p = write_uint(p, asn);
+            *p++ = ',';
+            std::memcpy(p, prefix_text.data(), prefix_text.size());
+            p += prefix_text.size();
+
+            // Python tuple: "(1, 2, 3)", or "(1,)" for a single element.
+            // The path is read by walking the handle up the shared path tree.
+            *p++ = ',';
+            *p++ = '"';
+            *p++ = '(';
+            for (PathHandle h = ann.as_path; h != ASPathTree::EMPTY; h = paths.parent(h)) {
+                p = write_uint(p, paths.asn(h));
+                if (paths.parent(h) != ASPathTree::EMPTY) {
+                    *p++ = ',';
+                    *p++ = ' ';
+                } else if (ann.path_length == 1) {
+                    *p++ = ',';
+                }
+            }
+            *p++ = ')';
+            *p++ = '"';
+            *p++ = '\n';
+            out.commit(p);
+        }
+    }
+}
+
+// Compresses in into out as one complete gzip member
+bool gzip_member(const OutBuffer& in, OutBuffer& out) {
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    // Fastest level: the dump is written and read once, so throughput beats ratio.
+    // windowBits 15 + 16 selects the gzip wrapper.
+    if (deflateInit2(&zs, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+
+    const uLong bound = deflateBound(&zs, static_cast<uLong>(in.length));
+    out.length = 0;
+    char* dst = out.reserve(bound);
+
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.bytes.data()));
+    zs.avail_in = static_cast<uInt>(in.length);
+    zs.next_out = reinterpret_cast<Bytef*>(dst);
+    zs.avail_out = static_cast<uInt>(bound);
+
+    const bool ok = deflate(&zs, Z_FINISH) == Z_STREAM_END;
+    out.commit(dst + zs.total_out);
+    deflateEnd(&zs);
+    return ok;
+}
+
+} // namespace
+
+// The hash map's iteration order depends on insertion history, which differs
+// between the serial, receiver-pull and prefix-major engines; sorting makes
+// every engine write byte-identical files.
+void sorted_routes(const LocalRib& rib, std::vector<const Announcement*>& routes) {
+    routes.clear();
+    routes.reserve(rib.size());
+    for (const auto& rib_entry : rib) routes.push_back(&rib_entry.second);
+    std::sort(routes.begin(), routes.end(),
+              [](const Announcement* a, const Announcement* b) { return a->prefix_id < b->prefix_id; });
+}
+
+bool write_ribs_csv(
+    const PropagationEngine& engine,
+    const PrefixTable& prefixes,
+    const std::string& path,
+    size_t num_threads,
+    OutputCompression compression,
+    uint64_t* rows_written
+) {
+    const ASGraph& graph = engine.getGraph();
+    const uint32_t n = static_cast<uint32_t>(graph.getNumNodes());
+
+    // Cut the nodes into runs of about ROWS_PER_RUN rows each
+    std::vector<Run> runs;
+    uint64_t total_rows = 0;
+    size_t run_rows = 0;
+    uint32_t run_start = 0;
+    for (uint32_t index = 0; index < n; ++index) {
+        const size_t rows = engine.local_rib(index).size();
+        total_rows += rows;
+        run_rows += rows;
+        if (run_rows >= ROWS_PER_RUN) {
+            runs.push_back({run_start, index + 1});
+            run_start = index + 1;
+            run_rows = 0;
+        }
+    }
+    if (run_start < n || runs.empty()) {
+        runs.push_back({run_start, n});
+    }
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error: Could not open " << path << " for writing.\n";
+        return false;
+    }
+
+    ThreadPool pool(num_threads);
+    const bool gzip = compression == OutputCompression::GZIP;
+
+    // One formatting slot (and one compression slot) per thread, reused for every batch
+    std::vector<OutBuffer> text(pool.size());
+    std::vector<OutBuffer> packed(gzip ? pool.size() : 0);
+    std::vector<char> failed(pool.size(), 0);
+    bool ok = true;
+
+    for (size_t batch = 0; batch < runs.size() && ok; batch += pool.size()) {
+        const size_t batch_size = std::min(pool.size(), runs.size() - batch);
+
+        pool.parallel_for(batch_size, [&](size_t slot, size_t) {
+            OutBuffer& out = text[slot];
+            out.length = 0;
+            if (batch + slot == 0) {
+                static const char header[] = "asn,prefix,as_path\n";
+                char* p = out.reserve(sizeof(header) - 1);
+                std::memcpy(p, header, sizeof(header) - 1);
+                out.commit(p + sizeof(header) - 1);
+            }
+            format_run(engine, prefixes, runs[batch + slot], out);
+            if (gzip && !gzip_member(out, packed[slot])) {
+                failed[slot] = 1;
+            }
+        });
+
+        // Write the finished slots in node order
+        for (size_t slot = 0; slot < batch_size && ok; ++slot) {
+            const OutBuffer& out = gzip ? packed[slot] : text[slot];
+            if (failed[slot] || std::fwrite(out.bytes.data(), 1, out.length, file) != out.length) {
+                ok = false;
+            }
+        }
+    }
+
+    if (std::fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        std::cerr << "Error: failed writing " << path << ".\n";
+        return false;
+    }
+
+    if (rows_written) *rows_written = total_rows;
+    return true;
+}
+
+bool write_ribs_binary(
+    const PropagationEngine& engine,
+    const PrefixTable& prefixes,
+    const std::string& path,
+    uint64_t* rows_written
+) {
+    const ASGraph& graph = engine.getGraph();
+    const ASPathTree& paths = engine.paths();
+    const uint32_t n = static_cast<uint32_t>(graph.getNumNodes());
+
+    size_t total_rows = 0;
+    for (uint32_t index = 0; index < n; ++index) {
+        total_rows += engine.local_rib(index).size();
+    }
+
+    std::vector<uint32_t> as_asn, row_prefix, row_path;
+    std::vector<uint64_t> as_rows{0};
+    row_prefix.reserve(total_rows);
+    row_path.reserve(total_rows);
+
+    // Path table, renumbered densely in the order paths are first reached.
+    // Entry 0 is the empty path; a parent always gets its id before its children.
+    constexpr uint32_t UNASSIGNED = UINT32_MAX;
+    std::vector<uint32_t> path_asn{0}, path_parent{0};
+    std::vector<uint32_t> table_id(paths.handle_limit(), UNASSIGNED);
+    table_id[ASPathTree::EMPTY] = 0;
+
+    // The same path can exist under several handles (one per path-tree writer
+    // that built it), so entries are interned by (parent id, asn) and every
+    // path is stored once whichever engine produced the RIBs
+    std::unordered_map<uint64_t, uint32_t> interned;
+    std::vector<PathHandle> chain;
+
+    auto resolve = [&](PathHandle h) {
+        for (PathHandle k = h; table_id[k] == UNASSIGNED; k = paths.parent(k)) {
+            chain.push_back(k);
+        }
+        while (!chain.empty()) {
+            PathHandle k = chain.back();
+            chain.pop_back();
+            const uint32_t parent = table_id[paths.parent(k)];
+            const uint32_t asn = paths.asn(k);
+
+            auto [it, inserted] = interned.emplace((static_cast<uint64_t>(parent) << 32) | asn,
+                                                   static_cast<uint32_t>(path_asn.size()));
+            table_id[k] = it->second;
+            if (!inserted) continue;
+            path_asn.push_back(asn);
+            path_parent.push_back(parent);
+        }
+        return table_id[h];
+    };
+
+    std::vector<const Announcement*> entries;
+    for (uint32_t index = 0; index < n; ++index) {
+        sorted_routes(engine.local_rib(index), entries);
+        if (entries.empty()) continue;
+
+        // The path's first hop is the holder itself, so only the rest is stored
+        for (const Announcement* entry : entries) {
+            row_prefix.push_back(entry->prefix_id);
+            row_path.push_back(resolve(paths.parent(entry->as_path)));
+        }
+        as_asn.push_back(graph.node(index).asn);
+        as_rows.push_back(row_prefix.size());
+    }
+
+    std::vector<uint32_t> prefix_offsets{0};
+    std::string prefix_text;
+    for (uint32_t id = 0; id < prefixes.size(); ++id) {
+        prefix_text += prefixes.to_string(id);
+        prefix_offsets.push_back(static_cast<uint32_t>(prefix_text.size()));
+    }
+
+    struct Section {
+        const void* data;
+        size_t bytes;
+    };
+    const Section sections[] = {
+        {as_asn.data(), as_asn.size() * 4},
+        {as_rows.data(), as_rows.size() * 8},
+        {row_prefix.data(), row_prefix.size() * 4},
+        {row_path.data(), row_path.size() * 4},
+        {path_asn.data(), path_asn.size() * 4},
+        {path_parent.data(), path_parent.size() * 4},
+        {prefix_offsets.data(), prefix_offsets.size() * 4},
+        {prefix_text.data(), prefix_text.size()},
+    };
+
+    RibBinaryHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, RIB_BINARY_MAGIC, sizeof(header.magic));
+    header.version = RIB_BINARY_VERSION;
+    header.num_rows = total_rows;
+    header.num_ases = as_asn.size();
+    header.num_paths = path_asn.size();
+    header.num_prefixes = prefixes.size();
+    header.prefix_text_bytes = prefix_text.size();
+    header.checksum = CHECKSUM_SEED;
+    for (const Section& section : sections) {
+        header.checksum = checksum_words(header.checksum, section.data, section.bytes);
+    }
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error: Could not open " << path << " for writing.\n";
+        return false;
+    }
+
+    static const char zeros[8] = {};
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    for (const Section& section : sections) {
+        const size_t pad = padded_size(section.bytes) - section.bytes;
+        ok = ok && std::fwrite(section.data, 1, section.bytes, file) == section.bytes;
+        ok = ok && std::fwrite(zeros, 1, pad, file) == pad;
+    }
+    if (std::fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        std::cerr << "Error: failed writing " << path << ".\n";
+        return false;
+    }
+
+    if (rows_written) *rows_written = total_rows;
+    return true;
+}
@@ -0,0 +1,187 @@
+#include "RunStats.h"
+#include "Propagation.h"
+#include "Prefix.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <iomanip>
+#include <cstdio>
+#include <sys/resource.h>
+#include <unistd.h>
+
+uint64_t current_rss_bytes() {
+    // Second field of statm is the resident page count
+    std::FILE* statm = std::fopen("/proc/self/statm", "r");
+    if (!statm) return 0;
+    unsigned long long size = 0, resident = 0;
+    const int fields = std::fscanf(statm, "%llu %llu", &size, &resident);
+    std::fclose(statm);
+    return fields == 2 ? resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE)) : 0;
+}
+
+uint64_t peak_rss_bytes() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;  // Kilobytes on Linux
+}
+
+void PhaseCounters::merge(const PhaseCounters& other) {
+    sent += other.sent;
+    dropped += other.dropped;
+    compared += other.compared;
+    adopted += other.adopted;
+    peak_pending = std::max(peak_pending, other.peak_pending);
+}
+
+void RunStats::begin_step(const std::string& name) {
+    current_step = name;
+    step_clock.restart();
+}
+
+void RunStats::end_step() {
+    // ru_maxrss is only updated now and then, so it can lag behind a fresh RSS sample
+    const uint64_t rss = current_rss_bytes();
+    steps.push_back({current_step, step_clock.wall_seconds(), step_clock.cpu_seconds(), rss, std::max(rss, peak_rss_bytes())});
+}
+
+void RunStats::record_ribs(const PropagationEngine& engine, size_t top) {
+    const ASGraph& graph = engine.getGraph();
+    num_ases = graph.getNumNodes();
+    rib_entries = rib_max = 0;
+    rib_max_asn = 0;
+    rib_histogram.assign(1, 0);
+    rib_top.clear();
+
+    for (uint32_t i = 0; i < num_ases; ++i) {
+        const uint64_t size = engine.local_rib(i).size();
+        const uint32_t asn = graph.node(i).asn;
+        rib_entries += size;
+        if (size > rib_max) {
+            rib_max = size;
+            rib_max_asn = asn;
+        }
+
+        size_t bucket = 0;
+        while ((uint64_t(1) << bucket) < size) bucket++;
+        if (size > 0) bucket++;
+        if (bucket >= rib_histogram.size()) rib_histogram.resize(bucket + 1, 0);
+        rib_histogram[bucket]++;
+
+        rib_top.emplace_back(asn, size);
+    }
+
+    top = std::min(top, rib_top.size());
+    std::partial_sort(rib_top.begin(), rib_top.begin() + top, rib_top.end(),
+                      [](const auto& a, const auto& b) { return a.second != b.second ? a.second > b.second : a.first < b.first; });
+    rib_top.resize(top);
+}
+
+void RunStats::record_memory(const PropagationEngine& engine, const PrefixTable* prefixes) {
+    memory.clear();
+    engine.getGraph().reportMemory(memory);
+    engine.report_memory(memory);
+    if (prefixes) prefixes->report_memory(memory);
+}
+
+void RunStats::print_memory_report(std::ostream& out) const {
+    const double MB = 1024.0 * 1024.0;
+    out << "\n[Memory] RSS after each step (MB):\n";
+    out << "  " << std::left << std::setw(22) << "step" << std::right << std::setw(12) << "rss" << std::setw(12) << "peak" << "\n";
+    out << std::fixed << std::setprecision(1);
+    for (const StepTiming& step : steps) {
+        out << "  " << std::left << std::setw(22) << step.name << std::right << std::setw(12) << step.rss_bytes / MB
+            << std::setw(12) << step.peak_rss_bytes / MB << "\n";
+    }
+
+    if (!memory.empty()) {
+        uint64_t total = 0;
+        out << "\n[Memory] Bytes by data structure:\n";
+        out << "  " << std::left << std::setw(22) << "structure" << std::right << std::setw(12) << "MB" << std::setw(14) << "items"
+            << std::setw(12) << "bytes/item" << "\n";
+        for (const MemoryEntry& entry : memory) {
+            out << "  " << std::left << std::setw(22) << entry.name << std::right << std::setw(12) << entry.bytes / MB
+                << std::setw(14) << entry.items << std::setw(12);
+            if (entry.items) out << static_cast<double>(entry.bytes) / entry.items;
+            else out << "-";
+            out << "\n";
+            total += entry.bytes;
+        }
+        out << "  " << std::left << std::setw(22) << "total accounted" << std::right << std::setw(12) << total / MB << "\n";
+        if (!steps.empty()) {
+            out << "  " << std::left << std::setw(22) << "peak rss" << std::right << std::setw(12) << steps.back().peak_rss_bytes / MB << "\n";
+        }
+    }
+    out << std::defaultfloat << std::setprecision(6);
+}
+
+namespace {
+
+void write_counters(std::ofstream& out, const char* name, const PhaseCounters& c) {
+    out << "    \"" << name << "\": {\"sent\": " << c.sent << ", \"dropped_by_policy\": " << c.dropped
+        << ", \"compared\": " << c.compared << ", \"adopted\": " << c.adopted
+        << ", \"peak_pending\": " << c.peak_pending << "}";
+}
+
+void write_ranks(std::ofstream& out, const char* name, const std::vector<RankTiming>& ranks) {
+    out << "    \"" << name << "\": [";
+    for (size_t i = 0; i < ranks.size(); ++i) {
+        const RankTiming& r = ranks[i];
+        out << (i ? ",\n      " : "\n      ") << "{\"rank\": " << r.rank << ", \"nodes\": " << r.nodes
+            << ", \"wall_seconds\": " << r.wall_seconds << ", \"cpu_seconds\": " << r.cpu_seconds
+            << ", \"adopted\": " << r.adopted << "}";
+    }
+    out << (ranks.empty() ? "]" : "\n    ]");
+}
+
+} // namespace
+
+bool RunStats::write_json(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open " << path << " for writing." << std::endl;
+        return false;
+    }
+
+    out << "{\n  \"steps\": [";
+    for (size_t i = 0; i < steps.size(); ++i) {
+        out << (i ? ",\n    " : "\n    ") << "{\"name\": \"" << steps[i].name << "\", \"wall_seconds\": "
+            << steps[i].wall_seconds << ", \"cpu_seconds\": " << steps[i].cpu_seconds << ", \"rss_bytes\": "
+            << steps[i].rss_bytes << ", \"peak_rss_bytes\": " << steps[i].peak_rss_bytes << "}";
+    }
+    out << "\n  ],\n  \"phases\": {\n";
+    write_counters(out, "up", up);
+    out << ",\n";
+    write_counters(out, "across", across);
+    out << ",\n";
+    write_counters(out, "down", down);
+    out << "\n  },\n  \"ranks\": {\n";
+    write_ranks(out, "up", up_ranks);
+    out << ",\n";
+    write_ranks(out, "down", down_ranks);
+    out << "\n  },\n  \"ribs\": {\n    \"ases\": " << num_ases << ", \"entries\": " << rib_entries
+        << ", \"max\": " << rib_max << ", \"max_asn\": " << rib_max_asn << ",\n    \"size_histogram_log2\": [";
+    for (size_t i = 0; i < rib_histogram.size(); ++i) {
+        out << (i ? ", " : "") << rib_histogram[i];
+    }
+    out << "],\n    \"largest\": [";
+    for (size_t i = 0; i < rib_top.size(); ++i) {
+        out << (i ? ", " : "") << "{\"asn\": " << rib_top[i].first << ", \"entries\": " << rib_top[i].second << "}";
+    }
+    out << "]\n  }";
+    if (!memory.empty()) {
+        out << ",\n  \"memory\": [";
+        for (size_t i = 0; i < memory.size(); ++i) {
+            out << (i ? ",\n    " : "\n    ") << "{\"name\": \"" << memory[i].name << "\", \"bytes\": " << memory[i].bytes
+                << ", \"items\": " << memory[i].items << "}";
+        }
+        out << "\n  ]";
+    }
+    out << "\n}\n";
+
+    if (!out.flush()) {
+        std::cerr << "Error: failed writing " << path << ".\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,164 @@
+#include "Scenario.h"
+#include "ThreadPool.h"
+
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <algorithm>
+
+ScenarioResult summarize_ribs(const PropagationEngine& engine) {
+    ScenarioResult result;
+    const uint32_t n = static_cast<uint32_t>(engine.getGraph().getNumNodes());
+    for (uint32_t i = 0; i < n; ++i) {
+        const LocalRib& rib = engine.local_rib(i);
+        bool holds_invalid = false;
+        for (const auto& rib_entry : rib) {
+            holds_invalid |= rib_entry.second.rov_invalid;
+            result.invalid_routes += rib_entry.second.rov_invalid;
+        }
+        result.routes += rib.size();
+        result.ases_with_invalid += holds_invalid;
+    }
+    return result;
+}
+
+bool load_scenarios(const std::string& path, const ASGraph& graph, std::vector<Scenario>& scenarios) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        std::cerr << "Error: Could not open scenarios file: " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(in, line)) {
+        line_number++;
+        const size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#') continue;
+
+        Scenario scenario;
+        scenario.id = line_number;
+        const size_t stop = line.find_last_not_of(" \t\r");
+        const bool empty_set = stop == start && line[start] == '-';
+        bool valid = true;
+        const char* p = line.c_str() + start;
+        while (*p && !empty_set) {
+            if (*p == ',' || *p == ' ' || *p == '\t' || *p == '\r') {
+                ++p;
+                continue;
+            }
+            // strtoul would accept a sign, so require a digit before handing it over
+            char* end = nullptr;
+            unsigned long asn = (*p >= '0' && *p <= '9') ? std::strtoul(p, &end, 10) : 0;
+            if (end == nullptr || asn > UINT32_MAX) {
+                valid = false;
+                break;
+            }
+            p = end;
+            if (const ASNode* node = graph.findNode(static_cast<uint32_t>(asn))) {
+                scenario.rov_adopters.set(node->index);
+            }
+        }
+        if (!valid) {
+            std::cerr << "Warning: Skipping unparsable scenario line " << line_number << ": " << line << std::endl;
+            continue;
+        }
+        scenario.rov_adopters.resize(graph.getNumNodes());
+        scenarios.push_back(std::move(scenario));
+    }
+    return true;
+}
+
+std::vector<Scenario> random_scenarios(const ASGraph& graph, double percent, uint64_t seed, size_t trials) {
+    const uint32_t n = static_cast<uint32_t>(graph.getNumNodes());
+    const size_t count = std::min<size_t>(n, static_cast<size_t>(std::llround(n * percent / 100.0)));
+
+    std::vector<uint32_t> indices(n);
+    std::vector<Scenario> scenarios(trials);
+    for (size_t t = 0; t < trials; ++t) {
+        for (uint32_t i = 0; i < n; ++i) indices[i] = i;
+
+        // Partial Fisher-Yates: the first `count` slots are a uniform sample
+        std::mt19937_64 rng(seed + t);
+        for (size_t i = 0; i < count; ++i) {
+            std::uniform_int_distribution<size_t> pick(i, n - 1);
+            std::swap(indices[i], indices[pick(rng)]);
+        }
+
+        scenarios[t].id = t;
+        scenarios[t].rov_adopters.resize(n);
+        for (size_t i = 0; i < count; ++i) scenarios[t].rov_adopters.set(indices[i]);
+    }
+    return scenarios;
+}
+
+std::vector<ScenarioResult> run_scenarios(
+    ASGraph& graph,
+    const PropagationEngine& seeded,
+    const std::vector<Scenario>& scenarios,
+    size_t num_threads,
+    EngineMode mode
+) {
+    // Freeze and rank up front so the engines only ever read the graph
+    graph.getRankedASes();
+    const uint32_t n = static_cast<uint32_t>(graph.getNumNodes());
+
+    ThreadPool pool(std::min(num_threads, std::max<size_t>(scenarios.size(), 1)));
+
+    // One engine (and one policy assignment) per thread, seeded once
+    std::vector<std::unique_ptr<PropagationEngine>> engines;
+    std::vector<PolicyAssignment> policies(pool.size());
+    for (size_t t = 0; t < pool.size(); ++t) {
+        engines.push_back(std::make_unique<PropagationEngine>(graph));
+        engines.back()->set_verbose(false);
+        for (uint32_t i = 0; i < n; ++i) {
+            for (const auto& [prefix, ann] : seeded.local_rib(i)) {
+                engines.back()->seed(i, prefix, ann.rov_invalid);
+            }
+        }
+    }
+    std::vector<char> engine_used(pool.size(), 0);
+
+    std::vector<ScenarioResult> results(scenarios.size());
+    pool.parallel_for(scenarios.size(), [&](size_t s, size_t thread_id) {
+        PropagationEngine& engine = *engines[thread_id];
+        PolicyAssignment& policy = policies[thread_id];
+        const Scenario& scenario = scenarios[s];
+
+        if (engine_used[thread_id]) engine.reset();
+        engine_used[thread_id] = 1;
+
+        policy.members(PolicyKind::ROV) = scenario.rov_adopters;
+        engine.set_policies(policy);
+
+        engine.run_propagation(1, mode);
+
+        ScenarioResult& result = results[s];
+        result = summarize_ribs(engine);
+        result.scenario = scenario.id;
+        result.adopters = scenario.rov_adopters.count();
+    });
+
+    return results;
+}
+
+bool write_scenario_results(const std::string& path, const std::vector<ScenarioResult>& results) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open " << path << " for writing." << std::endl;
+        return false;
+    }
+
+    out << "scenario,adopters,routes,invalid_routes,ases_with_invalid\n";
+    for (const ScenarioResult& r : results) {
+        out << r.scenario << ',' << r.adopters << ',' << r.routes << ',' << r.invalid_routes << ',' << r.ases_with_invalid << '\n';
+    }
+
+    if (!out.flush()) {
+        std::cerr << "Error: failed writing " << path << ".\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,58 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t num_threads) {
+    for (size_t i = 1; i < num_threads; ++i) {
+        workers.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_ready.notify_all();
+    for (std::thread& t : workers) {
+        t.join();
+    }
+}
+
+void ThreadPool::worker_loop(size_t thread_id) {
+    size_t seen_generation = 0;
+    for (;;) {
+        std::function<void(size_t)> current;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work_ready.wait(lock, [&] { return stopping || generation != seen_generation; });
+            if (stopping) return;
+            seen_generation = generation;
+            current = job;
+        }
+
+        current(thread_id);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--active == 0) {
+                work_done.notify_one();
+            }
+        }
+    }
+}
+
+void ThreadPool::run_on_all(const std::function<void(size_t)>& fn) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = fn;
+        active = workers.size();
+        ++generation;
+    }
+    work_ready.notify_all();
+
+    // The caller works as thread 0
+    fn(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    work_done.wait(lock, [&] { return active == 0; });
+    job = nullptr;
+}
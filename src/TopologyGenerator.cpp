@@ -0,0 +1,269 @@
+#include "TopologyGenerator.h"
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <charconv>
+#include <algorithm>
+#include <random>
+#include <cmath>
+#include <unordered_set>
+
+namespace {
+
+// Most providers any generated AS gets
+constexpr uint32_t MAX_PROVIDERS = 4;
+
+// Prefixes are numbered into IPv4 /24s from 1.0.0.0 up to 223.255.255.0
+constexpr uint32_t MAX_PREFIXES = 223u << 16;
+
+inline uint64_t link_key(uint32_t a, uint32_t b) {
+    return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+}
+
+// Buffered text output through a FILE*
+class TextFile {
+    std::FILE* file;
+    std::vector<char> buffer;
+    size_t used = 0;
+    bool ok;
+
+public:
+    explicit TextFile(const std::string& path) : file(std::fopen(path.c_str(), "wb")), buffer(1 << 20), ok(file != nullptr) {}
+    ~TextFile() { if (file) std::fclose(file); }
+
+    bool is_open() const { return file != nullptr; }
+
+    void flush() {
+        ok = ok && std::fwrite(buffer.data(), 1, used, file) == used;
+        used = 0;
+    }
+    void put(const char* text, size_t length) {
+        if (used + length > buffer.size()) flush();
+        if (length > buffer.size()) {
+            // Larger than the whole buffer: write it straight through
+            ok = ok && std::fwrite(text, 1, length, file) == length;
+            return;
+        }
+        std::memcpy(buffer.data() + used, text, length);
+        used += length;
+    }
+    void put(const std::string& text) { put(text.data(), text.size()); }
+    void put(uint32_t value) {
+        char digits[12];
+        put(digits, static_cast<size_t>(std::to_chars(digits, digits + sizeof(digits), value).ptr - digits));
+    }
+
+    bool close() {
+        flush();
+        ok = std::fclose(file) == 0 && ok;
+        file = nullptr;
+        return ok;
+    }
+};
+
+} // namespace
+
+SyntheticTopology generate_topology(const TopologyConfig& config) {
+    std::mt19937_64 rng(config.seed);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    auto below = [&rng](size_t bound) { return static_cast<size_t>(rng() % bound); };
+
+    const uint32_t n = config.num_ases;
+    const uint32_t tier1 = std::min(std::max(config.tier1, 1u), n);
+    const uint32_t depth = std::min(std::max(config.depth, 3u), 255u);
+    const uint32_t stubs = std::min(n - tier1, static_cast<uint32_t>(n * std::clamp(config.stub_fraction, 0.0, 1.0)));
+    const uint32_t transit = n - tier1 - stubs;
+
+    SyntheticTopology topology;
+    topology.level.reserve(n);
+
+    // Levels 1..depth-2 hold the transit ASes, each level three times the one above it
+    topology.level.assign(tier1, 0);
+    const uint32_t transit_levels = depth - 2;
+    double total_weight = 0.0;
+    for (uint32_t l = 0; l < transit_levels; ++l) total_weight += std::pow(3.0, l);
+    uint32_t placed = 0;
+    for (uint32_t l = 0; l < transit_levels; ++l) {
+        uint32_t size = l + 1 == transit_levels ? transit - placed
+                                                : static_cast<uint32_t>(transit * std::pow(3.0, l) / total_weight);
+        topology.level.insert(topology.level.end(), size, static_cast<uint8_t>(l + 1));
+        placed += size;
+    }
+    topology.level.insert(topology.level.end(), stubs, static_cast<uint8_t>(depth - 1));
+
+    // Distinct ASNs that do not follow the level order (ASN is the last tie-breaker)
+    std::vector<uint32_t> order(n);
+    for (uint32_t i = 0; i < n; ++i) order[i] = i + 1;
+    std::shuffle(order.begin(), order.end(), rng);
+    topology.asns.resize(n);
+    for (uint32_t i = 0; i < n; ++i) topology.asns[i] = order[i] * 3 + static_cast<uint32_t>(below(3));
+
+    std::unordered_set<uint64_t> linked;
+    linked.reserve(static_cast<size_t>(n * (2.0 + config.peering_degree)));
+
+    // Tier-1 clique
+    for (uint32_t a = 0; a < tier1; ++a) {
+        for (uint32_t b = a + 1; b < tier1; ++b) {
+            topology.peer_edges.emplace_back(a, b);
+            linked.insert(link_key(a, b));
+        }
+    }
+
+    // Preferential attachment: every AS of a finished level appears once, plus
+    // once more per customer it has gained
+    std::vector<uint32_t> attach(tier1);
+    for (uint32_t i = 0; i < tier1; ++i) attach[i] = i;
+    topology.provider_edges.reserve(static_cast<size_t>(n * (1.0 + 2.0 * config.multihoming)));
+
+    uint32_t level_start = tier1;
+    while (level_start < n) {
+        const uint8_t level = topology.level[level_start];
+        uint32_t level_end = level_start;
+        while (level_end < n && topology.level[level_end] == level) ++level_end;
+
+        for (uint32_t customer = level_start; customer < level_end; ++customer) {
+            uint32_t wanted = 1;
+            while (wanted < MAX_PROVIDERS && coin(rng) < config.multihoming) ++wanted;
+
+            uint32_t chosen = 0;
+            for (uint32_t attempt = 0; chosen < wanted && attempt < 8 * wanted; ++attempt) {
+                const uint32_t provider = attach[below(attach.size())];
+                if (linked.insert(link_key(provider, customer)).second) {
+                    topology.provider_edges.emplace_back(provider, customer);
+                    attach.push_back(provider);
+                    chosen++;
+                }
+            }
+        }
+
+        // Stubs are never offered as providers
+        if (level != depth - 1) {
+            for (uint32_t i = level_start; i < level_end; ++i) attach.push_back(i);
+        }
+        level_start = level_end;
+    }
+
+    // Peering: one end uniform (IXP members), the other by customer count
+    if (n > tier1) {
+        const uint64_t target = static_cast<uint64_t>(config.peering_degree * (n - tier1) / 2.0);
+        uint64_t added = 0;
+        for (uint64_t attempt = 0; added < target && attempt < target * 4; ++attempt) {
+            const uint32_t a = tier1 + static_cast<uint32_t>(below(n - tier1));
+            const uint32_t b = coin(rng) < 0.5 ? attach[below(attach.size())]
+                                                : tier1 + static_cast<uint32_t>(below(n - tier1));
+            if (a == b || topology.level[b] == 0) continue;
+            if (linked.insert(link_key(a, b)).second) {
+                topology.peer_edges.emplace_back(a, b);
+                added++;
+            }
+        }
+    }
+
+    return topology;
+}
+
+void build_graph(const SyntheticTopology& topology, ASGraph& graph) {
+    graph.reserveEdges(topology.provider_edges.size() + topology.peer_edges.size());
+    for (const auto& [provider, customer] : topology.provider_edges) {
+        graph.addRelationship(topology.asns[provider], topology.asns[customer], -1);
+    }
+    for (const auto& [a, b] : topology.peer_edges) {
+        graph.addRelationship(topology.asns[a], topology.asns[b], 0);
+    }
+}
+
+bool write_as_rel(const SyntheticTopology& topology, const TopologyConfig& config, const std::string& path) {
+    TextFile out(path);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open " << path << " for writing.\n";
+        return false;
+    }
+
+    out.put("# source:synthetic|seed=" + std::to_string(config.seed) + "|ases=" + std::to_string(topology.asns.size()) +
+            "|depth=" + std::to_string(config.depth) + "\n");
+    out.put("# input clique:");
+    for (uint32_t i = 0; i < topology.level.size() && topology.level[i] == 0; ++i) {
+        out.put(" ", 1);
+        out.put(topology.asns[i]);
+    }
+    out.put("\n# format: as1|as2|rel|source\n");
+
+    for (const auto& [provider, customer] : topology.provider_edges) {
+        out.put(topology.asns[provider]);
+        out.put("|", 1);
+        out.put(topology.asns[customer]);
+        out.put("|-1|bgp\n", 8);
+    }
+    for (const auto& [a, b] : topology.peer_edges) {
+        out.put(topology.asns[a]);
+        out.put("|", 1);
+        out.put(topology.asns[b]);
+        out.put("|0|bgp\n", 7);
+    }
+
+    if (!out.close()) {
+        std::cerr << "Error: failed writing " << path << ".\n";
+        return false;
+    }
+    return true;
+}
+
+bool write_announcements(
+    const SyntheticTopology& topology,
+    const AnnouncementConfig& config,
+    const std::string& anns_path,
+    const std::string& rov_path
+) {
+    const uint32_t n = static_cast<uint32_t>(topology.asns.size());
+    if (n < 2) {
+        std::cerr << "Error: announcements need at least two ASes.\n";
+        return false;
+    }
+    if (config.prefixes > MAX_PREFIXES) {
+        std::cerr << "Error: at most " << MAX_PREFIXES << " prefixes can be generated.\n";
+        return false;
+    }
+
+    std::mt19937_64 rng(config.seed);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+
+    TextFile anns(anns_path);
+    TextFile rov(rov_path);
+    if (!anns.is_open() || !rov.is_open()) {
+        std::cerr << "Error: Could not open " << (anns.is_open() ? rov_path : anns_path) << " for writing.\n";
+        return false;
+    }
+
+    anns.put("seed_asn,prefix,rov_invalid\n");
+    for (uint32_t p = 0; p < config.prefixes; ++p) {
+        const std::string prefix = std::to_string(1 + (p >> 16)) + "." + std::to_string((p >> 8) & 255) + "." +
+                                   std::to_string(p & 255) + ".0/24";
+        const uint32_t origin = static_cast<uint32_t>(rng() % n);
+        anns.put(topology.asns[origin]);
+        anns.put("," + prefix + ",False\n");
+
+        if (coin(rng) < config.hijack_fraction) {
+            uint32_t hijacker = static_cast<uint32_t>(rng() % (n - 1));
+            if (hijacker >= origin) hijacker++;
+            anns.put(topology.asns[hijacker]);
+            anns.put("," + prefix + ",True\n");
+        }
+    }
+
+    rov.put("asn\n");
+    for (uint32_t i = 0; i < n; ++i) {
+        if (coin(rng) < config.rov_fraction) {
+            rov.put(topology.asns[i]);
+            rov.put("\n", 1);
+        }
+    }
+
+    const bool anns_ok = anns.close();
+    const bool rov_ok = rov.close();
+    if (!anns_ok || !rov_ok) {
+        std::cerr << "Error: failed writing " << (anns_ok ? rov_path : anns_path) << ".\n";
+        return false;
+    }
+    return true;
+}
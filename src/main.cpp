@@ -1,268 +1,377 @@
-#include <iostream>
-#include <string>
-#include <vector>
-#include <fstream>
-#include <cstdlib>
-#include <sstream>
-#include <unordered_set>
-
-// Integrate our helper modules
-#include "ASGraph.h"
-#include "parse_caida.h"
-#include "Announcement.h"
-#include "Policy.h"
-#include "Propagation.h" 
-
-void print_usage(const char* prog_name) {
-    std::cerr << "Usage: " << prog_name 
-              << " --relationships <file> --announcements <file> --rov-asns <file>\n";
-}
-
-// Propagation logic has been moved to Propagation.cpp/Propagation.h
-// This keeps main.cpp focused on orchestration rather than implementation details
-
-
-int main(int argc, char* argv[]) {
-    // ---------------------------------------------------------
-    // 1. Argument Parsing
-    // ---------------------------------------------------------
-    std::string rel_file;
-    std::string ann_file;
-    std::string rov_file;
-
-    for (int i = 1; i < argc; ++i) {
-        std::string arg = argv[i];
-
-        if (arg == "--relationships") {
-            if (i + 1 < argc) rel_file = argv[++i];
-            else { std::cerr << "Error: --relationships requires a file path.\n"; return 1; }
-        } else if (arg == "--announcements") {
-            if (i + 1 < argc) ann_file = argv[++i];
-            else { std::cerr << "Error: --announcements requires a file path.\n"; return 1; }
-        } else if (arg == "--rov-asns") {
-            if (i + 1 < argc) rov_file = argv[++i];
-            else { std::cerr << "Error: --rov-asns requires a file path.\n"; return 1; }
-        }
-    }
-
-    if (rel_file.empty() || ann_file.empty() || rov_file.empty()) {
-        std::cerr << "Error: Missing required arguments.\n";
-        print_usage(argv[0]);
-        return 1;
-    }
-
-    std::cout << "Starting Simulation...\n";
-    std::cout << "Relationships File: " << rel_file << "\n";
-    std::cout << "Announcements File: " << ann_file << "\n";
-    std::cout << "ROV ASNs File:      " << rov_file << "\n";
-
-    // ---------------------------------------------------------
-    // 2. Build the AS Graph (Phase 1)
-    // ---------------------------------------------------------
-    std::cout << "\n[Step 1] Building AS Graph...\n";
-    
-    // Instantiate the Graph
-    ASGraph graph;
-
-    // Parse the CAIDA file and populate the graph
-    // Passing 'graph' by reference so it gets filled
-    parse_caida(rel_file, graph);
-
-    // Check for Provider/Customer cycles
-    // The spec requires the program to output a reasonable print statement and end 
-    // if a cycle is detected.
-    if (graph.detectProviderCycles()) {
-        std::cerr << "CRITICAL ERROR: Provider cycle detected in input topology. Aborting.\n";
-        return 1;
-    }
-
-    std::cout << "[Info] AS Graph built successfully (" << graph.getNumNodes() << " nodes).\n";
-
-
-    // ---------------------------------------------------------
-    // 3. Configure ROV (Phase 4)
-    // ---------------------------------------------------------
-    std::cout << "\n[Step 3] Configuring ROV policies...\n";
-    std::unordered_set<uint32_t> rov_asns;
-    
-    std::ifstream rov_stream(rov_file);
-    if (!rov_stream.is_open()) {
-        std::cerr << "Error: Could not open ROV ASNs file: " << rov_file << std::endl;
-        return 1;
-    }
-    
-    std::string rov_line;
-    // Skip header if present
-    if (std::getline(rov_stream, rov_line)) {
-        // Check if it's a header (contains non-numeric characters)
-        bool is_header = false;
-        for (char c : rov_line) {
-            if (!std::isdigit(c) && c != '\r' && c != '\n') {
-                is_header = true;
-                break;
-            }
-        }
-        if (!is_header) {
-            // First line is not a header, process it
-            uint32_t asn = std::stoul(rov_line);
-            rov_asns.insert(asn);
-        }
-    }
-    
-    // Read remaining ROV ASNs
-    while (std::getline(rov_stream, rov_line)) {
-        if (rov_line.empty()) continue;
-        // Remove any trailing whitespace
-        while (!rov_line.empty() && (rov_line.back() == '\r' || rov_line.back() == '\n' || rov_line.back() == ' ')) {
-            rov_line.pop_back();
-        }
-        if (rov_line.empty()) continue;
-        
-        try {
-            uint32_t asn = std::stoul(rov_line);
-            rov_asns.insert(asn);
-        } catch (const std::exception& e) {
-            std::cerr << "Warning: Could not parse ROV ASN: " << rov_line << std::endl;
-        }
-    }
-    rov_stream.close();
-    
-    // Apply ROV policies to the specified ASNs
-    for (uint32_t rov_asn : rov_asns) {
-        ASNode* node = graph.getOrCreateNode(rov_asn);
-        if (node) {
-            node->policy = std::make_shared<ROV>();
-        }
-    }
-    
-    std::cout << "[Info] ROV policies applied to " << rov_asns.size() << " ASNs.\n";
-
-
-    // ---------------------------------------------------------
-    // 4. Seed Announcements (Phase 3.4)
-    // ---------------------------------------------------------
-    std::cout << "\n[Step 4] Seeding announcements from file...\n";
-    
-    std::ifstream ann_stream(ann_file);
-    if (!ann_stream.is_open()) {
-        std::cerr << "Error: Could not open announcements file: " << ann_file << std::endl;
-        return 1;
-    }
-    
-    std::string ann_line;
-    // Skip header line
-    std::getline(ann_stream, ann_line);
-    
-    int seeded_count = 0;
-    while (std::getline(ann_stream, ann_line)) {
-        if (ann_line.empty()) continue;
-        
-        // Parse CSV: seed_asn,prefix,rov_invalid
-        std::istringstream iss(ann_line);
-        std::string seed_asn_str, prefix, rov_invalid_str;
-        
-        if (!std::getline(iss, seed_asn_str, ',') ||
-            !std::getline(iss, prefix, ',') ||
-            !std::getline(iss, rov_invalid_str, ',')) {
-            std::cerr << "Warning: Could not parse announcement line: " << ann_line << std::endl;
-            continue;
-        }
-        
-        // Remove any whitespace
-        seed_asn_str.erase(0, seed_asn_str.find_first_not_of(" \t\r\n"));
-        seed_asn_str.erase(seed_asn_str.find_last_not_of(" \t\r\n") + 1);
-        prefix.erase(0, prefix.find_first_not_of(" \t\r\n"));
-        prefix.erase(prefix.find_last_not_of(" \t\r\n") + 1);
-        rov_invalid_str.erase(0, rov_invalid_str.find_first_not_of(" \t\r\n"));
-        rov_invalid_str.erase(rov_invalid_str.find_last_not_of(" \t\r\n") + 1);
-        
-        try {
-            uint32_t seed_asn = std::stoul(seed_asn_str);
-            bool rov_invalid = (rov_invalid_str == "True" || rov_invalid_str == "true" || rov_invalid_str == "1");
-            
-            ASNode* target_as = graph.getOrCreateNode(seed_asn);
-            if (target_as) {
-                Announcement seed_announcement(
-                    prefix,
-                    {seed_asn},
-                    seed_asn,
-                    Relationship::ORIGIN,
-                    rov_invalid
-                );
-                
-                BGP* bgp_policy = dynamic_cast<BGP*>(target_as->policy.get());
-                if (bgp_policy) {
-                    bgp_policy->local_rib[seed_announcement.prefix] = seed_announcement;
-                    seeded_count++;
-                } else {
-                    std::cerr << "Error: Could not retrieve BGP policy for ASN " << seed_asn << std::endl;
-                }
-            } else {
-                std::cerr << "Error: Could not find or create ASN " << seed_asn << " for seeding." << std::endl;
-            }
-        } catch (const std::exception& e) {
-            std::cerr << "Warning: Could not parse announcement line: " << ann_line << " (" << e.what() << ")" << std::endl;
-        }
-    }
-    ann_stream.close();
-    
-    std::cout << "[Info] Successfully seeded " << seeded_count << " announcements.\n";
-
-
-
-    // ---------------------------------------------------------
-    // 5. Run Propagation (Phase 3.5)
-    // ---------------------------------------------------------
-    // All propagation logic is abstracted into PropagationEngine
-    // This includes the three phases: UP, ACROSS, and DOWN
-    PropagationEngine::run_propagation(graph);
-
-
-
-    // ---------------------------------------------------------
-    // 6. Output Results (Phase 3.7)
-    // ---------------------------------------------------------
-    std::cout << "\n[Step 6] Writing results to ribs.csv...\n";
-    std::ofstream out_file("ribs.csv");
-    if (!out_file.is_open()) {
-        std::cerr << "Error: Could not open ribs.csv for writing.\n";
-        return 1;
-    }
-
-    // Write Header
-    out_file << "asn,prefix,as_path\n";
-
-    // Iterate through all AS nodes and their Local RIBs to dump data
-    for (const auto& pair : graph.getNodes()) {
-        ASNode* node = pair.second.get();
-        // ROV extends BGP, so dynamic_cast<BGP*> will work for both BGP and ROV policies
-        BGP* policy = dynamic_cast<BGP*>(node->policy.get());
-
-        if (policy) {
-            for (const auto& rib_entry : policy->local_rib) {
-                const Announcement& ann = rib_entry.second;
-                
-                // Format the AS path as a Python tuple: "(1, 2, 3)" or "(1,)" for single element
-                std::string path_str = "(";
-                for (size_t i = 0; i < ann.as_path.size(); ++i) {
-                    path_str += std::to_string(ann.as_path[i]);
-                    if (i < ann.as_path.size() - 1) {
-                        path_str += ", ";
-                    } else if (ann.as_path.size() == 1) {
-                        // Single-element tuple requires trailing comma in Python
-                        path_str += ",";
-                    }
-                }
-                path_str += ")";
-
-                // Write to file (quote the path_str since it contains commas)
-                out_file << node->asn << "," << ann.prefix << ",\"" << path_str << "\"\n";
-            }
-        }
-    }
-
-    out_file.close();
-    std::cout << "[Success] ribs.csv generated successfully.\n";
-
-    return 0;
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+
+// Integrate our helper modules
+#include "ASGraph.h"
+#include "parse_caida.h"
+#include "GraphSnapshot.h"
+#include "RibWriter.h"
+#include "Announcement.h"
+#include "Prefix.h"
+#include "Policy.h"
+#include "Propagation.h" 
+#include "Scenario.h"
+#include "RunStats.h"
+#include "InputLoader.h"
+#include "QueryServer.h"
+
+void print_usage(const char* prog_name) {
+    std::cerr << "Usage: " << prog_name 
+              << " (--relationships <file> | --load-graph <file>) --announcements <file> --rov-asns <file>"
+              << " [--save-graph <file>] [--threads N] [--engine node|prefix] [--output-format csv|binary] [--compress none|gzip]"
+              << " [--stats-json <file>] [--memory-report] [--serve <socket>]\n"
+              << "       " << prog_name
+              << " (--relationships <file> | --load-graph <file>) --announcements <file>"
+              << " (--scenarios <file> | --rov-adoption <percent> [--trials N] [--seed N]) [--threads N] [--engine node|prefix]\n"
+              << "With --save-graph and no announcements/ROV files, the graph is saved and the program exits.\n"
+              << "Scenario sweeps replace --rov-asns: each scenario is one ROV adoption set, and one row per\n"
+              << "scenario is written to scenarios.csv (scenarios run in parallel with --threads).\n"
+              << "--announcements or --rov-asns may be - to read that file from stdin.\n"
+              << "With --serve, the converged RIBs are kept in memory and queried over a Unix socket instead of written out.\n";
+}
+
+// Propagation logic has been moved to Propagation.cpp/Propagation.h
+// This keeps main.cpp focused on orchestration rather than implementation details
+
+
+int main(int argc, char* argv[]) {
+    // ---------------------------------------------------------
+    // 1. Argument Parsing
+    // ---------------------------------------------------------
+    std::string rel_file;
+    std::string ann_file;
+    std::string rov_file;
+    std::string save_graph_file;
+    std::string load_graph_file;
+    size_t num_threads = 1;
+    EngineMode engine_mode = EngineMode::NODE_MAJOR;
+    OutputCompression compression = OutputCompression::NONE;
+    OutputFormat output_format = OutputFormat::CSV;
+    std::string scenarios_file;
+    double rov_adoption = -1.0;
+    size_t trials = 1;
+    uint64_t trial_seed = 1;
+    std::string stats_file;
+    bool memory_report = false;
+    std::string serve_socket;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg == "--relationships") {
+            if (i + 1 < argc) rel_file = argv[++i];
+            else { std::cerr << "Error: --relationships requires a file path.\n"; return 1; }
+        } else if (arg == "--announcements") {
+            if (i + 1 < argc) ann_file = argv[++i];
+            else { std::cerr << "Error: --announcements requires a file path.\n"; return 1; }
+        } else if (arg == "--rov-asns") {
+            if (i + 1 < argc) rov_file = argv[++i];
+            else { std::cerr << "Error: --rov-asns requires a file path.\n"; return 1; }
+        } else if (arg == "--save-graph") {
+            if (i + 1 < argc) save_graph_file = argv[++i];
+            else { std::cerr << "Error: --save-graph requires a file path.\n"; return 1; }
+        } else if (arg == "--load-graph") {
+            if (i + 1 < argc) load_graph_file = argv[++i];
+            else { std::cerr << "Error: --load-graph requires a file path.\n"; return 1; }
+        } else if (arg == "--threads") {
+            if (i + 1 < argc) {
+                long n = std::strtol(argv[++i], nullptr, 10);
+                if (n < 1) { std::cerr << "Error: --threads must be a positive integer.\n"; return 1; }
+                num_threads = static_cast<size_t>(n);
+            }
+            else { std::cerr << "Error: --threads requires a thread count.\n"; return 1; }
+        } else if (arg == "--engine") {
+            std::string mode = (i + 1 < argc) ? argv[++i] : "";
+            if (mode == "node") engine_mode = EngineMode::NODE_MAJOR;
+            else if (mode == "prefix") engine_mode = EngineMode::PREFIX_MAJOR;
+            else { std::cerr << "Error: --engine must be 'node' or 'prefix'.\n"; return 1; }
+        } else if (arg == "--compress") {
+            std::string codec = (i + 1 < argc) ? argv[++i] : "";
+            if (codec == "none") compression = OutputCompression::NONE;
+            else if (codec == "gzip") compression = OutputCompression::GZIP;
+            else { std::cerr << "Error: --compress must be 'none' or 'gzip'.\n"; return 1; }
+        } else if (arg == "--output-format") {
+            std::string format = (i + 1 < argc) ? argv[++i] : "";
+            if (format == "csv") output_format = OutputFormat::CSV;
+            else if (format == "binary") output_format = OutputFormat::BINARY;
+            else { std::cerr << "Error: --output-format must be 'csv' or 'binary'.\n"; return 1; }
+        } else if (arg == "--stats-json") {
+            if (i + 1 < argc) stats_file = argv[++i];
+            else { std::cerr << "Error: --stats-json requires a file path.\n"; return 1; }
+        } else if (arg == "--memory-report") {
+            memory_report = true;
+        } else if (arg == "--serve") {
+            if (i + 1 < argc) serve_socket = argv[++i];
+            else { std::cerr << "Error: --serve requires a socket path.\n"; return 1; }
+        } else if (arg == "--scenarios") {
+            if (i + 1 < argc) scenarios_file = argv[++i];
+            else { std::cerr << "Error: --scenarios requires a file path.\n"; return 1; }
+        } else if (arg == "--rov-adoption") {
+            char* end = nullptr;
+            rov_adoption = (i + 1 < argc) ? std::strtod(argv[++i], &end) : -1.0;
+            if (!end || *end != '\0' || rov_adoption < 0.0 || rov_adoption > 100.0) {
+                std::cerr << "Error: --rov-adoption must be a percentage between 0 and 100.\n"; return 1;
+            }
+        } else if (arg == "--trials") {
+            long n = (i + 1 < argc) ? std::strtol(argv[++i], nullptr, 10) : 0;
+            if (n < 1) { std::cerr << "Error: --trials must be a positive integer.\n"; return 1; }
+            trials = static_cast<size_t>(n);
+        } else if (arg == "--seed") {
+            if (i + 1 < argc) trial_seed = std::strtoull(argv[++i], nullptr, 10);
+            else { std::cerr << "Error: --seed requires a number.\n"; return 1; }
+        }
+    }
+
+    // Only building and saving a snapshot needs no announcement or ROV input
+    const bool save_only = !save_graph_file.empty() && ann_file.empty() && rov_file.empty();
+
+    if (output_format == OutputFormat::BINARY && compression != OutputCompression::NONE) {
+        std::cerr << "Error: --compress applies to csv output only.\n";
+        return 1;
+    }
+
+    // A scenario sweep takes its ROV adopters from the scenarios instead of --rov-asns
+    const bool sweep = !scenarios_file.empty() || rov_adoption >= 0.0;
+    if (!scenarios_file.empty() && rov_adoption >= 0.0) {
+        std::cerr << "Error: use either --scenarios or --rov-adoption, not both.\n";
+        return 1;
+    }
+
+    if (sweep && !serve_socket.empty()) {
+        std::cerr << "Error: --serve cannot be combined with a scenario sweep; send SCENARIO requests instead.\n";
+        return 1;
+    }
+
+    if (ann_file == "-" && rov_file == "-" && !sweep) {
+        std::cerr << "Error: only one of --announcements and --rov-asns can read stdin.\n";
+        return 1;
+    }
+
+    if (rel_file.empty() == load_graph_file.empty() ||
+        (!save_only && (ann_file.empty() || (!sweep && rov_file.empty())))) {
+        std::cerr << "Error: Missing required arguments.\n";
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::cout << "Starting Simulation...\n";
+    if (!load_graph_file.empty()) {
+        std::cout << "Graph Snapshot:     " << load_graph_file << "\n";
+    } else {
+        std::cout << "Relationships File: " << rel_file << "\n";
+    }
+    std::cout << "Announcements File: " << ann_file << "\n";
+    if (!scenarios_file.empty()) {
+        std::cout << "Scenarios File:     " << scenarios_file << "\n";
+    } else if (sweep) {
+        std::cout << "ROV Adoption:       " << rov_adoption << "% x " << trials << " trial(s), seed " << trial_seed << "\n";
+    } else {
+        std::cout << "ROV ASNs File:      " << rov_file << "\n";
+    }
+    std::cout << "Threads:            " << num_threads << "\n";
+    std::cout << "Engine:             " << (engine_mode == EngineMode::PREFIX_MAJOR ? "prefix-major" : "node-major") << "\n";
+
+    // ---------------------------------------------------------
+    // 2. Build the AS Graph (Phase 1)
+    // ---------------------------------------------------------
+    std::cout << "\n[Step 1] Building AS Graph...\n";
+
+    // Step timings always (a handful of clock reads); engine counters only with --stats-json
+    RunStats stats;
+    stats.begin_step("build_graph");
+    
+    // Instantiate the Graph
+    ASGraph graph;
+
+    CaidaMetadata metadata;
+
+    if (!load_graph_file.empty()) {
+        // A snapshot is already frozen, validated and ranked
+        if (!load_graph_snapshot(load_graph_file, graph, &metadata)) {
+            return 1;
+        }
+    } else {
+        // Parse the CAIDA file and populate the graph
+        // Passing 'graph' by reference so it gets filled
+        if (!parse_caida(rel_file, graph, &metadata)) {
+            return 1;
+        }
+
+        // Freeze the parsed relationships into the compact CSR adjacency used by propagation
+        graph.freeze();
+    }
+
+    stats.end_step();
+
+    // Check for Provider/Customer cycles
+    // The spec requires the program to output a reasonable print statement and end 
+    // if a cycle is detected.
+    stats.begin_step("detect_cycles");
+    if (graph.detectProviderCycles()) {
+        std::cerr << "CRITICAL ERROR: Provider cycle detected in input topology. Aborting.\n";
+        return 1;
+    }
+    stats.end_step();
+
+    std::cout << "[Info] AS Graph built successfully (" << graph.getNumNodes() << " nodes).\n";
+
+    if (!save_graph_file.empty()) {
+        if (!save_graph_snapshot(graph, save_graph_file, &metadata)) {
+            return 1;
+        }
+        std::cout << "[Info] Graph snapshot saved to " << save_graph_file << ".\n";
+        if (save_only) {
+            if (memory_report) {
+                graph.reportMemory(stats.memory);
+                stats.print_memory_report(std::cout);
+            }
+            return 0;
+        }
+    }
+
+
+    // ---------------------------------------------------------
+    // 3. Configure ROV (Phase 4)
+    // ---------------------------------------------------------
+    stats.begin_step("configure_rov");
+    if (!sweep) {
+        std::cout << "\n[Step 3] Configuring ROV policies...\n";
+        if (!load_rov_asns(rov_file, graph, num_threads)) return 1;
+        std::cout << "[Info] ROV policies applied to " << graph.getPolicies().members(PolicyKind::ROV).count() << " ASNs.\n";
+    }
+    stats.end_step();
+
+
+    // ---------------------------------------------------------
+    // 4. Seed Announcements (Phase 3.4)
+    // ---------------------------------------------------------
+    std::cout << "\n[Step 4] Seeding announcements from file...\n";
+    stats.begin_step("seed_announcements");
+    
+    // The engine owns the RIB state that seeding fills and propagation updates
+    PropagationEngine engine(graph);
+
+    // Prefixes are parsed and interned once here; propagation only sees the dense ids
+    PrefixTable prefixes;
+    size_t seeded_count = 0;
+    if (!load_announcements(ann_file, graph, engine, prefixes, num_threads, seeded_count)) return 1;
+
+    std::cout << "[Info] Successfully seeded " << seeded_count << " announcements ("
+              << prefixes.size() << " unique prefixes).\n";
+    stats.end_step();
+
+
+
+    // ---------------------------------------------------------
+    // 5b. Scenario sweep: one propagation per ROV adoption set
+    // ---------------------------------------------------------
+    if (sweep) {
+        std::vector<Scenario> scenarios;
+        if (!scenarios_file.empty()) {
+            if (!load_scenarios(scenarios_file, graph, scenarios)) {
+                return 1;
+            }
+        } else {
+            scenarios = random_scenarios(graph, rov_adoption, trial_seed, trials);
+        }
+
+        std::cout << "\n[Step 5] Running " << scenarios.size() << " scenario(s) on "
+                  << std::min(num_threads, std::max<size_t>(scenarios.size(), 1)) << " thread(s)...\n";
+        stats.begin_step("scenarios");
+        std::vector<ScenarioResult> results = run_scenarios(graph, engine, scenarios, num_threads, engine_mode);
+        stats.end_step();
+
+        const std::string output_file = "scenarios.csv";
+        std::cout << "\n[Step 6] Writing results to " << output_file << "...\n";
+        if (!write_scenario_results(output_file, results)) {
+            return 1;
+        }
+        std::cout << "[Success] " << output_file << " generated successfully (" << results.size() << " scenarios).\n";
+        if (memory_report) {
+            // The sweep engines are gone by now; this covers the graph and the seeded engine
+            stats.record_memory(engine, &prefixes);
+            stats.print_memory_report(std::cout);
+        }
+        if (!stats_file.empty() && !stats.write_json(stats_file)) {
+            return 1;
+        }
+        return 0;
+    }
+
+    // ---------------------------------------------------------
+    // 5. Run Propagation (Phase 3.5)
+    // ---------------------------------------------------------
+    // All propagation logic is abstracted into PropagationEngine
+    // This includes the three phases: UP, ACROSS, and DOWN
+    if (!stats_file.empty()) {
+        engine.set_stats(&stats);
+    }
+    stats.begin_step("propagation");
+    engine.run_propagation(num_threads, engine_mode);
+    stats.end_step();
+    if (memory_report) {
+        // Before the output writer adds its own buffers
+        stats.record_memory(engine, &prefixes);
+    }
+
+
+
+    // ---------------------------------------------------------
+    // 6b. Query server: answer requests on the converged RIBs
+    // ---------------------------------------------------------
+    if (!serve_socket.empty()) {
+        std::cout << "\n[Step 6] Serving queries on " << serve_socket << " (send SHUTDOWN to stop)..." << std::endl;
+        QueryServer server(graph, engine, prefixes, num_threads, engine_mode);
+        if (!server.serve(serve_socket)) {
+            return 1;
+        }
+        std::cout << "[Success] Query server stopped.\n";
+        if (memory_report) {
+            stats.print_memory_report(std::cout);
+        }
+        if (!stats_file.empty() && !stats.write_json(stats_file)) {
+            return 1;
+        }
+        return 0;
+    }
+
+    // ---------------------------------------------------------
+    // 6. Output Results (Phase 3.7)
+    // ---------------------------------------------------------
+    std::string output_file = "ribs.csv";
+    if (output_format == OutputFormat::BINARY) output_file = "ribs.bin";
+    else if (compression == OutputCompression::GZIP) output_file = "ribs.csv.gz";
+    std::cout << "\n[Step 6] Writing results to " << output_file << "...\n";
+
+    stats.begin_step("write_output");
+    uint64_t rows_written = 0;
+    bool written;
+    if (output_format == OutputFormat::BINARY) {
+        // Columnar rows plus a deduplicated path table; rib_reader converts it back to CSV
+        written = write_ribs_binary(engine, prefixes, output_file, &rows_written);
+    } else {
+        // Rows are formatted (and compressed) in parallel per run of ASes and written in AS order
+        written = write_ribs_csv(engine, prefixes, output_file, num_threads, compression, &rows_written);
+    }
+    if (!written) {
+        return 1;
+    }
+    stats.end_step();
+    std::cout << "[Success] " << output_file << " generated successfully (" << rows_written << " routes).\n";
+
+    if (memory_report) {
+        stats.print_memory_report(std::cout);
+    }
+    if (!stats_file.empty()) {
+        stats.record_ribs(engine);
+        if (!stats.write_json(stats_file)) {
+            return 1;
+        }
+        std::cout << "[Info] Run statistics written to " << stats_file << ".\n";
+    }
+
+    return 0;
 }
\ No newline at end of file
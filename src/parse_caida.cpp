@@ -1,57 +1,181 @@
-#include "parse_caida.h"
-#include "ASGraph.h" // Include the graph definition
-
-#include <iostream>
-#include <cstdio>
-#include <cstring>
-#include <string>
-#include <cstdint>
-#include <cstdlib> // for strtoul
-
-// Change signature to accept Graph reference
-void parse_caida(const std::string& bz2_filename, ASGraph& graph) {
-    std::string cmd;
-    if (bz2_filename.size() > 4 && bz2_filename.substr(bz2_filename.size() - 4) == ".bz2") {
-        cmd = "bzcat \"" + bz2_filename + "\"";
-    } else {
-        cmd = "cat \"" + bz2_filename + "\"";
-    }
-    FILE* fp = popen(cmd.c_str(), "r");
-    
-    if (!fp) {
-        std::cerr << "Error: failed to run command on file: " << bz2_filename << "\n";
-        return;
-    }
-
-    char line[512];
-    uint64_t line_count = 0;
-
-    std::cout << "Parsing CAIDA file... ";
-    
-    while (std::fgets(line, sizeof(line), fp)) {
-        if (line[0] == '#' || line[0] == '\n' || line[0] == '\0') continue;
-
-        // Fast newline strip
-        size_t len = std::strlen(line);
-        if (len > 0 && line[len-1] == '\n') line[--len] = '\0';
-        
-        char* saveptr = nullptr;
-        char* t1 = strtok_r(line, "|", &saveptr);
-        char* t2 = strtok_r(nullptr, "|", &saveptr);
-        char* t3 = strtok_r(nullptr, "|", &saveptr);
-
-        if (!t1 || !t2 || !t3) continue;
-
-        uint32_t as1 = static_cast<uint32_t>(std::strtoul(t1, nullptr, 10));
-        uint32_t as2 = static_cast<uint32_t>(std::strtoul(t2, nullptr, 10));
-        int rel = std::strtol(t3, nullptr, 10);
-
-        // Populate Graph instead of printing
-        graph.addRelationship(as1, as2, rel);
-        
-        line_count++;
-    }
-
-    pclose(fp);
-    std::cout << "Done. Parsed " << line_count << " lines.\n";
-}
\ No newline at end of file
+#include "parse_caida.h"
+#include "ASGraph.h" // Include the graph definition
+
+#include "MappedFile.h"
+
+#include <bzlib.h>
+
+#include <iostream>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace {
+
+// Typical length of an "as1|as2|rel|source" line, used to size the edge lists up front
+constexpr size_t BYTES_PER_LINE = 16;
+
+// Typical bzip2 ratio for as-rel files
+constexpr size_t BZ2_RATIO = 4;
+
+// Decompressed bytes handed to the scanner at a time
+constexpr size_t DECODE_BUFFER_SIZE = 8u << 20;
+
+// Reads an unsigned decimal number starting at p; false if there are no digits
+inline bool scan_uint(const char*& p, const char* end, uint32_t& out) {
+    const char* start = p;
+    uint32_t value = 0;
+    while (p < end && static_cast<unsigned>(*p - '0') < 10) {
+        value = value * 10 + static_cast<uint32_t>(*p - '0');
+        ++p;
+    }
+    out = value;
+    return p != start;
+}
+
+// Pointer-scanning parser for as-rel text, fed one buffer at a time
+struct CaidaScanner {
+    ASGraph& graph;
+    CaidaMetadata* metadata;
+    uint64_t line_count = 0;
+
+    CaidaScanner(ASGraph& graph, CaidaMetadata* metadata) : graph(graph), metadata(metadata) {}
+
+    void parse_line(const char* p, const char* eol) {
+        if (p < eol && eol[-1] == '\r') --eol;
+        if (p == eol) return;
+
+        if (*p == '#') {
+            if (metadata) metadata->comments.emplace_back(p + 1, eol);
+            return;
+        }
+
+        // as1|as2|rel[|source]
+        uint32_t as1, as2, rel_value;
+        if (!scan_uint(p, eol, as1) || p == eol || *p++ != '|') return;
+        if (!scan_uint(p, eol, as2) || p == eol || *p++ != '|') return;
+        bool negative = p < eol && *p == '-';
+        if (negative) ++p;
+        if (!scan_uint(p, eol, rel_value)) return;
+
+        int rel = negative ? -static_cast<int>(rel_value) : static_cast<int>(rel_value);
+        graph.addRelationship(as1, as2, rel);
+        line_count++;
+    }
+
+    // Parses every complete line in [p, end) and returns where the unparsed tail
+    // starts. With final=true a last line without a newline is parsed as well.
+    const char* scan(const char* p, const char* end, bool final) {
+        while (p < end) {
+            const char* eol = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+            if (!eol) {
+                if (!final) return p;
+                parse_line(p, end);
+                return end;
+            }
+            parse_line(p, eol);
+            p = eol + 1;
+        }
+        return p;
+    }
+};
+
+// Decodes a (possibly multi-stream) bzip2 image through the scanner
+bool decode_bz2(const char* in, size_t in_size, CaidaScanner& scanner) {
+    std::vector<char> buffer(DECODE_BUFFER_SIZE);
+    size_t carry = 0;
+    size_t streams_done = 0;
+
+    bz_stream strm;
+    std::memset(&strm, 0, sizeof(strm));
+    if (BZ2_bzDecompressInit(&strm, 0, 0) != BZ_OK) return false;
+
+    bool ok = true;
+    for (;;) {
+        // avail_in is 32-bit, so very large inputs are fed in slices
+        if (strm.avail_in == 0 && in_size > 0) {
+            unsigned int chunk = in_size > (1u << 30) ? (1u << 30) : static_cast<unsigned int>(in_size);
+            strm.next_in = const_cast<char*>(in);
+            strm.avail_in = chunk;
+            in += chunk;
+            in_size -= chunk;
+        }
+
+        strm.next_out = buffer.data() + carry;
+        strm.avail_out = static_cast<unsigned int>(buffer.size() - carry);
+        int rc = BZ2_bzDecompress(&strm);
+
+        // Anything that is not a bzip2 header after a complete stream is trailing junk, as with bzcat
+        if (rc == BZ_DATA_ERROR_MAGIC && streams_done > 0) {
+            rc = BZ_STREAM_END;
+            strm.avail_in = 0;
+            in_size = 0;
+        } else if (rc != BZ_OK && rc != BZ_STREAM_END) {
+            ok = false;
+            break;
+        }
+
+        const size_t filled = buffer.size() - strm.avail_out;
+        const bool input_left = strm.avail_in > 0 || in_size > 0;
+        const bool done = rc == BZ_STREAM_END && !input_left;
+
+        if (rc == BZ_OK && !input_left && strm.avail_out > 0) {
+            ok = false;  // Stream ended early: truncated file
+            break;
+        }
+
+        const char* rest = scanner.scan(buffer.data(), buffer.data() + filled, done);
+        carry = static_cast<size_t>(buffer.data() + filled - rest);
+        std::memmove(buffer.data(), rest, carry);
+        if (carry == buffer.size()) {
+            buffer.resize(buffer.size() * 2);  // A single line longer than the buffer
+        }
+
+        if (done) break;
+
+        if (rc == BZ_STREAM_END) {
+            // Concatenated streams (e.g. from pbzip2): restart the decoder on the rest
+            streams_done++;
+            char* next_in = strm.next_in;
+            unsigned int avail_in = strm.avail_in;
+            BZ2_bzDecompressEnd(&strm);
+            std::memset(&strm, 0, sizeof(strm));
+            if (BZ2_bzDecompressInit(&strm, 0, 0) != BZ_OK) return false;
+            strm.next_in = next_in;
+            strm.avail_in = avail_in;
+        }
+    }
+
+    BZ2_bzDecompressEnd(&strm);
+    return ok;
+}
+
+} // namespace
+
+bool parse_caida(const std::string& filename, ASGraph& graph, CaidaMetadata* metadata) {
+    MappedFile file(filename);
+    if (!file.ok()) {
+        std::cerr << "Error: failed to open file: " << filename << "\n";
+        return false;
+    }
+
+    const bool compressed = filename.size() > 4 && filename.compare(filename.size() - 4, 4, ".bz2") == 0;
+    graph.reserveEdges(file.size() * (compressed ? BZ2_RATIO : 1) / BYTES_PER_LINE);
+
+    CaidaScanner scanner(graph, metadata);
+
+    std::cout << "Parsing CAIDA file... ";
+
+    if (compressed) {
+        if (!decode_bz2(file.data(), file.size(), scanner)) {
+            std::cerr << "Error: failed to decompress bzip2 file: " << filename << "\n";
+            return false;
+        }
+    } else {
+        scanner.scan(file.data(), file.data() + file.size(), true);
+    }
+
+    std::cout << "Done. Parsed " << scanner.line_count << " lines.\n";
+    return true;
+}
@@ -1,4 +1,6 @@
 #include <iostream>
+#include <vector>
+#include <algorithm>
 #include "ASGraph.h"
 
 void test_simple_graph() {
@@ -82,6 +84,135 @@ void test_complex_graph_no_cycle() {
     std::cout << "PASSED: Complex Graph (No Cycle) test" << std::endl;
 }
 
+void test_duplicate_edges_removed() {
+    std::cout << "--- Running test: Duplicate Edges Removed ---" << std::endl;
+    ASGraph graph;
+    graph.addRelationship(1, 2, -1);
+    graph.addRelationship(1, 2, -1); // duplicate provider edge
+    graph.addRelationship(2, 3, 0);
+    graph.addRelationship(3, 2, 0);  // same peering listed from the other side
+    graph.freeze();
+
+    uint32_t idx1 = graph.getOrCreateNode(1)->index;
+    uint32_t idx2 = graph.getOrCreateNode(2)->index;
+
+    if (graph.customers(idx1).size() != 1 || graph.providers(idx2).size() != 1) {
+        std::cerr << "FAILED: Duplicate provider edge was not removed." << std::endl;
+        return;
+    }
+
+    if (graph.peers(idx2).size() != 1 || graph.getNumPeerEdges() != 1) {
+        std::cerr << "FAILED: Duplicate peer edge was not removed." << std::endl;
+        return;
+    }
+
+    std::cout << "PASSED: Duplicate Edges Removed test" << std::endl;
+}
+
+void test_all_cycles_reported() {
+    std::cout << "--- Running test: All Cycles Reported ---" << std::endl;
+    ASGraph graph;
+    graph.addRelationship(1, 2, -1); // cycle 1 -> 2 -> 1
+    graph.addRelationship(2, 1, -1);
+    graph.addRelationship(10, 11, -1); // cycle 10 -> 11 -> 12 -> 10
+    graph.addRelationship(11, 12, -1);
+    graph.addRelationship(12, 10, -1);
+    graph.addRelationship(20, 20, -1); // self loop
+    graph.addRelationship(30, 1, -1);  // above a cycle, but not on one
+    graph.addRelationship(40, 41, -1); // acyclic part
+
+    std::vector<std::vector<uint32_t>> cycles = graph.findProviderCycles();
+    std::sort(cycles.begin(), cycles.end());
+    std::vector<std::vector<uint32_t>> expected = {{1, 2}, {10, 11, 12}, {20}};
+
+    if (cycles != expected) {
+        std::cerr << "FAILED: Expected 3 cycles {1,2} {10,11,12} {20}, got " << cycles.size() << std::endl;
+        return;
+    }
+
+    std::cout << "PASSED: All Cycles Reported test" << std::endl;
+}
+
+void test_long_provider_chain() {
+    std::cout << "--- Running test: Long Provider Chain ---" << std::endl;
+    ASGraph graph;
+    const uint32_t length = 500000; // deep enough to overflow a recursive DFS
+    for (uint32_t asn = 1; asn < length; ++asn) {
+        graph.addRelationship(asn + 1, asn, -1);
+    }
+
+    if (graph.detectProviderCycles()) {
+        std::cerr << "FAILED: Detected a cycle in a simple chain." << std::endl;
+        return;
+    }
+
+    std::vector<std::vector<uint32_t>> ranked = graph.getRankedASes();
+    if (ranked.size() != length || graph.getOrCreateNode(length)->propagation_rank != static_cast<int>(length - 1)) {
+        std::cerr << "FAILED: Chain should have " << length << " ranks." << std::endl;
+        return;
+    }
+
+    graph.addRelationship(1, length, -1); // close the loop
+    std::vector<std::vector<uint32_t>> cycles = graph.findProviderCycles();
+    if (cycles.size() != 1 || cycles[0].size() != length) {
+        std::cerr << "FAILED: Closing the chain should give one cycle of every AS." << std::endl;
+        return;
+    }
+
+    std::cout << "PASSED: Long Provider Chain test" << std::endl;
+}
+
+void test_asn_index_and_policies() {
+    std::cout << "--- Running test: ASN Index and Policy Bitsets ---" << std::endl;
+    ASGraph graph;
+    const uint32_t asns[] = {4200000000u, 7, 3356, 65536, 0, 174, UINT32_MAX - 1};
+    for (uint32_t asn : asns) {
+        graph.addRelationship(asn, 1, -1);
+    }
+
+    // Found through the unsorted map before freeze() and the sorted arrays after it
+    for (int pass = 0; pass < 2; ++pass) {
+        for (uint32_t asn : asns) {
+            const ASNode* node = graph.findNode(asn);
+            if (!node || node->asn != asn || &graph.node(node->index) != node) {
+                std::cerr << "FAILED: ASN " << asn << " not found (pass " << pass << ")." << std::endl;
+                return;
+            }
+        }
+        if (graph.findNode(2) || graph.findNode(UINT32_MAX)) {
+            std::cerr << "FAILED: Found an ASN that was never added." << std::endl;
+            return;
+        }
+        graph.freeze();
+    }
+
+    // A node created after freeze() is indexed by the next one
+    const uint32_t late = graph.getOrCreateNode(64512)->index;
+    if (graph.findNode(64512)->index != late || graph.getOrCreateNode(64512)->index != late) {
+        std::cerr << "FAILED: Node created after freeze() not found." << std::endl;
+        return;
+    }
+    graph.freeze();
+    if (graph.findNode(64512)->index != late || graph.getNumNodes() != 9) {
+        std::cerr << "FAILED: Index lost a node after refreezing." << std::endl;
+        return;
+    }
+
+    // Policies are bitsets over dense indices; unset nodes run BGP
+    const uint32_t rov = graph.findNode(3356)->index;
+    graph.setPolicy(rov, PolicyKind::ROV);
+    graph.setPolicy(late, PolicyKind::ROV);
+    graph.setPolicy(late, PolicyKind::BGP);
+    const DenseBitset& members = graph.getPolicies().members(PolicyKind::ROV);
+    if (graph.getPolicy(rov) != PolicyKind::ROV || graph.getPolicy(late) != PolicyKind::BGP || members.count() != 1 ||
+        graph.getPolicies().filtering(FILTER_ROV_INVALID) != members) {
+        std::cerr << "FAILED: Policy bitsets do not hold the assigned policies." << std::endl;
+        return;
+    }
+
+    std::cout << "PASSED: ASN Index and Policy Bitsets test" << std::endl;
+}
+
 
 int main() {
     std::cout << "========================================" << std::endl;
@@ -92,6 +223,10 @@ int main() {
     test_provider_cycle();
     test_peer_relationship();
     test_complex_graph_no_cycle();
+    test_duplicate_edges_removed();
+    test_all_cycles_reported();
+    test_long_provider_chain();
+    test_asn_index_and_policies();
     
     std::cout << "\n========================================" << std::endl;
     std::cout << "All unit tests completed!" << std::endl;
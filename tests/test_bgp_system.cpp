@@ -2,11 +2,31 @@
 #include <fstream>
 #include <sstream>
 #include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <chrono>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 #include "ASGraph.h"
 #include "Announcement.h"
 #include "Policy.h"
+#include "Prefix.h"
 #include "Propagation.h"
 #include "parse_caida.h"
+#include "GraphSnapshot.h"
+#include "RibWriter.h"
+#include "RibBinary.h"
+#include "Scenario.h"
+#include "TopologyGenerator.h"
+#include "RunStats.h"
+#include "InputLoader.h"
+#include "QueryServer.h"
+#include "LpmIndex.h"
+#include <zlib.h>
+#include <bzlib.h>
 
 /**
  * System tests for BGP propagation
@@ -15,28 +35,24 @@
  */
 
 // Helper function to check if a specific ASN has a specific prefix in its RIB
-bool has_prefix_in_rib(ASGraph& graph, uint32_t asn, const std::string& prefix) {
+bool has_prefix_in_rib(PropagationEngine& engine, ASGraph& graph, uint32_t asn, uint32_t prefix_id) {
     ASNode* node = graph.getOrCreateNode(asn);
     if (!node) return false;
     
-    BGP* policy = dynamic_cast<BGP*>(node->policy.get());
-    if (!policy) return false;
-    
-    return policy->local_rib.find(prefix) != policy->local_rib.end();
+    const LocalRib& local_rib = engine.local_rib(node->index);
+    return local_rib.find(prefix_id) != local_rib.end();
 }
 
 // Helper function to get AS path for a prefix at an ASN
-std::vector<uint32_t> get_as_path(ASGraph& graph, uint32_t asn, const std::string& prefix) {
+std::vector<uint32_t> get_as_path(PropagationEngine& engine, ASGraph& graph, uint32_t asn, uint32_t prefix_id) {
     ASNode* node = graph.getOrCreateNode(asn);
     if (!node) return {};
     
-    BGP* policy = dynamic_cast<BGP*>(node->policy.get());
-    if (!policy) return {};
-    
-    auto it = policy->local_rib.find(prefix);
-    if (it == policy->local_rib.end()) return {};
+    const LocalRib& local_rib = engine.local_rib(node->index);
+    auto it = local_rib.find(prefix_id);
+    if (it == local_rib.end()) return {};
     
-    return it->second.as_path;
+    return engine.paths().to_vector(it->second.as_path);
 }
 
 /**
@@ -49,37 +65,38 @@ void test_single_announcement_tiny_graph() {
     std::cout << "\n=== Test: Single Announcement (Tiny Graph) ===" << std::endl;
     
     ASGraph graph;
+    PrefixTable prefixes;
+    uint32_t prefix = prefixes.intern("1.2.0.0/16");
     graph.addRelationship(1, 2, -1); // 1 is provider of 2
     
+    PropagationEngine engine(graph);
+
     // Seed announcement at AS 1
-    ASNode* node1 = graph.getOrCreateNode(1);
-    Announcement ann("1.2.0.0/16", {1}, 1, Relationship::ORIGIN, false);
-    BGP* policy1 = dynamic_cast<BGP*>(node1->policy.get());
-    policy1->local_rib["1.2.0.0/16"] = ann;
+    engine.seed(graph.getOrCreateNode(1)->index, prefix, false);
     
     // Run propagation
-    PropagationEngine::run_propagation(graph);
+    engine.run_propagation();
     
     // Verify AS 1 has the prefix (origin)
-    if (!has_prefix_in_rib(graph, 1, "1.2.0.0/16")) {
+    if (!has_prefix_in_rib(engine, graph, 1, prefix)) {
         std::cerr << "FAILED: AS 1 should have prefix 1.2.0.0/16" << std::endl;
         return;
     }
     
     // Verify AS 2 has the prefix (received from provider)
-    if (!has_prefix_in_rib(graph, 2, "1.2.0.0/16")) {
+    if (!has_prefix_in_rib(engine, graph, 2, prefix)) {
         std::cerr << "FAILED: AS 2 should have prefix 1.2.0.0/16" << std::endl;
         return;
     }
     
     // Verify AS paths
-    auto path1 = get_as_path(graph, 1, "1.2.0.0/16");
+    auto path1 = get_as_path(engine, graph, 1, prefix);
     if (path1.size() != 1 || path1[0] != 1) {
         std::cerr << "FAILED: AS 1 should have path (1)" << std::endl;
         return;
     }
     
-    auto path2 = get_as_path(graph, 2, "1.2.0.0/16");
+    auto path2 = get_as_path(engine, graph, 2, prefix);
     if (path2.size() != 2 || path2[0] != 2 || path2[1] != 1) {
         std::cerr << "FAILED: AS 2 should have path (2, 1)" << std::endl;
         return;
@@ -98,24 +115,25 @@ void test_larger_graph() {
     std::cout << "\n=== Test: Larger Graph ===" << std::endl;
     
     ASGraph graph;
+    PrefixTable prefixes;
+    uint32_t prefix = prefixes.intern("1.2.0.0/16");
     graph.addRelationship(1, 2, -1); // 1 is provider of 2
     graph.addRelationship(2, 3, -1); // 2 is provider of 3
     graph.addRelationship(1, 4, -1);  // 1 is provider of 4
     graph.addRelationship(2, 5, 0);   // 2 and 5 are peers
     
+    PropagationEngine engine(graph);
+
     // Seed announcement at AS 1
-    ASNode* node1 = graph.getOrCreateNode(1);
-    Announcement ann("1.2.0.0/16", {1}, 1, Relationship::ORIGIN, false);
-    BGP* policy1 = dynamic_cast<BGP*>(node1->policy.get());
-    policy1->local_rib["1.2.0.0/16"] = ann;
+    engine.seed(graph.getOrCreateNode(1)->index, prefix, false);
     
     // Run propagation
-    PropagationEngine::run_propagation(graph);
+    engine.run_propagation();
     
     // Verify all ASes have the prefix
     uint32_t ases[] = {1, 2, 3, 4, 5};
     for (uint32_t asn : ases) {
-        if (!has_prefix_in_rib(graph, asn, "1.2.0.0/16")) {
+        if (!has_prefix_in_rib(engine, graph, asn, prefix)) {
             std::cerr << "FAILED: AS " << asn << " should have prefix 1.2.0.0/16" << std::endl;
             return;
         }
@@ -134,32 +152,30 @@ void test_multiple_announcements_same_prefix() {
     std::cout << "\n=== Test: Multiple Announcements (Same Prefix) ===" << std::endl;
     
     ASGraph graph;
+    PrefixTable prefixes;
+    uint32_t prefix = prefixes.intern("1.2.0.0/16");
     graph.addRelationship(1, 2, -1); // 1 is provider of 2
     graph.addRelationship(3, 2, -1); // 3 is provider of 2
     
+    PropagationEngine engine(graph);
+
     // Seed announcement at AS 1
-    ASNode* node1 = graph.getOrCreateNode(1);
-    Announcement ann1("1.2.0.0/16", {1}, 1, Relationship::ORIGIN, false);
-    BGP* policy1 = dynamic_cast<BGP*>(node1->policy.get());
-    policy1->local_rib["1.2.0.0/16"] = ann1;
+    engine.seed(graph.getOrCreateNode(1)->index, prefix, false);
     
     // Seed announcement at AS 3
-    ASNode* node3 = graph.getOrCreateNode(3);
-    Announcement ann3("1.2.0.0/16", {3}, 3, Relationship::ORIGIN, false);
-    BGP* policy3 = dynamic_cast<BGP*>(node3->policy.get());
-    policy3->local_rib["1.2.0.0/16"] = ann3;
+    engine.seed(graph.getOrCreateNode(3)->index, prefix, false);
     
     // Run propagation
-    PropagationEngine::run_propagation(graph);
+    engine.run_propagation();
     
     // AS 2 should have the prefix
-    if (!has_prefix_in_rib(graph, 2, "1.2.0.0/16")) {
+    if (!has_prefix_in_rib(engine, graph, 2, prefix)) {
         std::cerr << "FAILED: AS 2 should have prefix 1.2.0.0/16" << std::endl;
         return;
     }
     
     // AS 2 should choose one of the paths (both are from customers, so path length or ASN decides)
-    auto path2 = get_as_path(graph, 2, "1.2.0.0/16");
+    auto path2 = get_as_path(engine, graph, 2, prefix);
     if (path2.size() != 2) {
         std::cerr << "FAILED: AS 2 should have path length 2" << std::endl;
         return;
@@ -186,32 +202,30 @@ void test_customer_vs_provider_preference() {
     std::cout << "\n=== Test: Customer vs Provider Preference ===" << std::endl;
     
     ASGraph graph;
+    PrefixTable prefixes;
+    uint32_t prefix = prefixes.intern("1.2.0.0/16");
     graph.addRelationship(1, 2, -1); // 1 is provider of 2
     graph.addRelationship(2, 3, -1); // 2 is provider of 3 (so 3 is customer of 2)
     
+    PropagationEngine engine(graph);
+
     // Seed announcement at AS 1
-    ASNode* node1 = graph.getOrCreateNode(1);
-    Announcement ann1("1.2.0.0/16", {1}, 1, Relationship::ORIGIN, false);
-    BGP* policy1 = dynamic_cast<BGP*>(node1->policy.get());
-    policy1->local_rib["1.2.0.0/16"] = ann1;
+    engine.seed(graph.getOrCreateNode(1)->index, prefix, false);
     
     // Seed announcement at AS 3
-    ASNode* node3 = graph.getOrCreateNode(3);
-    Announcement ann3("1.2.0.0/16", {3}, 3, Relationship::ORIGIN, false);
-    BGP* policy3 = dynamic_cast<BGP*>(node3->policy.get());
-    policy3->local_rib["1.2.0.0/16"] = ann3;
+    engine.seed(graph.getOrCreateNode(3)->index, prefix, false);
     
     // Run propagation
-    PropagationEngine::run_propagation(graph);
+    engine.run_propagation();
     
     // AS 2 should have the prefix
-    if (!has_prefix_in_rib(graph, 2, "1.2.0.0/16")) {
+    if (!has_prefix_in_rib(engine, graph, 2, prefix)) {
         std::cerr << "FAILED: AS 2 should have prefix 1.2.0.0/16" << std::endl;
         return;
     }
     
     // AS 2 should prefer customer (AS 3) over provider (AS 1)
-    auto path2 = get_as_path(graph, 2, "1.2.0.0/16");
+    auto path2 = get_as_path(engine, graph, 2, prefix);
     if (path2.size() != 2 || path2[1] != 3) {
         std::cerr << "FAILED: AS 2 should prefer customer (AS 3) over provider (AS 1)" << std::endl;
         std::cerr << "  Got path: (";
@@ -233,40 +247,38 @@ void test_output_format() {
     std::cout << "\n=== Test: Output Format ===" << std::endl;
     
     ASGraph graph;
+    PrefixTable prefixes;
+    uint32_t prefix = prefixes.intern("1.2.0.0/16");
     graph.addRelationship(1, 2, -1);
     
+    PropagationEngine engine(graph);
+
     // Seed announcement
-    ASNode* node1 = graph.getOrCreateNode(1);
-    Announcement ann("1.2.0.0/16", {1}, 1, Relationship::ORIGIN, false);
-    BGP* policy1 = dynamic_cast<BGP*>(node1->policy.get());
-    policy1->local_rib["1.2.0.0/16"] = ann;
+    engine.seed(graph.getOrCreateNode(1)->index, prefix, false);
     
-    PropagationEngine::run_propagation(graph);
+    engine.run_propagation();
     
     // Write output to temporary file
     std::ofstream out("test_output.csv");
     out << "asn,prefix,as_path\n";
     
-    for (const auto& pair : graph.getNodes()) {
-        ASNode* node = pair.second.get();
-        BGP* policy = dynamic_cast<BGP*>(node->policy.get());
-        if (policy) {
-            for (const auto& rib_entry : policy->local_rib) {
-                const Announcement& ann = rib_entry.second;
-                
-                std::string path_str = "(";
-                for (size_t i = 0; i < ann.as_path.size(); ++i) {
-                    path_str += std::to_string(ann.as_path[i]);
-                    if (i < ann.as_path.size() - 1) {
-                        path_str += ", ";
-                    } else if (ann.as_path.size() == 1) {
-                        path_str += ",";
-                    }
+    for (const ASNode& node : graph.getNodes()) {
+        for (const auto& rib_entry : engine.local_rib(node.index)) {
+            const Announcement& ann = rib_entry.second;
+            
+            std::vector<uint32_t> as_path = engine.paths().to_vector(ann.as_path);
+            std::string path_str = "(";
+            for (size_t i = 0; i < as_path.size(); ++i) {
+                path_str += std::to_string(as_path[i]);
+                if (i < as_path.size() - 1) {
+                    path_str += ", ";
+                } else if (as_path.size() == 1) {
+                    path_str += ",";
                 }
-                path_str += ")";
-                
-                out << node->asn << "," << ann.prefix << ",\"" << path_str << "\"\n";
             }
+            path_str += ")";
+            
+            out << node.asn << "," << prefixes.to_string(ann.prefix_id) << ",\"" << path_str << "\"\n";
         }
     }
     out.close();
@@ -305,6 +317,1479 @@ void test_output_format() {
     std::cout << "PASSED: Output format is correct" << std::endl;
 }
 
+/**
+ * Test 6: Prefix interning
+ * Same prefix text maps to the same id, IPv4 and IPv6 parse to binary form,
+ * and the original text comes back for output.
+ */
+void test_prefix_interning() {
+    std::cout << "\n=== Test: Prefix Interning ===" << std::endl;
+
+    PrefixTable prefixes;
+    uint32_t v4 = prefixes.intern("1.2.0.0/16");
+    uint32_t v6 = prefixes.intern("2001:db8::/32");
+
+    if (v4 == PrefixTable::INVALID_ID || v6 == PrefixTable::INVALID_ID || v4 == v6) {
+        std::cerr << "FAILED: Valid prefixes should get distinct ids" << std::endl;
+        return;
+    }
+
+    if (prefixes.intern("1.2.0.0/16") != v4 || prefixes.size() != 2) {
+        std::cerr << "FAILED: Re-interning a prefix should return the same id" << std::endl;
+        return;
+    }
+
+    const Prefix& p4 = prefixes.get(v4);
+    const Prefix& p6 = prefixes.get(v6);
+    if (p4.is_ipv6 || p4.length != 16 || p4.addr[0] != 1 || p4.addr[1] != 2 ||
+        !p6.is_ipv6 || p6.length != 32 || p6.addr[0] != 0x20 || p6.addr[1] != 0x01) {
+        std::cerr << "FAILED: Prefix binary form is wrong" << std::endl;
+        return;
+    }
+
+    if (prefixes.to_string(v6) != "2001:db8::/32") {
+        std::cerr << "FAILED: Prefix text should round-trip for output" << std::endl;
+        return;
+    }
+
+    if (prefixes.intern("1.2.0.0/33") != PrefixTable::INVALID_ID ||
+        prefixes.intern("not-a-prefix") != PrefixTable::INVALID_ID) {
+        std::cerr << "FAILED: Malformed prefixes should be rejected" << std::endl;
+        return;
+    }
+
+    std::cout << "PASSED: Prefix interning works correctly" << std::endl;
+}
+
+/**
+ * Test 7: Shared AS-path tree
+ * Extending the same path with the same ASN returns the same handle,
+ * and paths read back receiving AS first, origin last.
+ */
+void test_path_tree_sharing() {
+    std::cout << "\n=== Test: Shared AS-Path Tree ===" << std::endl;
+
+    ASPathTree paths;
+    PathHandle origin = paths.extend(ASPathTree::EMPTY, 1);
+    PathHandle via2 = paths.extend(origin, 2);
+    PathHandle via3 = paths.extend(origin, 3);
+
+    if (paths.extend(origin, 2) != via2 || via2 == via3) {
+        std::cerr << "FAILED: Identical paths should share one handle" << std::endl;
+        return;
+    }
+
+    std::vector<uint32_t> path = paths.to_vector(paths.extend(via2, 4));
+    if (path.size() != 3 || path[0] != 4 || path[1] != 2 || path[2] != 1) {
+        std::cerr << "FAILED: Path should read (4, 2, 1)" << std::endl;
+        return;
+    }
+
+    // 1 root + 4 distinct paths: (1), (2,1), (3,1), (4,2,1)
+    if (paths.size() != 5) {
+        std::cerr << "FAILED: Expected 5 path nodes, got " << paths.size() << std::endl;
+        return;
+    }
+
+    std::cout << "PASSED: AS paths are shared and read back in order" << std::endl;
+}
+
+// Build the same pseudo-random topology and seeds into a graph (deterministic)
+void build_mixed_graph(ASGraph& graph, PropagationEngine& engine, PrefixTable& prefixes) {
+    uint32_t state = 12345;
+    auto next = [&state]() { state = state * 1103515245u + 12345u; return (state >> 16) & 0x7fff; };
+
+    const uint32_t num_ases = 60;
+    for (uint32_t asn = 2; asn <= num_ases; ++asn) {
+        // Providers always have a lower ASN, so there are no provider cycles
+        graph.addRelationship(1 + next() % (asn - 1), asn, -1);
+        if (next() % 2) graph.addRelationship(1 + next() % (asn - 1), asn, -1);
+        if (next() % 3 == 0) graph.addRelationship(asn, 1 + next() % num_ases, 0);
+    }
+    for (uint32_t asn = 1; asn <= num_ases; asn += 7) {
+        graph.setPolicy(graph.getOrCreateNode(asn)->index, PolicyKind::ROV);
+    }
+
+    for (int i = 0; i < 12; ++i) {
+        uint32_t prefix = prefixes.intern("10." + std::to_string(i) + ".0.0/16");
+        for (int k = 0; k < 2; ++k) {
+            uint32_t origin = 1 + next() % num_ases;
+            engine.seed(graph.getOrCreateNode(origin)->index, prefix, next() % 3 == 0);
+        }
+    }
+}
+
+// Compare every RIB entry of two graphs built by build_mixed_graph; returns routes compared or -1 on mismatch
+long compare_ribs(const PropagationEngine& expected, const PropagationEngine& actual) {
+    long compared = 0;
+    for (const ASNode& node : expected.getGraph().getNodes()) {
+        const LocalRib& expected_rib = expected.local_rib(node.index);
+        const LocalRib& actual_rib = actual.local_rib(node.index);
+
+        if (expected_rib.size() != actual_rib.size()) {
+            std::cerr << "  AS " << node.asn << " RIB size differs" << std::endl;
+            return -1;
+        }
+        for (const auto& [prefix, ann] : expected_rib) {
+            auto it = actual_rib.find(prefix);
+            if (it == actual_rib.end() ||
+                expected.paths().to_vector(ann.as_path) != actual.paths().to_vector(it->second.as_path)) {
+                std::cerr << "  AS " << node.asn << " route differs" << std::endl;
+                return -1;
+            }
+            compared++;
+        }
+    }
+    return compared;
+}
+
+/**
+ * Test 8: Parallel engine matches serial engine
+ * Runs the same mixed graph (peers, ROV, competing origins) through the serial
+ * engine and the multi-threaded receiver-pull engine and compares every RIB entry.
+ */
+void test_parallel_matches_serial() {
+    std::cout << "\n=== Test: Parallel Engine Matches Serial ===" << std::endl;
+
+    ASGraph serial_graph, parallel_graph;
+    PropagationEngine serial_engine(serial_graph), parallel_engine(parallel_graph);
+    PrefixTable serial_prefixes, parallel_prefixes;
+    build_mixed_graph(serial_graph, serial_engine, serial_prefixes);
+    build_mixed_graph(parallel_graph, parallel_engine, parallel_prefixes);
+
+    serial_engine.run_propagation();
+    parallel_engine.run_propagation(4);
+
+    long compared = compare_ribs(serial_engine, parallel_engine);
+    if (compared < 0) {
+        std::cerr << "FAILED: Parallel engine output differs from serial engine" << std::endl;
+        return;
+    }
+
+    std::cout << "PASSED: Parallel engine matches serial engine (" << compared << " routes)" << std::endl;
+}
+
+/**
+ * Test 9: Prefix-major engine matches serial engine
+ * Same mixed graph, propagated one prefix at a time (single- and multi-threaded).
+ */
+void test_prefix_major_matches_serial() {
+    std::cout << "\n=== Test: Prefix-Major Engine Matches Serial ===" << std::endl;
+
+    ASGraph serial_graph;
+    PropagationEngine serial_engine(serial_graph);
+    PrefixTable serial_prefixes;
+    build_mixed_graph(serial_graph, serial_engine, serial_prefixes);
+    serial_engine.run_propagation();
+
+    for (size_t threads : {1, 4}) {
+        ASGraph prefix_graph;
+        PropagationEngine prefix_engine(prefix_graph);
+        PrefixTable prefixes;
+        build_mixed_graph(prefix_graph, prefix_engine, prefixes);
+        prefix_engine.run_propagation(threads, EngineMode::PREFIX_MAJOR);
+
+        if (compare_ribs(serial_engine, prefix_engine) < 0) {
+            std::cerr << "FAILED: Prefix-major engine (" << threads << " threads) differs from serial engine" << std::endl;
+            return;
+        }
+    }
+
+    std::cout << "PASSED: Prefix-major engine matches serial engine" << std::endl;
+}
+
+/**
+ * Test 10: CAIDA parsing
+ * Plain and bzip2 (two concatenated streams) inputs give the same graph,
+ * comment lines are kept as metadata, and CRLF, malformed lines and a
+ * missing final newline are handled.
+ */
+void test_parse_caida() {
+    std::cout << "\n=== Test: CAIDA Parsing ===" << std::endl;
+
+    const std::string header = "# source:topology|BGP|20251001|test\n# input clique: 1 2\n";
+    const std::string body =
+        "1|2|0|bgp\r\n"
+        "1|3|-1|bgp\n"
+        "not|a|line\n"
+        "\n"
+        "2|4|-1|bgp\n"
+        "3|5|-1";
+
+    {
+        std::ofstream out("test_rel.txt", std::ios::binary);
+        out << header << body;
+    }
+
+    // Compress header and body as separate streams, as parallel bzip2 tools do
+    std::string compressed;
+    for (const std::string& part : {header, body}) {
+        std::vector<char> buf(part.size() + 1024);
+        unsigned int len = static_cast<unsigned int>(buf.size());
+        BZ2_bzBuffToBuffCompress(buf.data(), &len, const_cast<char*>(part.data()),
+                                 static_cast<unsigned int>(part.size()), 9, 0, 0);
+        compressed.append(buf.data(), len);
+    }
+    {
+        std::ofstream out("test_rel.txt.bz2", std::ios::binary);
+        out << compressed;
+    }
+
+    for (const char* file : {"test_rel.txt", "test_rel.txt.bz2"}) {
+        ASGraph graph;
+        CaidaMetadata metadata;
+        if (!parse_caida(file, graph, &metadata)) {
+            std::cerr << "FAILED: " << file << " reported a parse error" << std::endl;
+            return;
+        }
+        graph.freeze();
+
+        if (graph.getNumNodes() != 5 || graph.getNumProviderEdges() != 3 || graph.getNumPeerEdges() != 1) {
+            std::cerr << "FAILED: " << file << " parsed to wrong graph" << std::endl;
+            return;
+        }
+        if (metadata.comments.size() != 2 || metadata.comments[1] != " input clique: 1 2") {
+            std::cerr << "FAILED: " << file << " comment metadata not preserved" << std::endl;
+            return;
+        }
+    }
+
+    // A truncated bzip2 file and a missing file are reported as failures
+    {
+        std::ofstream out("test_rel_truncated.txt.bz2", std::ios::binary);
+        out << compressed.substr(0, compressed.size() / 2);
+    }
+    ASGraph truncated;
+    if (parse_caida("test_rel_truncated.txt.bz2", truncated) || parse_caida("test_rel_missing.txt", truncated)) {
+        std::cerr << "FAILED: truncated or missing CAIDA file was accepted" << std::endl;
+        return;
+    }
+
+    std::remove("test_rel.txt");
+    std::remove("test_rel.txt.bz2");
+    std::remove("test_rel_truncated.txt.bz2");
+
+    std::cout << "PASSED: Plain and bzip2 CAIDA files parse to the same graph with metadata" << std::endl;
+}
+
+/**
+ * Test 11: Graph snapshot
+ * A saved snapshot loads back to the same nodes, adjacency, ranks and
+ * metadata, skips revalidation, propagates identically, and a damaged
+ * file is rejected. The loaded graph views the mapped file, can be saved
+ * over that same file, and copies its arrays out once it grows.
+ */
+void test_graph_snapshot() {
+    std::cout << "\n=== Test: Graph Snapshot ===" << std::endl;
+
+    ASGraph original;
+    PropagationEngine original_engine(original);
+    PrefixTable original_prefixes;
+    build_mixed_graph(original, original_engine, original_prefixes);
+    original.detectProviderCycles();
+
+    CaidaMetadata metadata;
+    metadata.comments = {" source:test", " input clique: 1 2 3"};
+    if (!save_graph_snapshot(original, "test_graph.snap", &metadata)) {
+        std::cerr << "FAILED: Could not save snapshot" << std::endl;
+        return;
+    }
+
+    ASGraph loaded;
+    CaidaMetadata loaded_metadata;
+    if (!load_graph_snapshot("test_graph.snap", loaded, &loaded_metadata)) {
+        std::cerr << "FAILED: Could not load snapshot" << std::endl;
+        return;
+    }
+
+    if (loaded.getNumNodes() != original.getNumNodes() ||
+        loaded.getNumProviderEdges() != original.getNumProviderEdges() ||
+        loaded.getNumPeerEdges() != original.getNumPeerEdges() ||
+        loaded_metadata.comments != metadata.comments) {
+        std::cerr << "FAILED: Snapshot does not match the original graph" << std::endl;
+        return;
+    }
+    for (uint32_t i = 0; i < original.getNumNodes(); ++i) {
+        const ASNode& a = original.node(i);
+        const ASNode& b = loaded.node(i);
+        if (a.asn != b.asn || a.propagation_rank != b.propagation_rank ||
+            std::vector<uint32_t>(original.providers(i).begin(), original.providers(i).end()) !=
+            std::vector<uint32_t>(loaded.providers(i).begin(), loaded.providers(i).end())) {
+            std::cerr << "FAILED: Node " << i << " differs after reload" << std::endl;
+            return;
+        }
+        if (loaded.getOrCreateNode(a.asn) != &b) {
+            std::cerr << "FAILED: ASN lookup broken after reload" << std::endl;
+            return;
+        }
+    }
+    if (loaded.detectProviderCycles()) {
+        std::cerr << "FAILED: Loaded snapshot should be known acyclic" << std::endl;
+        return;
+    }
+
+    // Policies and seeds are per run, so replay them on the loaded graph
+    PropagationEngine loaded_engine(loaded);
+    PrefixTable loaded_prefixes;
+    ASGraph scratch;
+    PropagationEngine scratch_engine(scratch);
+    build_mixed_graph(scratch, scratch_engine, loaded_prefixes);
+    for (uint32_t i = 0; i < scratch.getNumNodes(); ++i) {
+        loaded.setPolicy(i, scratch.getPolicy(i));
+        for (auto const& [prefix, ann] : scratch_engine.local_rib(i)) {
+            loaded_engine.seed(i, prefix, ann.rov_invalid);
+        }
+    }
+    original_engine.run_propagation();
+    loaded_engine.run_propagation();
+    if (compare_ribs(original_engine, loaded_engine) < 0) {
+        std::cerr << "FAILED: Propagation on the loaded snapshot differs" << std::endl;
+        return;
+    }
+
+    if (!loaded.getNodes().borrowed()) {
+        std::cerr << "FAILED: Loaded nodes should view the mapped snapshot" << std::endl;
+        return;
+    }
+    ASGraph grown;
+    if (!save_graph_snapshot(loaded, "test_graph.snap", &metadata) ||
+        !load_graph_snapshot("test_graph.snap", grown)) {
+        std::cerr << "FAILED: Could not save a loaded graph over its own snapshot" << std::endl;
+        return;
+    }
+    const uint32_t new_asn = 4000000000u;
+    grown.addRelationship(new_asn, original.node(0).asn, -1);
+    grown.freeze();
+    if (grown.getNodes().borrowed() || grown.getNumNodes() != original.getNumNodes() + 1 ||
+        grown.getNumProviderEdges() != original.getNumProviderEdges() + 1 ||
+        !grown.findNode(new_asn) || grown.detectProviderCycles()) {
+        std::cerr << "FAILED: Growing a loaded graph lost or broke its topology" << std::endl;
+        return;
+    }
+    for (uint32_t i = 0; i < original.getNumNodes(); ++i) {
+        const ASNode* found = grown.findNode(original.node(i).asn);
+        if (!found || found->index != i) {
+            std::cerr << "FAILED: ASN lookup broken after growing a loaded graph" << std::endl;
+            return;
+        }
+    }
+
+    // Flip one payload byte: the checksum must catch it
+    {
+        std::fstream f("test_graph.snap", std::ios::in | std::ios::out | std::ios::binary);
+        f.seekg(sizeof(GraphSnapshotHeader) + 5);
+        char c = static_cast<char>(f.get());
+        f.seekp(sizeof(GraphSnapshotHeader) + 5);
+        f.put(static_cast<char>(c ^ 0x10));
+    }
+    ASGraph damaged;
+    if (load_graph_snapshot("test_graph.snap", damaged) || damaged.getNumNodes() != 0) {
+        std::cerr << "FAILED: Damaged snapshot should be rejected" << std::endl;
+        return;
+    }
+
+    std::remove("test_graph.snap");
+
+    std::cout << "PASSED: Snapshot round-trips graph, ranks and metadata, loads in place and rejects damage" << std::endl;
+}
+
+/**
+ * Test 12: Parallel RIB writer
+ * The CSV is identical for 1 and 3 threads, its gzip form decompresses to
+ * the same bytes, and every RIB entry is written once.
+ */
+void test_rib_writer() {
+    std::cout << "\n=== Test: Parallel RIB Writer ===" << std::endl;
+
+    ASGraph graph;
+    PropagationEngine engine(graph);
+    PrefixTable prefixes;
+    build_mixed_graph(graph, engine, prefixes);
+    engine.run_propagation();
+
+    auto read_all = [](const char* file) {
+        std::string bytes;
+        gzFile in = gzopen(file, "rb");  // Also reads uncompressed files as-is
+        char buf[1 << 14];
+        int got;
+        while (in && (got = gzread(in, buf, sizeof(buf))) > 0) bytes.append(buf, got);
+        if (in) gzclose(in);
+        return bytes;
+    };
+
+    uint64_t rows = 0, expected_rows = 0;
+    for (uint32_t i = 0; i < graph.getNumNodes(); ++i) {
+        expected_rows += engine.local_rib(i).size();
+    }
+
+    write_ribs_csv(engine, prefixes, "test_ribs_1.csv", 1, OutputCompression::NONE, &rows);
+    write_ribs_csv(engine, prefixes, "test_ribs_3.csv", 3);
+    write_ribs_csv(engine, prefixes, "test_ribs_3.csv.gz", 3, OutputCompression::GZIP);
+
+    std::string serial = read_all("test_ribs_1.csv");
+    std::string threaded = read_all("test_ribs_3.csv");
+    std::string unzipped = read_all("test_ribs_3.csv.gz");
+
+    std::remove("test_ribs_1.csv");
+    std::remove("test_ribs_3.csv");
+    std::remove("test_ribs_3.csv.gz");
+
+    long lines = std::count(serial.begin(), serial.end(), '\n');
+    if (rows != expected_rows || lines != static_cast<long>(rows) + 1 ||
+        serial.compare(0, 19, "asn,prefix,as_path\n") != 0) {
+        std::cerr << "FAILED: Expected header plus " << expected_rows << " rows, got " << lines << " lines" << std::endl;
+        return;
+    }
+    if (serial != threaded || serial != unzipped) {
+        std::cerr << "FAILED: Threaded or gzip output differs from the serial CSV" << std::endl;
+        return;
+    }
+
+    std::cout << "PASSED: RIB writer output is identical across threads and gzip (" << rows << " rows)" << std::endl;
+}
+
+/**
+ * Test 13: Binary RIB output
+ * The columnar file converts back to exactly the CSV bytes, paths built by
+ * several path-tree writers are stored once in the path table, and the serial
+ * engine writes the same file.
+ */
+void test_rib_binary() {
+    std::cout << "\n=== Test: Binary RIB Output ===" << std::endl;
+
+    ASGraph graph;
+    PropagationEngine engine(graph);
+    PrefixTable prefixes;
+    build_mixed_graph(graph, engine, prefixes);
+    engine.run_propagation(3);
+
+    ASGraph serial_graph;
+    PropagationEngine serial_engine(serial_graph);
+    PrefixTable serial_prefixes;
+    build_mixed_graph(serial_graph, serial_engine, serial_prefixes);
+    serial_engine.run_propagation();
+
+    uint64_t rows = 0;
+    write_ribs_csv(engine, prefixes, "test_ribs.csv");
+    write_ribs_binary(engine, prefixes, "test_ribs.bin", &rows);
+    write_ribs_binary(serial_engine, serial_prefixes, "test_ribs_serial.bin");
+
+    RibBinaryReader reader;
+    if (!reader.open("test_ribs.bin") || reader.num_rows() != rows) {
+        std::cerr << "FAILED: Binary RIB file did not load" << std::endl;
+        return;
+    }
+
+    std::FILE* converted = std::fopen("test_ribs_converted.csv", "wb");
+    reader.write_csv(converted);
+    std::fclose(converted);
+
+    std::ifstream a("test_ribs.csv", std::ios::binary), b("test_ribs_converted.csv", std::ios::binary);
+    std::ifstream c("test_ribs.bin", std::ios::binary), d("test_ribs_serial.bin", std::ios::binary);
+    std::stringstream expected, actual, threaded_bin, serial_bin;
+    expected << a.rdbuf();
+    actual << b.rdbuf();
+    threaded_bin << c.rdbuf();
+    serial_bin << d.rdbuf();
+
+    // Every stored path is distinct: no two table entries share (asn, parent)
+    std::unordered_map<uint64_t, uint32_t> seen;
+    bool duplicate_path = false;
+    for (uint32_t id = 1; id < reader.num_paths(); ++id) {
+        uint64_t key = (static_cast<uint64_t>(reader.path_parent(id)) << 32) | reader.path_asn(id);
+        duplicate_path |= !seen.emplace(key, id).second;
+    }
+
+    std::remove("test_ribs.csv");
+    std::remove("test_ribs.bin");
+    std::remove("test_ribs_serial.bin");
+    std::remove("test_ribs_converted.csv");
+
+    if (expected.str() != actual.str()) {
+        std::cerr << "FAILED: Binary RIB converts to different CSV" << std::endl;
+        return;
+    }
+    if (duplicate_path) {
+        std::cerr << "FAILED: Path table holds the same path twice" << std::endl;
+        return;
+    }
+    if (threaded_bin.str() != serial_bin.str()) {
+        std::cerr << "FAILED: Serial and threaded engines wrote different binary RIBs" << std::endl;
+        return;
+    }
+
+    std::cout << "PASSED: Binary RIB round-trips to identical CSV (" << reader.num_paths() << " paths for " << rows << " rows)" << std::endl;
+}
+
+/**
+ * Test 14: Incremental updates
+ * Applies announcements and withdrawals to converged RIBs and checks the result
+ * against a full run over the same final set of origins.
+ */
+void test_incremental_updates() {
+    std::cout << "\n=== Test: Incremental Announce/Withdraw ===" << std::endl;
+
+    ASGraph graph, expected_graph;
+    PropagationEngine engine(graph), expected_engine(expected_graph);
+    PrefixTable prefixes, expected_prefixes;
+    build_mixed_graph(graph, engine, prefixes);
+    build_mixed_graph(expected_graph, expected_engine, expected_prefixes);
+
+    // Withdraw the first origin found for 10.3.0.0/16
+    const uint32_t withdrawn = prefixes.intern("10.3.0.0/16");
+    uint32_t withdrawn_origin = 0;
+    for (uint32_t i = 0; i < graph.getNumNodes(); ++i) {
+        if (engine.local_rib(i).count(withdrawn)) {
+            withdrawn_origin = i;
+            break;
+        }
+    }
+
+    const uint32_t hijacked = prefixes.intern("10.0.0.0/16");
+    const uint32_t fresh = prefixes.intern("10.99.0.0/16");
+    expected_prefixes.intern("10.99.0.0/16");
+    const std::vector<RouteUpdate> updates = {
+        {RouteUpdate::ANNOUNCE, graph.getOrCreateNode(5)->index, hijacked, true},
+        {RouteUpdate::WITHDRAW, withdrawn_origin, withdrawn, false},
+        {RouteUpdate::ANNOUNCE, graph.getOrCreateNode(40)->index, fresh, false},
+        {RouteUpdate::ANNOUNCE, graph.getOrCreateNode(41)->index, fresh, false},
+    };
+
+    engine.run_propagation();
+    engine.apply_updates(updates, 2);
+
+    expected_engine.local_rib(withdrawn_origin).erase(withdrawn);
+    for (const RouteUpdate& update : updates) {
+        if (update.kind == RouteUpdate::ANNOUNCE) {
+            expected_engine.seed(update.index, update.prefix_id, update.rov_invalid);
+        }
+    }
+    expected_engine.run_propagation();
+
+    long compared = compare_ribs(expected_engine, engine);
+    if (compared < 0) {
+        std::cerr << "FAILED: Incremental updates differ from a full recompute" << std::endl;
+        return;
+    }
+
+    // Withdrawing every origin of a prefix removes it everywhere
+    std::vector<RouteUpdate> withdraw_all;
+    for (uint32_t i = 0; i < graph.getNumNodes(); ++i) {
+        auto it = engine.local_rib(i).find(fresh);
+        if (it != engine.local_rib(i).end() && it->second.received_from_relationship == Relationship::ORIGIN) {
+            withdraw_all.push_back({RouteUpdate::WITHDRAW, i, fresh, false});
+        }
+    }
+    engine.apply_updates(withdraw_all);
+    for (uint32_t i = 0; i < graph.getNumNodes(); ++i) {
+        if (engine.local_rib(i).count(fresh)) {
+            std::cerr << "FAILED: Withdrawn prefix still held by AS " << graph.node(i).asn << std::endl;
+            return;
+        }
+    }
+
+    // Replaced routes are reclaimed by compaction, so repeated updates stay bounded
+    auto rib_bytes = [&engine]() {
+        MemoryUsage usage;
+        engine.report_memory(usage);
+        for (const MemoryEntry& entry : usage) {
+            if (entry.name == "engine.local_ribs") return entry.bytes;
+        }
+        return uint64_t(0);
+    };
+    const uint64_t settled = rib_bytes();
+    const RouteUpdate flap = {RouteUpdate::ANNOUNCE, graph.getOrCreateNode(40)->index, fresh, false};
+    for (int round = 0; round < 500; ++round) {
+        engine.apply_updates({flap});
+        engine.apply_updates({{RouteUpdate::WITHDRAW, flap.index, fresh, false}});
+    }
+    if (rib_bytes() > 3 * settled) {
+        std::cerr << "FAILED: RIB memory grew across repeated updates (" << settled << " -> " << rib_bytes() << ")" << std::endl;
+        return;
+    }
+
+    std::cout << "PASSED: Incremental updates match a full recompute (" << compared << " routes)" << std::endl;
+}
+
+/**
+ * Test 15: ROV adoption scenario sweeps
+ * Checks that reset() replays a run exactly, that a scenario matches a plain
+ * run with the same ROV set, and that random trials are reproducible.
+ */
+void test_scenario_sweep() {
+    std::cout << "\n=== Test: ROV Adoption Scenario Sweep ===" << std::endl;
+
+    ASGraph graph;
+    PropagationEngine engine(graph);
+    PrefixTable prefixes;
+    build_mixed_graph(graph, engine, prefixes);
+
+    // Seeds only; the sweep engines copy them before this engine is run
+    ASGraph seeds_graph;
+    PropagationEngine seeds(seeds_graph);
+    PrefixTable seeds_prefixes;
+    build_mixed_graph(seeds_graph, seeds, seeds_prefixes);
+
+    Scenario tagged{graph.getPolicies().members(PolicyKind::ROV)};
+
+    engine.run_propagation();
+    uint64_t routes = 0, invalid_routes = 0;
+    for (uint32_t i = 0; i < graph.getNumNodes(); ++i) {
+        routes += engine.local_rib(i).size();
+        for (const auto& rib_entry : engine.local_rib(i)) invalid_routes += rib_entry.second.rov_invalid;
+    }
+
+    // A reset engine converges to the same RIBs again
+    ASGraph replay_graph;
+    PropagationEngine replay(replay_graph);
+    PrefixTable replay_prefixes;
+    build_mixed_graph(replay_graph, replay, replay_prefixes);
+    replay.run_propagation();
+    replay.reset();
+    replay.run_propagation();
+    if (compare_ribs(engine, replay) < 0) {
+        std::cerr << "FAILED: Propagation after reset() differs" << std::endl;
+        return;
+    }
+
+    std::vector<Scenario> scenarios = {Scenario{}, tagged};
+    std::vector<Scenario> random = random_scenarios(seeds_graph, 25.0, 42, 3);
+    scenarios.insert(scenarios.end(), random.begin(), random.end());
+    scenarios.push_back(tagged);
+
+    std::vector<ScenarioResult> results = run_scenarios(seeds_graph, seeds, scenarios, 3);
+    if (results[1].routes != routes || results[1].invalid_routes != invalid_routes ||
+        results[5].routes != routes || results[5].invalid_routes != invalid_routes) {
+        std::cerr << "FAILED: Scenario with the tagged ROV set differs from a plain run" << std::endl;
+        return;
+    }
+    if (results[0].invalid_routes < results[1].invalid_routes) {
+        std::cerr << "FAILED: ROV adoption should not let more invalid routes through" << std::endl;
+        return;
+    }
+
+    // Skipped lines keep the ids of later scenarios tied to their line numbers
+    {
+        std::ofstream out("test_scenarios.txt");
+        out << "# header\n-\n-5\n1, 2\n";
+    }
+    std::vector<Scenario> loaded;
+    if (!load_scenarios("test_scenarios.txt", seeds_graph, loaded) || loaded.size() != 2 ||
+        loaded[0].id != 2 || loaded[1].id != 4 || loaded[0].rov_adopters.count() != 0 ||
+        run_scenarios(seeds_graph, seeds, loaded, 2)[1].scenario != 4) {
+        std::cerr << "FAILED: Scenario file ids do not follow its line numbers" << std::endl;
+        return;
+    }
+    std::remove("test_scenarios.txt");
+
+    std::vector<Scenario> again = random_scenarios(seeds_graph, 25.0, 42, 3);
+    if (random[2].rov_adopters != again[2].rov_adopters || random[0].rov_adopters.count() != 15 ||
+        random[0].rov_adopters == random[1].rov_adopters) {
+        std::cerr << "FAILED: Random trials should be reproducible and distinct" << std::endl;
+        return;
+    }
+
+    std::cout << "PASSED: " << scenarios.size() << " scenarios match plain runs (" << routes << " routes)" << std::endl;
+}
+
+/**
+ * Test 16: Synthetic topology generator
+ * Generates a small CAIDA-style topology and checks the properties it promises:
+ * acyclic provider edges, a peered tier-1 clique, the stub share, determinism,
+ * an as-rel file that parses back to the same graph, and full reachability.
+ */
+void test_topology_generator() {
+    std::cout << "\n=== Test: Synthetic Topology Generator ===" << std::endl;
+
+    TopologyConfig config;
+    config.num_ases = 3000;
+    config.tier1 = 8;
+    config.depth = 6;
+    config.seed = 7;
+    SyntheticTopology topology = generate_topology(config);
+    SyntheticTopology again = generate_topology(config);
+    if (topology.provider_edges != again.provider_edges || topology.peer_edges != again.peer_edges ||
+        topology.asns != again.asns) {
+        std::cerr << "FAILED: Same seed should give the same topology" << std::endl;
+        return;
+    }
+
+    std::vector<uint32_t> customers(config.num_ases, 0), providers(config.num_ases, 0);
+    for (const auto& [provider, customer] : topology.provider_edges) {
+        if (topology.level[provider] >= topology.level[customer]) {
+            std::cerr << "FAILED: Provider edge does not point down a level" << std::endl;
+            return;
+        }
+        customers[provider]++;
+        providers[customer]++;
+    }
+    size_t stubs = std::count(customers.begin(), customers.end(), 0u);
+    bool tier1_free = true, everyone_has_provider = true;
+    for (uint32_t i = 0; i < config.num_ases; ++i) {
+        if (topology.level[i] == 0) tier1_free &= providers[i] == 0;
+        else everyone_has_provider &= providers[i] > 0;
+    }
+    if (!tier1_free || !everyone_has_provider || stubs < config.num_ases * config.stub_fraction) {
+        std::cerr << "FAILED: Tier-1s need no providers, others at least one, and most ASes should be stubs" << std::endl;
+        return;
+    }
+
+    ASGraph graph;
+    build_graph(topology, graph);
+    graph.freeze();
+    if (graph.detectProviderCycles()) {
+        std::cerr << "FAILED: Generated topology has a provider cycle" << std::endl;
+        return;
+    }
+    for (uint32_t a = 0; a < config.tier1; ++a) {
+        if (graph.peers(graph.findNode(topology.asns[a])->index).size() < config.tier1 - 1) {
+            std::cerr << "FAILED: Tier-1 clique is not fully peered" << std::endl;
+            return;
+        }
+    }
+
+    write_as_rel(topology, config, "test_synthetic.as-rel.txt");
+    ASGraph parsed;
+    CaidaMetadata metadata;
+    parse_caida("test_synthetic.as-rel.txt", parsed, &metadata);
+    parsed.freeze();
+    std::remove("test_synthetic.as-rel.txt");
+    if (parsed.getNumNodes() != graph.getNumNodes() || parsed.getNumProviderEdges() != graph.getNumProviderEdges() ||
+        parsed.getNumPeerEdges() != graph.getNumPeerEdges() || metadata.comments.size() != 3) {
+        std::cerr << "FAILED: as-rel output does not parse back to the same graph" << std::endl;
+        return;
+    }
+
+    // Without ROV every AS can reach every prefix
+    PropagationEngine engine(graph);
+    engine.set_verbose(false);
+    for (uint32_t p = 0; p < 3; ++p) {
+        engine.seed(graph.findNode(topology.asns[config.num_ases - 1 - p * 500])->index, p, false);
+    }
+    engine.run_propagation();
+    for (uint32_t i = 0; i < graph.getNumNodes(); ++i) {
+        if (engine.local_rib(i).size() != 3) {
+            std::cerr << "FAILED: AS " << graph.node(i).asn << " is missing routes" << std::endl;
+            return;
+        }
+    }
+
+    std::cout << "PASSED: " << config.num_ases << " ASes, " << topology.provider_edges.size() << " provider and "
+              << topology.peer_edges.size() << " peer links, " << stubs << " stubs, acyclic and fully reachable" << std::endl;
+}
+
+/**
+ * Test 17: Run instrumentation
+ * Checks that the engine counters add up to the RIBs it produced, that the
+ * parallel engine counts the same adoptions, and that the JSON is written.
+ */
+void test_run_stats() {
+    std::cout << "\n=== Test: Run Instrumentation ===" << std::endl;
+
+    ASGraph serial_graph, parallel_graph;
+    PropagationEngine serial_engine(serial_graph), parallel_engine(parallel_graph);
+    PrefixTable serial_prefixes, parallel_prefixes;
+    build_mixed_graph(serial_graph, serial_engine, serial_prefixes);
+    build_mixed_graph(parallel_graph, parallel_engine, parallel_prefixes);
+
+    RunStats serial, parallel;
+    serial_engine.set_stats(&serial);
+    parallel_engine.set_stats(&parallel);
+    serial_engine.run_propagation();
+    parallel_engine.run_propagation(3);
+    serial.record_ribs(serial_engine);
+
+    uint64_t origins = 0;
+    for (uint32_t i = 0; i < serial_graph.getNumNodes(); ++i) {
+        for (const auto& rib_entry : serial_engine.local_rib(i)) {
+            origins += rib_entry.second.received_from_relationship == Relationship::ORIGIN;
+        }
+    }
+    const uint64_t adopted = serial.up.adopted + serial.across.adopted + serial.down.adopted;
+    const size_t ranks = serial_graph.getRankedASes().size();
+    if (adopted + origins != serial.rib_entries || serial.up_ranks.size() != ranks || serial.down_ranks.size() != ranks) {
+        std::cerr << "FAILED: Counters do not add up to the RIBs (" << adopted << " adopted + " << origins
+                  << " origins vs " << serial.rib_entries << " entries)" << std::endl;
+        return;
+    }
+    if (serial.up.dropped + serial.down.dropped == 0 || serial.down.sent < serial.down.adopted ||
+        serial.rib_top.empty() || serial.rib_top[0].second != serial.rib_max) {
+        std::cerr << "FAILED: Expected ROV drops, more offers than adoptions and a largest RIB" << std::endl;
+        return;
+    }
+    if (parallel.up.adopted != serial.up.adopted || parallel.across.adopted != serial.across.adopted ||
+        parallel.down.adopted != serial.down.adopted || parallel.down.dropped != serial.down.dropped) {
+        std::cerr << "FAILED: Parallel engine counts differ from serial" << std::endl;
+        return;
+    }
+    if (parallel.up_ranks.size() != ranks || parallel.down_ranks.size() != ranks ||
+        parallel.up_ranks.front().rank != 0 || parallel.down_ranks.front().rank != serial.down_ranks.front().rank) {
+        std::cerr << "FAILED: Parallel engine does not time every rank" << std::endl;
+        return;
+    }
+
+    serial.begin_step("propagation");
+    serial.end_step();
+    if (!serial.write_json("test_stats.json")) {
+        std::cerr << "FAILED: Could not write stats JSON" << std::endl;
+        return;
+    }
+    std::ifstream in("test_stats.json");
+    std::stringstream json;
+    json << in.rdbuf();
+    std::remove("test_stats.json");
+    if (json.str().find("\"name\": \"propagation\"") == std::string::npos ||
+        json.str().find("\"adopted\": " + std::to_string(serial.down.adopted)) == std::string::npos) {
+        std::cerr << "FAILED: Stats JSON is missing steps or counters" << std::endl;
+        return;
+    }
+
+    std::cout << "PASSED: " << adopted << " adoptions + " << origins << " origins = " << serial.rib_entries
+              << " RIB entries, parallel counts match" << std::endl;
+}
+
+/**
+ * Test 18: Memory report
+ * The per-structure accounting must count the items actually stored, and
+ * step sampling must see a resident set.
+ */
+void test_memory_report() {
+    std::cout << "\n=== Test: Memory Report ===" << std::endl;
+
+    ASGraph graph;
+    PropagationEngine engine(graph);
+    PrefixTable prefixes;
+    build_mixed_graph(graph, engine, prefixes);
+    engine.set_verbose(false);
+
+    RunStats stats;
+    stats.begin_step("propagation");
+    engine.run_propagation();
+    stats.end_step();
+    stats.record_memory(engine, &prefixes);
+
+    uint64_t routes = 0;
+    for (uint32_t i = 0; i < graph.getNumNodes(); ++i) routes += engine.local_rib(i).size();
+
+    std::unordered_map<std::string, MemoryEntry> entries;
+    for (const MemoryEntry& entry : stats.memory) entries[entry.name] = entry;
+    if (entries["engine.local_ribs"].items != routes || entries["engine.path_tree"].items != engine.paths().size() ||
+        entries["graph.nodes"].items != graph.getNumNodes() || entries["prefixes.text"].items != prefixes.size()) {
+        std::cerr << "FAILED: Memory entries do not count the stored items" << std::endl;
+        return;
+    }
+    // Every route costs at least its Announcement, and every path one tree node
+    if (entries["engine.local_ribs"].bytes < routes * sizeof(Announcement) ||
+        entries["engine.path_tree"].bytes < engine.paths().size() * 8 || entries["graph.adjacency"].bytes == 0) {
+        std::cerr << "FAILED: Memory entries undercount their structures" << std::endl;
+        return;
+    }
+    if (stats.steps.size() != 1 || stats.steps[0].rss_bytes == 0 || stats.steps[0].peak_rss_bytes < stats.steps[0].rss_bytes) {
+        std::cerr << "FAILED: Step did not sample RSS" << std::endl;
+        return;
+    }
+
+    std::ostringstream report;
+    stats.print_memory_report(report);
+    if (report.str().find("engine.local_ribs") == std::string::npos || report.str().find("total accounted") == std::string::npos) {
+        std::cerr << "FAILED: Report is missing the structure breakdown" << std::endl;
+        return;
+    }
+
+    std::cout << "PASSED: " << stats.memory.size() << " structures, " << entries["engine.local_ribs"].bytes
+              << " bytes for " << routes << " routes" << std::endl;
+}
+
+/**
+ * Test 19: Packed route record
+ * Announcement is a 16-byte trivially copyable record with a 16-bit path
+ * length; a graph too deep for that length must be refused, not wrapped.
+ */
+void test_packed_announcement() {
+    std::cout << "\n=== Test: Packed Route Record ===" << std::endl;
+
+    Announcement ann(7, ASPathTree::EMPTY, 3, 65001, Relationship::PEER, true);
+    Announcement copy;
+    std::memcpy(&copy, &ann, sizeof(Announcement));
+    if (sizeof(Announcement) != 16 || copy.prefix_id != 7 || copy.path_length != 3 || copy.next_hop_asn != 65001 ||
+        copy.received_from_relationship != Relationship::PEER || !copy.rov_invalid) {
+        std::cerr << "FAILED: Announcement does not round-trip as a 16-byte record" << std::endl;
+        return;
+    }
+
+    // 2 * 32767 + 2 hops no longer fit in path_length
+    ASGraph graph;
+    for (uint32_t asn = 1; asn < 32769; ++asn) {
+        graph.addRelationship(asn + 1, asn, -1);
+    }
+    PropagationEngine engine(graph);
+    engine.set_verbose(false);
+    engine.seed(graph.getOrCreateNode(1)->index, 0, false);
+    bool refused = false;
+    try {
+        engine.run_propagation();
+    } catch (const std::length_error&) {
+        refused = true;
+    }
+    if (!refused) {
+        std::cerr << "FAILED: Propagation should refuse paths longer than 16 bits" << std::endl;
+        return;
+    }
+
+    std::cout << "PASSED: 16-byte Announcement, over-deep graph refused" << std::endl;
+}
+
+/**
+ * Test 20: Packed preference key
+ * Ordering routes by preference_key() must give exactly the rule-by-rule
+ * result (relationship, then path length, then next hop ASN), ties included.
+ */
+void test_preference_key() {
+    std::cout << "\n=== Test: Preference Key Matches Selection Rules ===" << std::endl;
+
+    const Relationship rels[] = {Relationship::PROVIDER, Relationship::PEER, Relationship::CUSTOMER, Relationship::ORIGIN};
+    const int scores[] = {0, 1, 2, 3};
+    const uint32_t lengths[] = {1, 2, 3, 17, MAX_PATH_LENGTH - 1, MAX_PATH_LENGTH};
+    const uint32_t next_hops[] = {0, 1, 2, 64512, 4200000000u, UINT32_MAX};
+
+    std::vector<Announcement> routes;
+    std::vector<int> score_of;
+    for (int r = 0; r < 4; ++r) {
+        for (uint32_t length : lengths) {
+            for (uint32_t next_hop : next_hops) {
+                routes.emplace_back(0, ASPathTree::EMPTY, static_cast<uint16_t>(length), next_hop, rels[r]);
+                score_of.push_back(scores[r]);
+            }
+        }
+    }
+
+    size_t pairs = 0;
+    for (size_t a = 0; a < routes.size(); ++a) {
+        const Announcement& x = routes[a];
+        if (x.preference() == NO_ROUTE_KEY || key_relationship(x.preference()) != x.received_from_relationship ||
+            key_path_length(x.preference()) != x.path_length) {
+            std::cerr << "FAILED: Key does not decode back to its route" << std::endl;
+            return;
+        }
+        for (size_t b = 0; b < routes.size(); ++b, ++pairs) {
+            const Announcement& y = routes[b];
+            bool better;
+            if (score_of[a] != score_of[b]) better = score_of[a] > score_of[b];
+            else if (x.path_length != y.path_length) better = x.path_length < y.path_length;
+            else better = x.next_hop_asn < y.next_hop_asn;
+
+            if ((x.preference() > y.preference()) != better) {
+                std::cerr << "FAILED: Key order differs from the selection rules" << std::endl;
+                return;
+            }
+        }
+    }
+
+    std::cout << "PASSED: " << pairs << " route pairs ordered identically" << std::endl;
+}
+
+/**
+ * Test 21: Route arenas
+ * Arenas hand their blocks back to the shared pool for reuse, and an engine
+ * that is reset and run again (serially or in parallel) reuses its route
+ * memory and reproduces the same RIBs.
+ */
+void test_route_arenas() {
+    std::cout << "\n=== Test: Route Arenas ===" << std::endl;
+
+    BlockPool pool;
+    {
+        Arena arena(pool);
+        for (int i = 0; i < 100000; ++i) (void)arena.allocate(24, 8);
+        const uint64_t reserved = arena.bytes_reserved();
+        arena.reset();
+        for (int i = 0; i < 100000; ++i) (void)arena.allocate(24, 8);
+        if (reserved < 100000 * 24 || arena.bytes_reserved() != reserved || pool.bytes_reserved() != reserved) {
+            std::cerr << "FAILED: Reset arena did not refill its own blocks" << std::endl;
+            return;
+        }
+        arena.release();
+        Arena other(pool);
+        (void)other.allocate(BlockPool::BLOCK_SIZE / 8, 64);
+        if (pool.bytes_reserved() != reserved || pool.bytes_spare() != reserved - BlockPool::BLOCK_SIZE) {
+            std::cerr << "FAILED: Released blocks were not reused" << std::endl;
+            return;
+        }
+        pool.trim(0);
+        if (pool.bytes_reserved() != BlockPool::BLOCK_SIZE || pool.bytes_spare() != 0) {
+            std::cerr << "FAILED: trim() did not free the spare blocks" << std::endl;
+            return;
+        }
+    }
+
+    // A scope only selects the writer of the sets it names, so a second set
+    // used on the same thread (another engine) keeps writing as writer 0
+    ArenaSet writers(pool), other_writers(pool);
+    writers.set_num_writers(2);
+    other_writers.set_num_writers(2);
+    {
+        ArenaSet::WriterScope scope({&writers}, 1);
+        PendingRoutes scratch(&writers);
+        scratch[1] = Announcement();
+        PendingRoutes other_scratch(&other_writers);
+        other_scratch[1] = Announcement();
+    }
+    other_writers.reset(0);
+    if (writers.num_writers() != 2 || writers.bytes_reserved() != BlockPool::BLOCK_SIZE ||
+        other_writers.bytes_reserved() != BlockPool::BLOCK_SIZE) {
+        std::cerr << "FAILED: Writer scope did not select its arena" << std::endl;
+        return;
+    }
+    other_writers.release();
+    if (other_writers.bytes_reserved() != 0) {
+        std::cerr << "FAILED: release() kept blocks" << std::endl;
+        return;
+    }
+
+    ASGraph reference_graph, graph;
+    PropagationEngine reference(reference_graph), engine(graph);
+    PrefixTable reference_prefixes, prefixes;
+    build_mixed_graph(reference_graph, reference, reference_prefixes);
+    build_mixed_graph(graph, engine, prefixes);
+    reference.set_verbose(false);
+    engine.set_verbose(false);
+    reference.run_propagation();
+
+    auto route_bytes = [&engine]() {
+        MemoryUsage usage;
+        engine.report_memory(usage);
+        uint64_t bytes = 0;
+        for (const MemoryEntry& entry : usage) {
+            if (entry.name != "engine.path_tree" && entry.name != "engine.filter_sets") bytes += entry.bytes;
+        }
+        return bytes;
+    };
+
+    // Alternate serial and 3-thread runs. Once both have run, every writer and rank
+    // arena holds the blocks it needs and further runs must not grow the memory
+    uint64_t warmed_up = 0;
+    long compared = 0;
+    for (int run = 0; run < 6; ++run) {
+        if (run > 0) engine.reset();
+        engine.run_propagation(run % 2 ? 3 : 1);
+        compared = compare_ribs(reference, engine);
+        if (compared < 0) {
+            std::cerr << "FAILED: Run " << run + 1 << " differs from the reference" << std::endl;
+            return;
+        }
+        if (run == 2) warmed_up = route_bytes();
+    }
+    if (route_bytes() > warmed_up) {
+        std::cerr << "FAILED: Route memory grew across reset runs (" << warmed_up << " -> " << route_bytes() << ")" << std::endl;
+        return;
+    }
+
+    std::cout << "PASSED: " << compared << " routes reproduced in " << warmed_up << " bytes of route memory" << std::endl;
+}
+
+/**
+ * Test 22: Input loader
+ * anns.csv and ROV files parsed in parallel chunks give the same nodes,
+ * prefix ids and seeds as a single thread, with the header, CRLF endings,
+ * padded fields and malformed lines handled as the line-by-line reader did.
+ */
+void test_input_loader() {
+    std::cout << "\n=== Test: Input Loader ===" << std::endl;
+
+    // Rejected rows intern nothing, so 2001:db8::/32 is id 0
+    size_t expected_seeded = 0;
+    {
+        std::ofstream out("test_anns.csv", std::ios::binary);
+        out << "seed_asn,prefix,rov_invalid\r\n"
+            << "abc,192.0.2.0/24,False\r\n"
+            << " 7 , 2001:db8::/32 , True \r\n"
+            << "\n"
+            << "8,not-a-prefix,False\n"
+            << "9,198.51.100.0/24\n"
+            << "10,198.51.100.0/24,\n"
+            << "11,198.51.100.0/24,1,extra\n";
+        expected_seeded += 2;
+        // Enough rows for several parse chunks per thread
+        for (int i = 0; i < 20000; ++i) {
+            out << 1 + (i * 7) % 1000 << ",10." << i / 256 % 256 << '.' << i % 256 << ".0/24,"
+                << (i % 3 == 0 ? "true" : "False") << (i % 2 ? "\r\n" : "\n");
+            expected_seeded++;
+        }
+        out << "12,203.0.113.0/24,False";  // No trailing newline
+        expected_seeded++;
+    }
+    {
+        std::ofstream out("test_rov_header.csv", std::ios::binary);
+        out << "asn\r\n 12 \r\n\nx\n13";
+    }
+    {
+        std::ofstream out("test_rov_plain.csv", std::ios::binary);
+        out << "7\n8\n";
+    }
+
+    ASGraph graphs[2];
+    PropagationEngine engines[2] = {PropagationEngine(graphs[0]), PropagationEngine(graphs[1])};
+    PrefixTable prefixes[2];
+    const size_t threads[2] = {1, 3};
+    for (int g = 0; g < 2; ++g) {
+        size_t seeded = 0;
+        if (!load_announcements("test_anns.csv", graphs[g], engines[g], prefixes[g], threads[g], seeded) ||
+            seeded != expected_seeded) {
+            std::cerr << "FAILED: " << threads[g] << " thread(s) seeded " << seeded << " of " << expected_seeded << std::endl;
+            return;
+        }
+    }
+
+    if (prefixes[0].size() != 20003 || prefixes[0].to_string(0) != "2001:db8::/32" || prefixes[0].to_string(1) != "198.51.100.0/24" ||
+        graphs[0].node(0).asn != 7 || graphs[0].node(1).asn != 11) {
+        std::cerr << "FAILED: Prefix ids or node order do not follow the file" << std::endl;
+        return;
+    }
+    const uint32_t v6 = graphs[0].findNode(7)->index;
+    if (!engines[0].local_rib(v6).at(0).rov_invalid || !engines[0].local_rib(graphs[0].findNode(11)->index).at(1).rov_invalid) {
+        std::cerr << "FAILED: rov_invalid flags not parsed" << std::endl;
+        return;
+    }
+
+    if (graphs[1].getNumNodes() != graphs[0].getNumNodes() || prefixes[1].size() != prefixes[0].size()) {
+        std::cerr << "FAILED: Parallel load created different nodes or prefixes" << std::endl;
+        return;
+    }
+    for (uint32_t id = 0; id < prefixes[0].size(); ++id) {
+        if (prefixes[1].to_string(id) != prefixes[0].to_string(id)) {
+            std::cerr << "FAILED: Prefix " << id << " differs after parallel load" << std::endl;
+            return;
+        }
+    }
+    for (uint32_t i = 0; i < graphs[0].getNumNodes(); ++i) {
+        const LocalRib& a = engines[0].local_rib(i);
+        const LocalRib& b = engines[1].local_rib(i);
+        bool same = graphs[1].node(i).asn == graphs[0].node(i).asn && a.size() == b.size();
+        for (const auto& [prefix, ann] : a) {
+            auto it = b.find(prefix);
+            same = same && it != b.end() && it->second.rov_invalid == ann.rov_invalid;
+        }
+        if (!same) {
+            std::cerr << "FAILED: Seeds at node " << i << " differ after parallel load" << std::endl;
+            return;
+        }
+    }
+
+    ASGraph rov_graph;
+    if (!load_rov_asns("test_rov_header.csv", rov_graph, 3) || !load_rov_asns("test_rov_plain.csv", rov_graph, 1) ||
+        rov_graph.getPolicies().members(PolicyKind::ROV).count() != 4 ||
+        rov_graph.getPolicy(rov_graph.findNode(13)->index) != PolicyKind::ROV ||
+        rov_graph.getPolicy(rov_graph.findNode(7)->index) != PolicyKind::ROV) {
+        std::cerr << "FAILED: ROV ASNs not loaded" << std::endl;
+        return;
+    }
+
+    ASGraph missing_graph;
+    if (load_rov_asns("test_missing_rov.csv", missing_graph, 1)) {
+        std::cerr << "FAILED: Missing file was not reported" << std::endl;
+        return;
+    }
+
+    std::remove("test_anns.csv");
+    std::remove("test_rov_header.csv");
+    std::remove("test_rov_plain.csv");
+
+    std::cout << "PASSED: " << expected_seeded << " announcements and 4 ROV ASNs loaded identically on 1 and 3 threads" << std::endl;
+}
+
+// Connects to a Unix socket, retrying while the server is still starting up
+int connect_query_socket(const std::string& path) {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    for (int attempt = 0; attempt < 200; ++attempt) {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) return fd;
+        ::close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return -1;
+}
+
+// Sends all requests in one write and reads `count` replies (header line plus its rows)
+std::vector<std::vector<std::string>> query_socket(int fd, const std::string& requests, size_t count) {
+    (void)!::write(fd, requests.data(), requests.size());
+    std::vector<std::vector<std::string>> replies;
+    std::string buffer;
+    size_t rows_left = 0;
+    char chunk[4096];
+    while (replies.size() < count || rows_left > 0) {
+        size_t nl = buffer.find('\n');
+        if (nl == std::string::npos) {
+            const ssize_t got = ::read(fd, chunk, sizeof(chunk));
+            if (got <= 0) break;
+            buffer.append(chunk, static_cast<size_t>(got));
+            continue;
+        }
+        const std::string line = buffer.substr(0, nl);
+        buffer.erase(0, nl + 1);
+        if (rows_left > 0) {
+            replies.back().push_back(line);
+            rows_left--;
+        } else {
+            replies.push_back({line});
+            if (line.compare(0, 3, "OK ") == 0) rows_left = std::stoul(line.substr(3));
+        }
+    }
+    return replies;
+}
+
+// The ribs.csv row the server should print for this route
+std::string expected_row(const PropagationEngine& engine, const PrefixTable& prefixes, uint32_t asn, const Announcement& ann) {
+    std::string row = std::to_string(asn) + "," + prefixes.to_string(ann.prefix_id) + ",\"(";
+    const std::vector<uint32_t> path = engine.paths().to_vector(ann.as_path);
+    for (size_t i = 0; i < path.size(); ++i) {
+        row += std::to_string(path[i]) + (i + 1 < path.size() ? ", " : path.size() == 1 ? "," : "");
+    }
+    return row + ")\"";
+}
+
+/**
+ * Test 23: Query server
+ * Requests pipelined over the Unix socket are answered in order with the
+ * converged routes, two clients can query at once, scenarios match a fresh
+ * engine run with the same overrides, and SHUTDOWN stops the server.
+ */
+void test_query_server() {
+    std::cout << "\n=== Test: Query Server ===" << std::endl;
+
+    ASGraph graph;
+    PropagationEngine engine(graph);
+    PrefixTable prefixes;
+    build_mixed_graph(graph, engine, prefixes);
+    engine.set_verbose(false);
+    engine.run_propagation();
+
+    // Expected answers: one ROUTE per RIB entry of every fourth AS, plus a RIB dump
+    std::string requests = "PING\n";
+    std::vector<std::string> expected;
+    for (const ASNode& node : graph.getNodes()) {
+        if (node.index % 4) continue;
+        for (const auto& [prefix, ann] : engine.local_rib(node.index)) {
+            requests += "ROUTE " + std::to_string(node.asn) + " " + prefixes.to_string(prefix) + "\n";
+            expected.push_back(expected_row(engine, prefixes, node.asn, ann));
+        }
+    }
+    const uint32_t dumped = graph.getNodes().back().asn;
+    requests += "ROUTE " + std::to_string(dumped) + " 192.0.2.0/24\nRIB " + std::to_string(dumped) + "\nROUTE 12345678 10.0.0.0/16\n";
+
+    // Hijack of 10.0.0.0/16 plus a brand-new prefix, checked against a fresh engine
+    ASGraph hijack_graph;
+    PropagationEngine hijack(hijack_graph);
+    PrefixTable hijack_prefixes;
+    build_mixed_graph(hijack_graph, hijack, hijack_prefixes);
+    hijack.set_verbose(false);
+    hijack.seed(hijack_graph.findNode(5)->index, hijack_prefixes.intern("10.0.0.0/16"), true);
+    hijack.seed(hijack_graph.findNode(9)->index, hijack_prefixes.intern("203.0.113.0/24"), false);
+    hijack.run_propagation();
+    size_t hijack_routes = 0;
+    for (const ASNode& node : hijack_graph.getNodes()) hijack_routes += hijack.local_rib(node.index).size();
+    const Announcement& hijacked = hijack.local_rib(hijack_graph.findNode(1)->index).at(hijack_prefixes.intern("10.0.0.0/16"));
+    requests += "SCENARIO ann=5,10.0.0.0/16,True ann=9,203.0.113.0/24,False route=1,10.0.0.0/16\n";
+
+    size_t base_routes = 0;
+    for (const ASNode& node : graph.getNodes()) base_routes += engine.local_rib(node.index).size();
+    requests += "SCENARIO\nFOO\n";
+
+    QueryServer server(graph, engine, prefixes, 2);
+    const std::string socket_path = "test_query.sock";
+
+    // A path that is not a socket is refused and left in place
+    {
+        std::ofstream out("test_query_not_socket.csv");
+        out << "asn\n";
+    }
+    if (server.serve("test_query_not_socket.csv") || ::access("test_query_not_socket.csv", F_OK) != 0) {
+        std::cerr << "FAILED: serve() replaced a regular file" << std::endl;
+        return;
+    }
+    std::remove("test_query_not_socket.csv");
+
+    std::thread server_thread([&]() { server.serve(socket_path); });
+
+    // A second client queries concurrently with the main one
+    bool concurrent_ok = false;
+    std::thread other([&]() {
+        const int fd = connect_query_socket(socket_path);
+        std::string pings;
+        for (int i = 0; i < 200; ++i) pings += "PING\n";
+        const auto replies = query_socket(fd, pings, 200);
+        concurrent_ok = replies.size() == 200 && replies.back()[0] == "OK 0";
+        ::close(fd);
+    });
+
+    const int fd = connect_query_socket(socket_path);
+    const auto replies = query_socket(fd, requests, expected.size() + 7);
+    other.join();
+
+    bool routes_ok = fd >= 0 && replies.size() == expected.size() + 7 && replies[0][0] == "OK 0";
+    for (size_t i = 0; routes_ok && i < expected.size(); ++i) {
+        routes_ok = replies[i + 1].size() == 2 && replies[i + 1][1] == expected[i];
+    }
+    if (!routes_ok || !concurrent_ok) {
+        std::cerr << "FAILED: Pipelined ROUTE replies do not match the RIBs" << std::endl;
+        server.stop();
+        server_thread.join();
+        return;
+    }
+
+    const size_t at = expected.size() + 1;
+    const LocalRib& dumped_rib = engine.local_rib(graph.findNode(dumped)->index);
+    if (replies[at][0] != "OK 0" || replies[at + 1].size() != dumped_rib.size() + 1 ||
+        replies[at + 2][0] != "ERR unknown AS 12345678") {
+        std::cerr << "FAILED: Missing route, RIB dump or unknown AS answered wrongly" << std::endl;
+        server.stop();
+        server_thread.join();
+        return;
+    }
+
+    const std::vector<std::string>& scenario = replies[at + 3];
+    if (scenario.size() != 3 || scenario[1].find("routes=" + std::to_string(hijack_routes) + " ") != 0 ||
+        scenario[2] != expected_row(hijack, hijack_prefixes, 1, hijacked) ||
+        replies[at + 4][1].find("routes=" + std::to_string(base_routes) + " ") != 0 ||
+        replies[at + 5][0] != "ERR unknown command FOO") {
+        std::cerr << "FAILED: Scenario replies do not match a fresh run" << std::endl;
+        server.stop();
+        server_thread.join();
+        return;
+    }
+
+    const auto shutdown = query_socket(fd, "SHUTDOWN\n", 1);
+    server_thread.join();
+    ::close(fd);
+    if (shutdown.size() != 1 || shutdown[0][0] != "OK 0" || ::access(socket_path.c_str(), F_OK) == 0) {
+        std::cerr << "FAILED: SHUTDOWN did not stop the server and remove the socket" << std::endl;
+        return;
+    }
+
+    std::cout << "PASSED: " << expected.size() << " pipelined routes, a RIB dump and 2 scenarios answered over the socket" << std::endl;
+}
+
+/**
+ * Test 24: Longest-prefix-match index
+ * match() agrees with a linear scan over nested IPv4/IPv6 prefixes, the
+ * parent chain lists every covering prefix, and per-AS lookups (engine RIBs,
+ * ribs.bin route arrays and the server's LOOKUP) fall back to a less
+ * specific prefix when the AS dropped the more specific one.
+ */
+void test_lpm_index() {
+    std::cout << "\n=== Test: Longest-Prefix-Match Index ===" << std::endl;
+
+    auto covers = [](const Prefix& prefix, const Prefix& address) {
+        if (prefix.is_ipv6 != address.is_ipv6) return false;
+        for (int bit = 0; bit < prefix.length; ++bit) {
+            if ((prefix.addr[bit / 8] ^ address.addr[bit / 8]) >> (7 - bit % 8) & 1) return false;
+        }
+        return true;
+    };
+
+    // Clustered random prefixes of every length, plus both default routes
+    uint64_t state = 99;
+    auto next = [&state]() { state = state * 6364136223846793005ULL + 1442695040888963407ULL; return static_cast<uint32_t>(state >> 33); };
+    std::vector<Prefix> prefixes(2);
+    prefixes[1].is_ipv6 = true;
+    for (int i = 0; i < 1500; ++i) {
+        Prefix prefix;
+        prefix.is_ipv6 = i % 3 == 0;
+        prefix.length = static_cast<uint8_t>(next() % ((prefix.is_ipv6 ? 128 : 32) + 1));
+        for (int b = 0; b < (prefix.is_ipv6 ? 16 : 4); ++b) prefix.addr[b] = static_cast<uint8_t>(b == 0 ? next() % 4 : next());
+        prefixes.push_back(prefix);
+    }
+    const LpmIndex index(prefixes);
+
+    for (int q = 0; q < 20000; ++q) {
+        Prefix address = prefixes[2 + next() % (prefixes.size() - 2)];
+        for (int b = 0; b < (address.is_ipv6 ? 16 : 4); ++b) {
+            if (next() % 3 == 0) address.addr[b] ^= static_cast<uint8_t>(1 << next() % 8);
+        }
+        size_t best = 0;
+        for (uint32_t id = 0; id < prefixes.size(); ++id) {
+            if (covers(prefixes[id], address) && prefixes[id].length >= prefixes[best].length) best = id;
+        }
+        uint32_t id = index.match(address);
+        if (id == LpmIndex::NO_MATCH || prefixes[id].length != prefixes[best].length || !covers(prefixes[id], address)) {
+            std::cerr << "FAILED: Query " << q << " matched the wrong prefix" << std::endl;
+            return;
+        }
+        size_t covering = 0;
+        for (const Prefix& prefix : prefixes) covering += covers(prefix, address);
+        size_t chain_length = 0;
+        for (; id != LpmIndex::NO_MATCH; id = index.parent(id)) chain_length += covers(prefixes[id], address);
+        if (chain_length != covering) {
+            std::cerr << "FAILED: Parent chain of query " << q << " misses a covering prefix" << std::endl;
+            return;
+        }
+    }
+
+    // AS 1 (ROV) drops its customer's invalid 10.1.0.0/16 and keeps only 10.0.0.0/8
+    ASGraph graph;
+    PropagationEngine engine(graph);
+    PrefixTable table;
+    graph.addRelationship(1, 2, -1);
+    graph.addRelationship(2, 3, -1);
+    graph.setPolicy(graph.getOrCreateNode(1)->index, PolicyKind::ROV);
+    engine.seed(graph.findNode(1)->index, table.intern("10.0.0.0/8"), false);
+    engine.seed(graph.findNode(2)->index, table.intern("10.1.0.0/16"), true);
+    engine.seed(graph.findNode(3)->index, table.intern("2001:db8::/32"), false);
+    engine.set_verbose(false);
+    engine.run_propagation();
+
+    const LpmIndex rib_index(table);
+    Prefix inside, outside, v6;
+    parse_prefix("10.1.2.3", inside);
+    parse_prefix("192.0.2.1", outside);
+    parse_prefix("2001:db8::1", v6);
+    const Announcement* as1 = lookup_route(rib_index, engine.local_rib(graph.findNode(1)->index), inside);
+    const Announcement* as3 = lookup_route(rib_index, engine.local_rib(graph.findNode(3)->index), inside);
+    if (!as1 || as1->prefix_id != 0 || !as3 || as3->prefix_id != 1 ||
+        lookup_route(rib_index, engine.local_rib(0), outside) ||
+        !lookup_route(rib_index, engine.local_rib(graph.findNode(1)->index), v6)) {
+        std::cerr << "FAILED: Per-AS lookup did not fall back to the covering route" << std::endl;
+        return;
+    }
+
+    write_ribs_binary(engine, table, "test_lpm.bin");
+    RibBinaryReader reader;
+    RibRouteArrays routes;
+    if (!reader.open("test_lpm.bin")) {
+        std::cerr << "FAILED: Could not read test_lpm.bin" << std::endl;
+        return;
+    }
+    routes.build(reader);
+    for (uint32_t asn = 1; asn <= 3; ++asn) {
+        const size_t slot = routes.find_as(asn);
+        for (const Prefix* address : {&inside, &outside, &v6}) {
+            const Announcement* expected = lookup_route(rib_index, engine.local_rib(graph.findNode(asn)->index), *address);
+            const uint32_t id = rib_index.match(*address, [&](uint32_t prefix_id) {
+                return routes.path_of(slot, prefix_id) != RibRouteArrays::NO_ROUTE;
+            });
+            if ((expected ? expected->prefix_id : LpmIndex::NO_MATCH) != id) {
+                std::cerr << "FAILED: ribs.bin route arrays disagree with the RIB for AS " << asn << std::endl;
+                return;
+            }
+        }
+    }
+    std::remove("test_lpm.bin");
+
+    QueryServer server(graph, engine, table);
+    std::string reply;
+    server.handle("LOOKUP 1 10.1.2.3", reply);
+    server.handle("LOOKUP 3 10.1.2.3", reply);
+    server.handle("LOOKUP 3 192.0.2.1", reply);
+    if (reply != "OK 1\n1,10.0.0.0/8,\"(1,)\"\nOK 1\n3,10.1.0.0/16,\"(3, 2)\"\nOK 0\n") {
+        std::cerr << "FAILED: LOOKUP replies are wrong:\n" << reply << std::endl;
+        return;
+    }
+
+    std::cout << "PASSED: " << prefixes.size() << " prefixes in " << index.num_nodes() << " trie nodes match a linear scan" << std::endl;
+}
+
 int main() {
     std::cout << "========================================" << std::endl;
     std::cout << "BGP Simulator System Tests" << std::endl;
@@ -315,6 +1800,25 @@ int main() {
     test_multiple_announcements_same_prefix();
     test_customer_vs_provider_preference();
     test_output_format();
+    test_prefix_interning();
+    test_path_tree_sharing();
+    test_parallel_matches_serial();
+    test_prefix_major_matches_serial();
+    test_parse_caida();
+    test_graph_snapshot();
+    test_rib_writer();
+    test_rib_binary();
+    test_incremental_updates();
+    test_scenario_sweep();
+    test_topology_generator();
+    test_run_stats();
+    test_memory_report();
+    test_packed_announcement();
+    test_preference_key();
+    test_route_arenas();
+    test_input_loader();
+    test_query_server();
+    test_lpm_index();
     
     std::cout << "\n========================================" << std::endl;
     std::cout << "All system tests completed!" << std::endl;
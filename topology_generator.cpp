@@ -0,0 +1,65 @@
+#include "TopologyGenerator.h"
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+
+// Writes a synthetic CAIDA-style topology plus announcements and ROV deployment.
+// Usage: topology_generator [--ases N | --scale X] [--seed N] [--output-dir DIR] [options]
+// Produces DIR/synthetic.as-rel.txt, DIR/anns.csv and DIR/rov_asns.csv.
+int main(int argc, char* argv[]) {
+    TopologyConfig topology_config;
+    AnnouncementConfig announcement_config;
+    std::string output_dir = ".";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Error: " << arg << " requires a value.\n";
+            return 1;
+        }
+        const char* value = argv[++i];
+
+        if (arg == "--ases") topology_config.num_ases = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        else if (arg == "--scale") topology_config.num_ases = static_cast<uint32_t>(std::strtod(value, nullptr) * INTERNET_SCALE_ASES);
+        else if (arg == "--tier1") topology_config.tier1 = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        else if (arg == "--depth") topology_config.depth = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        else if (arg == "--stub-fraction") topology_config.stub_fraction = std::strtod(value, nullptr);
+        else if (arg == "--multihoming") topology_config.multihoming = std::strtod(value, nullptr);
+        else if (arg == "--peering-degree") topology_config.peering_degree = std::strtod(value, nullptr);
+        else if (arg == "--prefixes") announcement_config.prefixes = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        else if (arg == "--hijack-fraction") announcement_config.hijack_fraction = std::strtod(value, nullptr);
+        else if (arg == "--rov-fraction") announcement_config.rov_fraction = std::strtod(value, nullptr);
+        else if (arg == "--seed") topology_config.seed = announcement_config.seed = std::strtoull(value, nullptr, 10);
+        else if (arg == "--output-dir") output_dir = value;
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--ases N | --scale X] [--seed N] [--output-dir DIR]"
+                      << " [--tier1 N] [--depth N] [--stub-fraction F] [--multihoming F] [--peering-degree D]"
+                      << " [--prefixes N] [--hijack-fraction F] [--rov-fraction F]\n";
+            return 1;
+        }
+    }
+    if (topology_config.num_ases < 2) {
+        std::cerr << "Error: the topology needs at least two ASes.\n";
+        return 1;
+    }
+
+    SyntheticTopology topology = generate_topology(topology_config);
+
+    const std::string rel_path = output_dir + "/synthetic.as-rel.txt";
+    if (!write_as_rel(topology, topology_config, rel_path) ||
+        !write_announcements(topology, announcement_config, output_dir + "/anns.csv", output_dir + "/rov_asns.csv")) {
+        return 1;
+    }
+
+    std::vector<uint32_t> customers(topology.asns.size(), 0);
+    for (const auto& edge : topology.provider_edges) customers[edge.first]++;
+    size_t stubs = std::count(customers.begin(), customers.end(), 0u);
+
+    std::cout << "Generated " << topology.asns.size() << " ASes: " << topology.provider_edges.size()
+              << " provider-customer and " << topology.peer_edges.size() << " peer links.\n"
+              << "Stubs: " << stubs << ", most customers of one AS: "
+              << *std::max_element(customers.begin(), customers.end()) << ".\n"
+              << "Wrote " << rel_path << ", " << output_dir << "/anns.csv and " << output_dir << "/rov_asns.csv.\n";
+    return 0;
+}